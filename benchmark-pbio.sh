@@ -0,0 +1,14 @@
+#!/bin/sh
+#
+# Shortcut for running the servo control loop benchmark on the pbio library.
+#
+# Run ``./benchmark-pbio.sh -i <count>`` to fail if a scenario needs more than
+# <count> instructions per control tick on average.
+#
+
+set -e
+
+SCRIPT_DIR=$(dirname "$0")
+
+make -s -C "${SCRIPT_DIR}/lib/pbio/test" build/benchmark-pbio
+"${SCRIPT_DIR}/lib/pbio/test/build/benchmark-pbio" "$@"
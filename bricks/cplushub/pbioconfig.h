@@ -9,5 +9,6 @@
 
 #define PBIO_CONFIG_UARTDEV                 (1)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (4)
+#define PBIO_CONFIG_IODEV_HISTORY_SIZE      (16)
 
 #define PBIO_CONFIG_ENABLE_SYS              (1)
@@ -2,10 +2,14 @@
 // SPDX-License-Identifier: MIT
 // Copyright (c) 2018-2020 The Pybricks Authors
 
+#include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -21,32 +25,142 @@
 #include <pbio/config.h>
 #include <pbio/main.h>
 #include <pbio/light.h>
+#include <pbio/motorpoll.h>
 
 #include "py/mpconfig.h"
 #include "py/mpthread.h"
 
 #include "pbinit.h"
 
-// Flag that indicates whether we are busy stopping the thread
+// Real-time priority of the motor control thread
+#define CONTROL_THREAD_PRIORITY (50)
+
+// Flag that indicates whether we are busy stopping the threads
 static volatile bool stopping_thread = false;
 static pthread_t task_caller_thread;
+static pthread_t control_thread;
+
+// Lock held by the control thread while polling the motors, and by the
+// MicroPython thread while using them. Unlike the GIL, it is only held for
+// the duration of a single pbio call, so the control thread does not have
+// to wait for bytecode or garbage collection. With priority inheritance, a
+// thread holding it runs at real-time priority while the control thread waits.
+static pthread_mutex_t motorpoll_mutex;
+
+static void motorpoll_mutex_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&motorpoll_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void pbio_motorpoll_lock(void) {
+    pthread_mutex_lock(&motorpoll_mutex);
+}
+
+void pbio_motorpoll_unlock(void) {
+    pthread_mutex_unlock(&motorpoll_mutex);
+}
+
+// The real-time thread that polls the motors on a fixed period. It runs
+// without the GIL.
+static void *control_caller(void *arg) {
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        perror("timerfd_create");
+        return NULL;
+    }
+
+    struct itimerspec period = {
+        .it_interval.tv_nsec = PBIO_CONFIG_SERVO_PERIOD_MIN_MS * 1000000,
+        .it_value.tv_nsec = PBIO_CONFIG_SERVO_PERIOD_MIN_MS * 1000000,
+    };
+    timerfd_settime(timer_fd, 0, &period, NULL);
+
+    while (!stopping_thread) {
+        // Each read returns the number of periods elapsed since the previous
+        // one, so anything more than one means we missed a deadline.
+        uint64_t expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) == -1) {
+            perror("timerfd read");
+            continue;
+        }
+
+        pbio_motorpoll_lock();
+        if (expirations > 1 && _pbio_motorpoll_is_active()) {
+            pbio_add_missed_deadlines(expirations - 1);
+        }
+        _pbio_motorpoll_poll();
+        pbio_motorpoll_unlock();
+    }
+
+    close(timer_fd);
+
+    return NULL;
+}
+
+// Starts the control thread with real-time priority if allowed, or else
+// with normal priority.
+static void control_thread_start(void) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    struct sched_param param = { .sched_priority = CONTROL_THREAD_PRIORITY };
+    pthread_attr_setschedparam(&attr, &param);
+
+    int err = pthread_create(&control_thread, &attr, control_caller, NULL);
+    if (err == EPERM) {
+        fprintf(stderr, "Could not set real-time priority for motor control.\n");
+        err = pthread_create(&control_thread, NULL, control_caller, NULL);
+    }
+    if (err != 0) {
+        fprintf(stderr, "Could not start motor control thread: %s\n", strerror(err));
+        exit(1);
+    }
+    pthread_attr_destroy(&attr);
+}
 
-// The background thread that keeps firing the task handler
+// The background thread that keeps firing the task handler. It sleeps until
+// the next motor poll or timer deadline that pbio asks for.
 static void *task_caller(void *arg) {
-    struct timespec ts;
-    ts.tv_sec = 0;
-    ts.tv_nsec = PBIO_CONFIG_SERVO_PERIOD_MS * 1000000;
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        perror("timerfd_create");
+        return NULL;
+    }
 
     while (!stopping_thread) {
         MP_THREAD_GIL_ENTER();
         while (pbio_do_one_event()) {
         }
+        // The timeout counts from now, so take the time right away. Getting
+        // the GIL back to the MicroPython thread may take a while, and the
+        // deadline should not move out by however long that took.
+        uint32_t timeout = pbio_get_event_timeout();
+        struct itimerspec wake = { };
+        clock_gettime(CLOCK_MONOTONIC, &wake.it_value);
         MP_THREAD_GIL_EXIT();
 
-        clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+        if (timeout > 0) {
+            // Arm the timer for the absolute deadline, which may have passed
+            // already, in which case the read below returns right away.
+            wake.it_value.tv_nsec += (long)timeout * 1000000;
+            wake.it_value.tv_sec += wake.it_value.tv_nsec / 1000000000;
+            wake.it_value.tv_nsec %= 1000000000;
+            timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &wake, NULL);
+
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == -1) {
+                perror("timerfd read");
+            }
+        }
         etimer_request_poll();
     }
 
+    close(timer_fd);
+
     return NULL;
 }
 
@@ -96,22 +210,26 @@ void pybricks_init() {
     };
     grx_draw_filled_convex_polygon(G_N_ELEMENTS(triangle), triangle, GRX_COLOR_BLACK);
 
+    motorpoll_mutex_init();
     pbio_init();
     extern void ev3dev_status_light_init();
     ev3dev_status_light_init();
+    control_thread_start();
     pthread_create(&task_caller_thread, NULL, task_caller, NULL);
 }
 
 // Pybricks deinitialization tasks
 void pybricks_deinit() {
-    // Signal motor thread to stop and wait for it to do so.
+    // Signal the threads to stop and wait for them to do so.
     stopping_thread = true;
     pthread_join(task_caller_thread, NULL);
+    pthread_join(control_thread, NULL);
 }
 
 void pybricks_unhandled_exception() {
-    extern void _pbio_motorpoll_reset_all();
+    pbio_motorpoll_lock();
     _pbio_motorpoll_reset_all();
+    pbio_motorpoll_unlock();
     extern void _pb_ev3dev_speaker_beep_off();
     _pb_ev3dev_speaker_beep_off();
 }
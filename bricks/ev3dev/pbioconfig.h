@@ -4,5 +4,7 @@
 #define PBIO_CONFIG_EV3_INPUT_DEVICE        (1)
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_LIGHT                   (1)
+#define PBIO_CONFIG_MOTORPOLL_THREAD        (1)
+#define PBIO_CONFIG_SERVO_PERIOD_MIN_MS     (2)
 #define PBIO_CONFIG_SERIAL                  (1)
 #define PBIO_CONFIG_TACHO                   (1)
@@ -10,5 +10,6 @@
 
 #define PBIO_CONFIG_UARTDEV                 (1)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (6)
+#define PBIO_CONFIG_IODEV_HISTORY_SIZE      (16)
 
 #define PBIO_CONFIG_ENABLE_SYS              (1)
@@ -202,10 +202,12 @@ PYBRICKS_PYBRICKS_SRC_C = $(addprefix pybricks/,\
 	pupdevices/pb_type_pupdevices_ultrasonicsensor.c \
 	robotics/pb_module_robotics.c \
 	robotics/pb_type_drivebase.c \
+	robotics/pb_type_servogroup.c \
 	robotics/pb_type_matrix.c \
 	tools/pb_module_tools.c \
 	tools/pb_type_stopwatch.c \
 	util_mp/pb_obj_helper.c \
+	util_mp/pb_type_awaitable.c \
 	util_mp/pb_type_enum.c \
 	util_pb/pb_color_map.c \
 	util_pb/pb_device_stm32.c \
@@ -339,7 +341,10 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	src/main.c \
 	src/math.c \
 	src/motorpoll.c \
+	src/observer.c \
+	src/odometry.c \
 	src/servo.c \
+	src/servogroup.c \
 	src/tacho.c \
 	src/trajectory_ext.c \
 	src/trajectory.c \
@@ -61,4 +61,6 @@ pbio_error_t lego_sensor_get_mode(lego_sensor_t *sensor, uint8_t *mode);
 
 pbio_error_t lego_sensor_set_mode(lego_sensor_t *sensor, uint8_t mode);
 
+void lego_sensor_set_sample_period(lego_sensor_t *sensor, uint32_t period);
+
 #endif // _PBIO_LEGO_SENSOR_H_
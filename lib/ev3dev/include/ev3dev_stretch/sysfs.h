@@ -5,6 +5,7 @@
 #define _PBIO_EV3DEVSYSFS_H_
 
 #include <stdint.h>
+#include <stdio.h>
 
 #include <pbio/error.h>
 #include <pbio/iodev.h>
@@ -27,5 +28,12 @@ pbio_error_t sysfs_read_int(FILE *file, int *dest);
 
 pbio_error_t sysfs_write_int(FILE *file, int val);
 
+pbio_error_t sysfs_open_fd(int *fd, const char *pathpat, int n, const char *attribute, int flags);
+
+pbio_error_t sysfs_pread_int(int fd, int *dest);
+
+pbio_error_t sysfs_pwrite_int(int fd, int val);
+
+pbio_error_t sysfs_pwrite_str(int fd, const char *str);
 
 #endif // _PBIO_EV3DEVSYSFS_H_
@@ -2,9 +2,14 @@
 // Copyright (c) 2018-2020 The Pybricks Authors
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <contiki.h>
 
 #include <ev3dev_stretch/lego_port.h>
 #include <ev3dev_stretch/lego_sensor.h>
@@ -18,17 +23,48 @@
 #define MAX_READ_LENGTH "60"
 #define BIN_DATA_SIZE   32 // size of bin_data sysfs attribute
 
+// Sample period of sensors that have not been given one (ms)
+#define SAMPLE_PERIOD_DEFAULT (5)
+
+// Shortest sample period, so that the sampler keeps running (ms)
+#define SAMPLE_PERIOD_MIN (1)
+
+// Sensors whose driver notifies us of new data are still read after this
+// many sample periods without a notification, in case one was missed.
+#define SAMPLE_NOTIFY_MAX_SKIP (20)
+
 struct _lego_sensor_t {
     int n_sensor;
     int n_modes;
     FILE *f_mode;
     FILE *f_driver_name;
-    FILE *f_bin_data;
     FILE *f_num_values;
     FILE *f_bin_data_format;
     char modes[12][17];
-    uint8_t bin_data[PBIO_IODEV_MAX_DATA_SIZE]  __attribute__((aligned(32)));
+    // bin_data is read by the sampler, so it is a raw fd read with pread
+    int bin_data_fd;
+    // Whether bin_data_fd is open and read by the sampler
+    bool sampling;
+    // Whether the front buffer holds data for the current mode
+    bool valid;
+    // Whether the driver has ever notified us of new data with poll()
+    bool notifies;
+    // Sample periods since the last read of a notifying sensor
+    uint8_t skipped;
+    // How often the sampler reads this sensor (ms)
+    uint32_t period;
+    // When the sampler last read this sensor
+    clock_time_t sample_time;
+    // Index of the buffer with the latest data. The other one is written.
+    uint8_t front;
+    uint8_t bin_data[2][PBIO_IODEV_MAX_DATA_SIZE]  __attribute__((aligned(32)));
 };
+
+PROCESS(lego_sensor_sampler_process, "lego-sensor sampler");
+
+// Period of the sampler, which is the shortest period of all sensors (ms)
+static uint32_t sample_period = SAMPLE_PERIOD_DEFAULT;
+
 // Initialize an ev3dev sensor by opening the relevant sysfs attributes
 static pbio_error_t ev3_sensor_init(lego_sensor_t *sensor, pbio_port_t port) {
     pbio_error_t err;
@@ -58,10 +94,20 @@ static pbio_error_t ev3_sensor_init(lego_sensor_t *sensor, pbio_port_t port) {
         return err;
     }
 
-    err = sysfs_open_sensor_attr(&sensor->f_bin_data, sensor->n_sensor, "bin_data", "rb");
+    // Stop sampling the previous sensor on this port, if any
+    if (sensor->sampling) {
+        sensor->sampling = false;
+        close(sensor->bin_data_fd);
+    }
+    sensor->valid = false;
+    sensor->notifies = false;
+    sensor->period = SAMPLE_PERIOD_DEFAULT;
+
+    err = sysfs_open_fd(&sensor->bin_data_fd, "/sys/class/lego-sensor/sensor%d/%s", sensor->n_sensor, "bin_data", O_RDONLY);
     if (err != PBIO_SUCCESS) {
         return err;
     }
+    sensor->sampling = true;
 
     FILE *f_modes;
     err = sysfs_open_sensor_attr(&f_modes, sensor->n_sensor, "modes", "r");
@@ -195,6 +241,8 @@ pbio_error_t lego_sensor_get(lego_sensor_t **sensor, pbio_port_t port, pbio_iode
     if (err != PBIO_SUCCESS) {
         return err;
     }
+
+    process_start(&lego_sensor_sampler_process, NULL);
     return PBIO_SUCCESS;
 }
 
@@ -288,20 +336,112 @@ pbio_error_t lego_sensor_set_mode(lego_sensor_t *sensor, uint8_t mode) {
         return PBIO_ERROR_INVALID_ARG;
     }
 
+    // Data sampled in the old mode should not be returned for the new one
+    sensor->valid = false;
+
     return sysfs_write_str(sensor->f_mode, sensor->modes[mode]);
 }
 
-// Read 32 bytes from bin_data attribute
-pbio_error_t lego_sensor_get_bin_data(lego_sensor_t *sensor, uint8_t **bin_data) {
-    if (fseek(sensor->f_bin_data, 0, SEEK_SET) == -1) {
+// Read 32 bytes from bin_data attribute into the back buffer, then swap
+static pbio_error_t lego_sensor_sample(lego_sensor_t *sensor) {
+    uint8_t back = !sensor->front;
+
+    if (pread(sensor->bin_data_fd, sensor->bin_data[back], BIN_DATA_SIZE, 0) < BIN_DATA_SIZE) {
+        sensor->valid = false;
         return PBIO_ERROR_IO;
     }
 
-    if (fread(sensor->bin_data, 1, BIN_DATA_SIZE, sensor->f_bin_data) < BIN_DATA_SIZE) {
-        return PBIO_ERROR_IO;
+    sensor->front = back;
+    sensor->valid = true;
+    sensor->skipped = 0;
+    sensor->sample_time = clock_time();
+    return PBIO_SUCCESS;
+}
+
+// Read the bin_data of all sensors into their back buffers. Sensors whose
+// driver notifies changes through poll() are only read when they have new data.
+static void lego_sensor_sample_all(void) {
+    struct pollfd fds[PBIO_ARRAY_SIZE(sensors)];
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(sensors); i++) {
+        fds[i].fd = sensors[i].sampling ? sensors[i].bin_data_fd : -1;
+        fds[i].events = POLLPRI;
+        fds[i].revents = 0;
+    }
+
+    // This does not wait. It only checks which attributes have been notified.
+    if (poll(fds, PBIO_ARRAY_SIZE(fds), 0) == -1) {
+        for (size_t i = 0; i < PBIO_ARRAY_SIZE(fds); i++) {
+            fds[i].revents = 0;
+        }
+    }
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(sensors); i++) {
+        lego_sensor_t *sensor = &sensors[i];
+        // Sensors that just changed mode are read by the user first, after
+        // waiting for the new mode to take effect.
+        if (!sensor->sampling || !sensor->valid) {
+            continue;
+        }
+        if (fds[i].revents & POLLPRI) {
+            sensor->notifies = true;
+        } else if (sensor->notifies && sensor->valid && ++sensor->skipped < SAMPLE_NOTIFY_MAX_SKIP) {
+            continue;
+        } else if (!sensor->notifies && sensor->valid && clock_time() - sensor->sample_time + clock_from_msec(sample_period) / 2 < clock_from_msec(sensor->period)) {
+            // Sensors with a longer period are read on one of the later runs
+            continue;
+        }
+        // Errors are reported to the user when they read the sensor
+        lego_sensor_sample(sensor);
+    }
+}
+
+PROCESS_THREAD(lego_sensor_sampler_process, ev, data) {
+    static struct etimer timer;
+
+    PROCESS_BEGIN();
+
+    etimer_set(&timer, clock_from_msec(sample_period));
+
+    for (;;) {
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&timer));
+        lego_sensor_sample_all();
+        etimer_reset_with_new_interval(&timer, clock_from_msec(sample_period));
+    }
+
+    PROCESS_END();
+}
+
+// Set how often a sensor is read in the background. Periods shorter than
+// SAMPLE_PERIOD_MIN are rounded up, so the sampler never stops.
+void lego_sensor_set_sample_period(lego_sensor_t *sensor, uint32_t period) {
+    sensor->period = period < SAMPLE_PERIOD_MIN ? SAMPLE_PERIOD_MIN : period;
+
+    // The sampler runs as often as the sensor that needs it most
+    sample_period = sensor->period;
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(sensors); i++) {
+        if (sensors[i].sampling && sensors[i].period < sample_period) {
+            sample_period = sensors[i].period;
+        }
+    }
+}
+
+// Get the latest 32 bytes of bin_data. This is the sampled copy if there is
+// one, so the caller does not wait for sysfs.
+pbio_error_t lego_sensor_get_bin_data(lego_sensor_t *sensor, uint8_t **bin_data) {
+    if (!sensor->sampling) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    // Read now if the sampler has nothing for the current mode yet
+    if (!sensor->valid) {
+        pbio_error_t err = lego_sensor_sample(sensor);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
     }
 
-    *bin_data = sensor->bin_data;
+    *bin_data = sensor->bin_data[sensor->front];
 
     return PBIO_SUCCESS;
 }
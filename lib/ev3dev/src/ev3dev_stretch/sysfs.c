@@ -2,11 +2,14 @@
 // Copyright (c) 2018-2020 The Pybricks Authors
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <ev3dev_stretch/lego_sensor.h>
+#include <ev3dev_stretch/sysfs.h>
 
 #include <pbio/port.h>
 #include <pbio/iodev.h>
@@ -14,6 +17,9 @@
 #define MAX_PATH_LENGTH 60
 #define MAX_READ_LENGTH "60"
 
+// Longest integer we read or write, such as "-2147483648\n"
+#define MAX_INT_LENGTH 12
+
 // Get the ev3dev sensor number for a given port
 pbio_error_t sysfs_get_number(pbio_port_t port, const char *rdir, int *sysfs_number) {
     // Open lego-sensor directory in sysfs
@@ -108,37 +114,103 @@ pbio_error_t sysfs_read_str(FILE *file, char *dest) {
 
 // Write a string to a previously opened sysfs attribute
 pbio_error_t sysfs_write_str(FILE *file, const char *str) {
-    if (fseek(file, 0, SEEK_SET) == -1) {
+    return sysfs_pwrite_str(fileno(file), str);
+}
+
+// Read an int from a previously opened sysfs attribute
+pbio_error_t sysfs_read_int(FILE *file, int *dest) {
+    return sysfs_pread_int(fileno(file), dest);
+}
+
+// Write a number to a previously opened sysfs attribute
+pbio_error_t sysfs_write_int(FILE *file, int val) {
+    return sysfs_pwrite_int(fileno(file), val);
+}
+
+// Open a sysfs attribute as a raw file descriptor, for attributes that are
+// read or written on every control update
+pbio_error_t sysfs_open_fd(int *fd, const char *pathpat, int n, const char *attribute, int flags) {
+    char path[MAX_PATH_LENGTH];
+
+    snprintf(path, MAX_PATH_LENGTH, pathpat, n, attribute);
+    *fd = open(path, flags | O_CLOEXEC);
+    if (*fd == -1) {
         return PBIO_ERROR_IO;
     }
 
-    if (fprintf(file, "%s", str) != (int)strlen(str)) {
+    return PBIO_SUCCESS;
+}
+
+// Parse a decimal integer, as printed by the kernel
+static pbio_error_t sysfs_parse_int(const char *buf, ssize_t len, int *dest) {
+    ssize_t i = 0;
+    bool negative = buf[0] == '-';
+    if (negative) {
+        i++;
+    }
+    if (i == len || buf[i] < '0' || buf[i] > '9') {
         return PBIO_ERROR_IO;
     }
 
+    // Accumulate as a negative number, so INT_MIN fits
+    int val = 0;
+    for (; i < len && buf[i] >= '0' && buf[i] <= '9'; i++) {
+        val = val * 10 - (buf[i] - '0');
+    }
+    *dest = negative ? val : -val;
     return PBIO_SUCCESS;
 }
 
-// Read an int from a previously opened sysfs attribute
-pbio_error_t sysfs_read_int(FILE *file, int *dest) {
-    if (fseek(file, 0, SEEK_SET) == -1) {
-        return PBIO_ERROR_IO;
+// Format a decimal integer, returning the number of characters
+static size_t sysfs_format_int(char *buf, int val) {
+    char digits[MAX_INT_LENGTH];
+    size_t n = 0;
+
+    // Work with the negative value, so INT_MIN fits
+    int rest = val < 0 ? val : -val;
+    do {
+        digits[n++] = '0' - rest % 10;
+        rest /= 10;
+    } while (rest != 0);
+
+    size_t len = 0;
+    if (val < 0) {
+        buf[len++] = '-';
+    }
+    while (n > 0) {
+        buf[len++] = digits[--n];
     }
+    return len;
+}
+
+// Read an int from a sysfs attribute opened with sysfs_open_fd
+pbio_error_t sysfs_pread_int(int fd, int *dest) {
+    char buf[MAX_INT_LENGTH];
 
-    if (fscanf(file, "%d", dest) < 1) {
+    ssize_t len = pread(fd, buf, sizeof(buf), 0);
+    if (len <= 0) {
         return PBIO_ERROR_IO;
     }
 
-    return PBIO_SUCCESS;
+    return sysfs_parse_int(buf, len, dest);
 }
 
-// Write a number to a previously opened sysfs attribute
-pbio_error_t sysfs_write_int(FILE *file, int val) {
-    if (fseek(file, 0, SEEK_SET) == -1) {
+// Write an int to a sysfs attribute opened with sysfs_open_fd
+pbio_error_t sysfs_pwrite_int(int fd, int val) {
+    char buf[MAX_INT_LENGTH];
+
+    size_t len = sysfs_format_int(buf, val);
+    if (pwrite(fd, buf, len, 0) != (ssize_t)len) {
         return PBIO_ERROR_IO;
     }
 
-    if (fprintf(file, "%d", val) <= 0) {
+    return PBIO_SUCCESS;
+}
+
+// Write a string to a sysfs attribute opened with sysfs_open_fd
+pbio_error_t sysfs_pwrite_str(int fd, const char *str) {
+    size_t len = strlen(str);
+    if (pwrite(fd, str, len, 0) != (ssize_t)len) {
         return PBIO_ERROR_IO;
     }
 
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Virtual clock for simulations. Time only moves when the simulation advances
+// it, so maneuvers of several seconds complete as fast as the host can run
+// the control loops.
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_CLOCK_SIM
+
+#include <stdint.h>
+
+#include <contiki.h>
+
+#include "clock_sim.h"
+
+static uint32_t clock_now_usecs;
+
+/**
+ * Advances the virtual clock.
+ * @param [in]  usecs   Time to advance in microseconds
+ */
+void pbdrv_clock_sim_advance(uint32_t usecs) {
+    clock_now_usecs += usecs;
+    etimer_request_poll();
+}
+
+void clock_init(void) {
+    clock_now_usecs = 0;
+}
+
+clock_time_t clock_time() {
+    return clock_now_usecs / 1000;
+}
+
+unsigned long clock_usecs() {
+    return clock_now_usecs;
+}
+
+void clock_wait(clock_time_t t) {
+    pbdrv_clock_sim_advance(clock_to_msec(t) * 1000);
+}
+
+void clock_delay_usec(uint16_t duration) {
+    pbdrv_clock_sim_advance(duration);
+}
+
+#endif // PBDRV_CONFIG_CLOCK_SIM
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef _PBDRV_CLOCK_SIM_H_
+#define _PBDRV_CLOCK_SIM_H_
+
+#include <stdint.h>
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_CLOCK_SIM
+
+void pbdrv_clock_sim_advance(uint32_t usecs);
+
+#endif // PBDRV_CONFIG_CLOCK_SIM
+
+#endif // _PBDRV_CLOCK_SIM_H_
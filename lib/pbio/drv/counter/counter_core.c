@@ -13,6 +13,7 @@
 #include "../src/uartdev.h"
 #include "counter_ev3dev_stretch_iio.h"
 #include "counter_nxt.h"
+#include "counter_sim.h"
 #include "counter_stm32f0_gpio_quad_enc.h"
 #include "counter.h"
 
@@ -21,6 +22,7 @@ static pbdrv_counter_dev_t pbdrv_counter_devs[PBDRV_CONFIG_COUNTER_NUM_DEV];
 void pbdrv_counter_init() {
     pbdrv_counter_ev3dev_stretch_iio_init(pbdrv_counter_devs);
     pbdrv_counter_nxt_init(pbdrv_counter_devs);
+    pbdrv_counter_sim_init(pbdrv_counter_devs);
     pbdrv_counter_stm32f0_gpio_quad_enc_init(pbdrv_counter_devs);
     pbio_uartdev_counter_init(pbdrv_counter_devs);
 }
@@ -4,17 +4,30 @@
 // ev3dev-stretch PRU/IIO Quadrature Encoder Counter driver
 //
 // This driver uses the PRU quadrature encoder found in ev3dev-stretch.
+//
+// If the IIO device supports buffered capture, the counts and rates of all
+// channels are read as one timestamped scan from the character device, once
+// per control update. Otherwise, each value is read from its own attribute.
 
 #include <pbdrv/config.h>
 
 #if PBDRV_CONFIG_COUNTER_EV3DEV_STRETCH_IIO
 
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <contiki.h>
 #include <libudev.h>
 
+#include <ev3dev_stretch/sysfs.h>
+
+#include <pbio/config.h>
 #include <pbio/util.h>
 #include "counter.h"
 
@@ -25,48 +38,371 @@
 #define dbg_err(s)
 #endif
 
+// The buffer is read at most once in this time, so that all motors in one
+// control update read the same scan (us)
+#define BUFFER_READ_INTERVAL (1000)
+
+// Scans older than one control update no longer tell where the motors are,
+// so the attributes are read instead (us)
+#define BUFFER_SCAN_MAX_AGE (PBIO_CONFIG_SERVO_PERIOD_MS * 1000)
+
+// Where the kernel lists the IIO triggers
+#define BUFFER_TRIGGER_PATH "/sys/bus/iio/devices"
+
+// Number of scans the kernel buffers between reads
+#define BUFFER_LENGTH (16)
+
+// Largest scan: a 64-bit value for each channel and the timestamp
+#define BUFFER_SCAN_SIZE_MAX ((PBDRV_CONFIG_COUNTER_EV3DEV_STRETCH_IIO_NUM_DEV * 2 + 1) * 8)
+
+// Where and how a channel is stored in a buffered scan
+typedef struct {
+    bool enabled;
+    bool is_signed;
+    bool big_endian;
+    uint8_t offset;
+    uint8_t storage_bytes;
+    uint8_t bits;
+    uint8_t shift;
+} scan_channel_t;
+
+// The attributes are read on every control update, so they are kept open as
+// raw file descriptors and read with a single pread each.
 typedef struct {
     pbdrv_counter_dev_t *dev;
-    FILE *count;
-    FILE *rate;
+    int count;
+    int rate;
+    scan_channel_t count_channel;
+    scan_channel_t rate_channel;
 } private_data_t;
 
 static private_data_t private_data[PBDRV_CONFIG_COUNTER_EV3DEV_STRETCH_IIO_NUM_DEV];
 
-static pbio_error_t pbdrv_counter_ev3dev_stretch_iio_get_count(pbdrv_counter_dev_t *dev, int32_t *count) {
-    private_data_t *priv = dev->priv;
-
-    if (!priv->count) {
-        return PBIO_ERROR_NO_DEV;
+// Buffered capture of all channels at once
+static struct {
+    int fd;
+    size_t scan_size;
+    scan_channel_t timestamp_channel;
+    bool timestamp_valid;
+    uint8_t scan[BUFFER_SCAN_SIZE_MAX];
+    bool scan_valid;
+    bool scan_fresh;
+    uint32_t scan_time;
+    uint32_t read_time;
+} buffer = { .fd = -1 };
+
+// Gets a value from the latest scan
+static int64_t buffer_get_value(const scan_channel_t *ch) {
+    uint64_t raw = 0;
+    for (uint8_t i = 0; i < ch->storage_bytes; i++) {
+        uint8_t byte = buffer.scan[ch->offset + (ch->big_endian ? i : ch->storage_bytes - 1 - i)];
+        raw = (raw << 8) | byte;
+    }
+    raw >>= ch->shift;
+    if (ch->bits < 64) {
+        raw &= (UINT64_C(1) << ch->bits) - 1;
+        if (ch->is_signed && (raw & (UINT64_C(1) << (ch->bits - 1)))) {
+            raw |= ~((UINT64_C(1) << ch->bits) - 1);
+        }
     }
+    return (int64_t)raw;
+}
 
-    if (fseek(priv->count, 0, SEEK_SET) == -1) {
+// Makes sure the latest scan is at most one control update old. The kernel
+// hands out the oldest scans first, so drain it to get the newest one.
+// Returns PBIO_ERROR_AGAIN if there is no recent scan, in which case the
+// caller reads the attributes instead.
+static pbio_error_t buffer_update(void) {
+    uint32_t now = clock_usecs();
+    if (buffer.scan_valid && now - buffer.read_time < BUFFER_READ_INTERVAL) {
+        return buffer.scan_fresh ? PBIO_SUCCESS : PBIO_ERROR_AGAIN;
+    }
+    buffer.read_time = now;
+
+    uint8_t scans[BUFFER_LENGTH * BUFFER_SCAN_SIZE_MAX];
+    ssize_t size;
+    bool received = false;
+    while ((size = read(buffer.fd, scans, BUFFER_LENGTH * buffer.scan_size)) > 0) {
+        if (size % buffer.scan_size != 0) {
+            return PBIO_ERROR_IO;
+        }
+        memcpy(buffer.scan, &scans[size - buffer.scan_size], buffer.scan_size);
+        received = true;
+    }
+    if (size == -1 && errno != EAGAIN) {
         return PBIO_ERROR_IO;
     }
 
-    if (fscanf(priv->count, "%d", count) == EOF) {
-        return PBIO_ERROR_IO;
+    // The scan was taken when the kernel says it was, which is on the same
+    // clock as ours. Without a timestamp, the best guess is when it arrived.
+    if (received) {
+        buffer.scan_valid = true;
+        buffer.scan_time = buffer.timestamp_valid ?
+            (uint32_t)(buffer_get_value(&buffer.timestamp_channel) / 1000) : now;
     }
 
-    return PBIO_SUCCESS;
+    buffer.scan_fresh = buffer.scan_valid && (int32_t)(now - buffer.scan_time) <= BUFFER_SCAN_MAX_AGE;
+    return buffer.scan_fresh ? PBIO_SUCCESS : PBIO_ERROR_AGAIN;
+}
+
+static pbio_error_t pbdrv_counter_ev3dev_stretch_iio_get_count(pbdrv_counter_dev_t *dev, int32_t *count) {
+    private_data_t *priv = dev->priv;
+
+    if (priv->count_channel.enabled) {
+        pbio_error_t err = buffer_update();
+        if (err == PBIO_SUCCESS) {
+            *count = buffer_get_value(&priv->count_channel);
+        }
+        if (err != PBIO_ERROR_AGAIN) {
+            return err;
+        }
+    }
+
+    if (priv->count == -1) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    return sysfs_pread_int(priv->count, count);
 }
 
 static pbio_error_t pbdrv_counter_ev3dev_stretch_iio_get_rate(pbdrv_counter_dev_t *dev, int32_t *rate) {
     private_data_t *priv = dev->priv;
 
-    if (!priv->rate) {
+    if (priv->rate_channel.enabled) {
+        pbio_error_t err = buffer_update();
+        if (err == PBIO_SUCCESS) {
+            *rate = buffer_get_value(&priv->rate_channel);
+        }
+        if (err != PBIO_ERROR_AGAIN) {
+            return err;
+        }
+    }
+
+    if (priv->rate == -1) {
         return PBIO_ERROR_NO_DEV;
     }
 
-    if (fseek(priv->rate, 0, SEEK_SET) == -1) {
-        return PBIO_ERROR_IO;
+    return sysfs_pread_int(priv->rate, rate);
+}
+
+// Writes a string to an attribute of the IIO device
+static bool buffer_write_attr_str(const char *syspath, const char *attr, const char *value) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", syspath, attr);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
     }
+    bool ok = fputs(value, f) >= 0;
+    return fclose(f) == 0 && ok;
+}
 
-    if (fscanf(priv->rate, "%d", rate) == EOF) {
-        return PBIO_ERROR_IO;
+// Writes an int to an attribute of the IIO device
+static bool buffer_write_attr(const char *syspath, const char *attr, int value) {
+    char str[16];
+    snprintf(str, sizeof(str), "%d", value);
+    return buffer_write_attr_str(syspath, attr, str);
+}
+
+// Reads the first line of an attribute, without the newline
+static bool buffer_read_attr_str(const char *syspath, const char *attr, char *value, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", syspath, attr);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    bool ok = fgets(value, size, f) != NULL;
+    fclose(f);
+    if (ok) {
+        value[strcspn(value, "\n")] = '\0';
+    }
+    return ok;
+}
+
+// Makes sure something triggers the scans. If none is set, this picks the
+// trigger that the device provides itself, which is named after it.
+static bool buffer_setup_trigger(const char *syspath) {
+    char current[64];
+    char devname[64];
+    char name[64];
+    char path[256];
+
+    if (!buffer_read_attr_str(syspath, "trigger/current_trigger", current, sizeof(current))) {
+        // The device pushes scans on its own
+        return true;
+    }
+    if (current[0] != '\0') {
+        return true;
+    }
+    if (!buffer_read_attr_str(syspath, "name", devname, sizeof(devname))) {
+        return false;
     }
 
-    return PBIO_SUCCESS;
+    DIR *dir = opendir(BUFFER_TRIGGER_PATH);
+    if (!dir) {
+        return false;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "trigger", 7) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), BUFFER_TRIGGER_PATH "/%s", entry->d_name);
+        if (buffer_read_attr_str(path, "name", name, sizeof(name)) &&
+            strncmp(name, devname, strlen(devname)) == 0) {
+            buffer_write_attr_str(syspath, "trigger/current_trigger", name);
+            break;
+        }
+    }
+    closedir(dir);
+
+    // Check that the kernel took it
+    return buffer_read_attr_str(syspath, "trigger/current_trigger", current, sizeof(current)) &&
+           current[0] != '\0';
+}
+
+// Reads where and how an enabled channel is stored
+static bool buffer_get_channel(const char *syspath, const char *name, scan_channel_t *ch, int *index) {
+    char path[256];
+    char endian, sign;
+
+    snprintf(path, sizeof(path), "%s/scan_elements/%s_index", syspath, name);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    int n = fscanf(f, "%d", index);
+    fclose(f);
+    if (n != 1) {
+        return false;
+    }
+
+    // The type looks like "le:s32/32>>0"
+    snprintf(path, sizeof(path), "%s/scan_elements/%s_type", syspath, name);
+    f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    uint8_t storage_bits;
+    n = fscanf(f, "%ce:%c%hhu/%hhu>>%hhu", &endian, &sign, &ch->bits, &storage_bits, &ch->shift);
+    fclose(f);
+    if (n != 5 || storage_bits % 8 != 0 || storage_bits > 64 || ch->bits == 0 || ch->bits > storage_bits) {
+        return false;
+    }
+
+    ch->big_endian = endian == 'b';
+    ch->is_signed = sign == 's';
+    ch->storage_bytes = storage_bits / 8;
+    ch->enabled = true;
+    return true;
+}
+
+// Enables a channel for buffered capture. Channels that the kernel would
+// include in the scan but that we can't decode are disabled again.
+static bool buffer_enable_channel(const char *syspath, const char *name, scan_channel_t *ch, int *index) {
+    char attr[64];
+    snprintf(attr, sizeof(attr), "scan_elements/%s_en", name);
+    if (!buffer_write_attr(syspath, attr, 1)) {
+        return false;
+    }
+    if (!buffer_get_channel(syspath, name, ch, index)) {
+        buffer_write_attr(syspath, attr, 0);
+        return false;
+    }
+    return true;
+}
+
+// Sets up buffered capture of the counts, rates and timestamp. The kernel
+// stores the enabled channels by index, each aligned to its own size.
+static void buffer_setup(const char *syspath) {
+    char name[32];
+
+    // Stop any earlier capture, since channels can only change while stopped
+    buffer_write_attr(syspath, "buffer/enable", 0);
+
+    scan_channel_t *channels[PBIO_ARRAY_SIZE(private_data) * 2 + 1];
+    int indexes[PBIO_ARRAY_SIZE(channels)];
+    size_t n = 0;
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(private_data); i++) {
+        snprintf(name, sizeof(name), "in_count%d", (int)i);
+        if (buffer_enable_channel(syspath, name, &private_data[i].count_channel, &indexes[n])) {
+            channels[n++] = &private_data[i].count_channel;
+        }
+        snprintf(name, sizeof(name), "in_frequency%d", (int)i);
+        if (buffer_enable_channel(syspath, name, &private_data[i].rate_channel, &indexes[n])) {
+            channels[n++] = &private_data[i].rate_channel;
+        }
+    }
+    if (buffer_enable_channel(syspath, "in_timestamp", &buffer.timestamp_channel, &indexes[n])) {
+        channels[n++] = &buffer.timestamp_channel;
+
+        // Timestamps can only be compared to our clock if they are on it
+        buffer.timestamp_valid = buffer.timestamp_channel.storage_bytes == 8 &&
+            buffer_write_attr_str(syspath, "current_timestamp_clock", "monotonic_raw");
+    }
+
+    // Lay out the channels in order of their index
+    size_t offset = 0;
+    for (int index = 0; n > 0 && offset <= BUFFER_SCAN_SIZE_MAX; index++) {
+        for (size_t c = 0; c < n; c++) {
+            if (indexes[c] != index) {
+                continue;
+            }
+            scan_channel_t *ch = channels[c];
+            offset = (offset + ch->storage_bytes - 1) / ch->storage_bytes * ch->storage_bytes;
+            ch->offset = offset;
+            offset += ch->storage_bytes;
+            channels[c] = channels[--n];
+            indexes[c] = indexes[n];
+            break;
+        }
+        if (index > 64) {
+            // Indexes we could not place, so give up
+            offset = BUFFER_SCAN_SIZE_MAX + 1;
+        }
+    }
+
+    // The scan is padded to the size of its largest element
+    size_t align = 1;
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(private_data); i++) {
+        if (private_data[i].count_channel.storage_bytes > align) {
+            align = private_data[i].count_channel.storage_bytes;
+        }
+        if (private_data[i].rate_channel.storage_bytes > align) {
+            align = private_data[i].rate_channel.storage_bytes;
+        }
+    }
+    if (buffer.timestamp_channel.storage_bytes > align) {
+        align = buffer.timestamp_channel.storage_bytes;
+    }
+    buffer.scan_size = (offset + align - 1) / align * align;
+
+    if (buffer.scan_size == 0 || buffer.scan_size > BUFFER_SCAN_SIZE_MAX ||
+        !buffer_setup_trigger(syspath) ||
+        !buffer_write_attr(syspath, "buffer/length", BUFFER_LENGTH) ||
+        !buffer_write_attr(syspath, "buffer/enable", 1)) {
+        goto fail;
+    }
+
+    const char *sysname = strrchr(syspath, '/');
+    snprintf(name, sizeof(name), "/dev%s", sysname ? sysname : "");
+    buffer.fd = open(name, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (buffer.fd == -1) {
+        buffer_write_attr(syspath, "buffer/enable", 0);
+        goto fail;
+    }
+    return;
+
+fail:
+    dbg_err("buffered capture not available");
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(private_data); i++) {
+        private_data[i].count_channel.enabled = false;
+        private_data[i].rate_channel.enabled = false;
+    }
+    buffer.timestamp_channel.enabled = false;
+    buffer.timestamp_valid = false;
 }
 
 static const pbdrv_counter_funcs_t pbdrv_counter_ev3dev_stretch_iio_funcs = {
@@ -80,6 +416,11 @@ void pbdrv_counter_ev3dev_stretch_iio_init(pbdrv_counter_dev_t *devs) {
     struct udev_enumerate *enumerate;
     struct udev_list_entry *entry;
 
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(private_data); i++) {
+        private_data[i].count = -1;
+        private_data[i].rate = -1;
+    }
+
     udev = udev_new();
     if (!udev) {
         dbg_err("Failed to get udev context");
@@ -118,23 +459,19 @@ void pbdrv_counter_ev3dev_stretch_iio_init(pbdrv_counter_dev_t *devs) {
         private_data_t *priv = &private_data[i];
 
         snprintf(buf, sizeof(buf), "%s/in_count%d_raw", udev_list_entry_get_name(entry), (int)i);
-        priv->count = fopen(buf, "r");
-        if (!priv->count) {
+        priv->count = open(buf, O_RDONLY | O_CLOEXEC);
+        if (priv->count == -1) {
             dbg_err("failed to open count attribute");
             continue;
         }
 
-        setbuf(priv->count, NULL);
-
         snprintf(buf, sizeof(buf), "%s/in_frequency%d_input", udev_list_entry_get_name(entry), (int)i);
-        priv->rate = fopen(buf, "r");
-        if (!priv->rate) {
+        priv->rate = open(buf, O_RDONLY | O_CLOEXEC);
+        if (priv->rate == -1) {
             dbg_err("failed to open rate attribute");
             continue;
         }
 
-        setbuf(priv->rate, NULL);
-
         // FIXME: assuming that these are the only counter devices
         // counter_id should be passed from platform data instead
         _Static_assert(PBDRV_CONFIG_COUNTER_EV3DEV_STRETCH_IIO_NUM_DEV == PBDRV_CONFIG_COUNTER_NUM_DEV,
@@ -144,6 +481,8 @@ void pbdrv_counter_ev3dev_stretch_iio_init(pbdrv_counter_dev_t *devs) {
         priv->dev->priv = priv;
     }
 
+    buffer_setup(udev_list_entry_get_name(entry));
+
 free_enumerate:
     udev_enumerate_unref(enumerate);
 free_udev:
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Encoders of the simulated motors in drv/sim/motor.c
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_COUNTER_SIM
+
+#include <math.h>
+#include <stdint.h>
+
+#include <pbdrv/motor.h>
+#include <pbio/iodev.h>
+#include <pbio/port.h>
+#include <pbio/util.h>
+
+#include "../sim/motor_sim.h"
+#include "counter.h"
+
+typedef struct {
+    pbdrv_counter_dev_t *dev;
+    pbio_port_t port;
+} private_data_t;
+
+static private_data_t private_data[PBDRV_CONFIG_COUNTER_SIM_NUM_DEV];
+
+static pbio_error_t pbdrv_counter_sim_get_count(pbdrv_counter_dev_t *dev, int32_t *count) {
+    private_data_t *priv = dev->priv;
+    double angle, speed;
+
+    pbio_error_t err = pbdrv_motor_sim_get_angle(priv->port, &angle, &speed);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    *count = floor(angle * PBDRV_CONFIG_COUNTER_COUNTS_PER_DEGREE);
+
+    return PBIO_SUCCESS;
+}
+
+static pbio_error_t pbdrv_counter_sim_get_abs_count(pbdrv_counter_dev_t *dev, int32_t *count) {
+    private_data_t *priv = dev->priv;
+    pbio_iodev_type_id_t id;
+    double angle, speed;
+
+    // Only motors with an absolute encoder report the absolute angle
+    pbio_error_t err = pbdrv_motor_get_id(priv->port, &id);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    switch (id) {
+        case PBIO_IODEV_TYPE_ID_CPLUS_L_MOTOR:
+        case PBIO_IODEV_TYPE_ID_CPLUS_XL_MOTOR:
+        case PBIO_IODEV_TYPE_ID_SPIKE_M_MOTOR:
+        case PBIO_IODEV_TYPE_ID_SPIKE_L_MOTOR:
+            break;
+        default:
+            return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    err = pbdrv_motor_sim_get_angle(priv->port, &angle, &speed);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Absolute angle is reported in the range [-180, 180)
+    double abs_angle = fmod(angle + 180, 360);
+    if (abs_angle < 0) {
+        abs_angle += 360;
+    }
+    *count = floor((abs_angle - 180) * PBDRV_CONFIG_COUNTER_COUNTS_PER_DEGREE);
+
+    return PBIO_SUCCESS;
+}
+
+static pbio_error_t pbdrv_counter_sim_get_rate(pbdrv_counter_dev_t *dev, int32_t *rate) {
+    private_data_t *priv = dev->priv;
+    double angle, speed;
+
+    pbio_error_t err = pbdrv_motor_sim_get_angle(priv->port, &angle, &speed);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    *rate = speed * PBDRV_CONFIG_COUNTER_COUNTS_PER_DEGREE;
+
+    return PBIO_SUCCESS;
+}
+
+static const pbdrv_counter_funcs_t pbdrv_counter_sim_funcs = {
+    .get_count = pbdrv_counter_sim_get_count,
+    .get_abs_count = pbdrv_counter_sim_get_abs_count,
+    .get_rate = pbdrv_counter_sim_get_rate,
+};
+
+void pbdrv_counter_sim_init(pbdrv_counter_dev_t *devs) {
+    for (int i = 0; i < PBIO_ARRAY_SIZE(private_data); i++) {
+        private_data_t *priv = &private_data[i];
+
+        // Counter devices are numbered like the motor ports
+        priv->port = PBDRV_CONFIG_FIRST_MOTOR_PORT + i;
+        priv->dev = &devs[i];
+        priv->dev->funcs = &pbdrv_counter_sim_funcs;
+        priv->dev->priv = priv;
+    }
+}
+
+#endif // PBDRV_CONFIG_COUNTER_SIM
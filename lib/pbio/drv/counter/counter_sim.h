@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef _PBDRV_COUNTER_SIM_H_
+#define _PBDRV_COUNTER_SIM_H_
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_COUNTER_SIM
+
+#if !PBDRV_CONFIG_COUNTER_SIM_NUM_DEV
+#error Platform must define PBDRV_CONFIG_COUNTER_SIM_NUM_DEV
+#endif
+
+#include <pbdrv/counter.h>
+
+void pbdrv_counter_sim_init(pbdrv_counter_dev_t *devs);
+
+#else // PBDRV_CONFIG_COUNTER_SIM
+
+#define pbdrv_counter_sim_init(devs)
+
+#endif // PBDRV_CONFIG_COUNTER_SIM
+
+#endif // _PBDRV_COUNTER_SIM_H_
@@ -153,6 +153,12 @@ static pbio_error_t pbdrv_pwm_tlc5955_stm32_set_duty(pbdrv_pwm_dev_t *dev, uint3
     assert(ch < TLC5955_NUM_CHANNEL);
     assert(value <= UINT16_MAX);
 
+    // Don't send the latch again if nothing changed. Otherwise, all changes
+    // made before the process runs are sent together in one transfer.
+    if (priv->grayscale_latch[ch * 2 + 1] == (uint8_t)(value >> 8) && priv->grayscale_latch[ch * 2 + 2] == (uint8_t)value) {
+        return PBIO_SUCCESS;
+    }
+
     priv->grayscale_latch[ch * 2 + 1] = value >> 8;
     priv->grayscale_latch[ch * 2 + 2] = value;
     priv->changed = true;
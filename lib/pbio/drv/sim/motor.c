@@ -0,0 +1,489 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_MOTOR_SIM
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <contiki.h>
+
+#include <pbdrv/motor.h>
+#include <pbio/error.h>
+#include <pbio/iodev.h>
+#include <pbio/port.h>
+
+#include "motor_sim.h"
+
+// Integration step of the motor model. This is well below the mechanical and
+// braking time constants of all motor types, so simple forward integration is
+// stable and accurate enough.
+#define SIM_STEP_US (50)
+
+#define DEG_TO_RAD(d) ((d) * (M_PI / 180.0))
+#define RAD_TO_DEG(r) ((r) * (180.0 / M_PI))
+
+// Datasheet-like properties of a motor type, from which the physical
+// parameters are derived.
+typedef struct {
+    // Voltage at 100% duty cycle (V)
+    double voltage;
+    // Speed without load at this voltage (deg/s)
+    double no_load_speed;
+    // Time to reach 63% of the no load speed when braked or driven (ms)
+    double time_constant;
+    // Torque when stalled at this voltage (Nm)
+    double stall_torque;
+    // Coulomb friction as fraction of the stall torque
+    double friction;
+    // Play in the gear train (deg)
+    double backlash;
+} sim_motor_type_t;
+
+enum {
+    SIM_MOTOR_EV3_MEDIUM,
+    SIM_MOTOR_EV3_LARGE,
+    SIM_MOTOR_MOVE_HUB,
+    SIM_MOTOR_INTERACTIVE,
+    SIM_MOTOR_CPLUS_M,
+    SIM_MOTOR_CPLUS_L,
+    SIM_MOTOR_DEFAULT,
+};
+
+// The no load speed and time constant are the same as in the motor model of
+// pbio_servo_get_model() in pbio/servo.c, so the simulated motors behave the
+// way the speed observer expects.
+static const sim_motor_type_t sim_motor_types[] = {
+    [SIM_MOTOR_EV3_MEDIUM] = {
+        .voltage = 7.5,
+        .no_load_speed = 1600,
+        .time_constant = 15,
+        .stall_torque = 0.12,
+        .friction = 0.05,
+        .backlash = 1.5,
+    },
+    [SIM_MOTOR_EV3_LARGE] = {
+        .voltage = 7.5,
+        .no_load_speed = 1050,
+        .time_constant = 30,
+        .stall_torque = 0.40,
+        .friction = 0.05,
+        .backlash = 2.0,
+    },
+    [SIM_MOTOR_MOVE_HUB] = {
+        .voltage = 7.2,
+        .no_load_speed = 1500,
+        .time_constant = 20,
+        .stall_torque = 0.10,
+        .friction = 0.10,
+        .backlash = 2.5,
+    },
+    [SIM_MOTOR_INTERACTIVE] = {
+        .voltage = 7.2,
+        .no_load_speed = 1000,
+        .time_constant = 20,
+        .stall_torque = 0.12,
+        .friction = 0.10,
+        .backlash = 2.5,
+    },
+    [SIM_MOTOR_CPLUS_M] = {
+        .voltage = 7.2,
+        .no_load_speed = 1300,
+        .time_constant = 20,
+        .stall_torque = 0.25,
+        .friction = 0.08,
+        .backlash = 2.0,
+    },
+    [SIM_MOTOR_CPLUS_L] = {
+        .voltage = 7.2,
+        .no_load_speed = 1050,
+        .time_constant = 30,
+        .stall_torque = 0.40,
+        .friction = 0.08,
+        .backlash = 2.0,
+    },
+    // Used for motors that pbio has no model for
+    [SIM_MOTOR_DEFAULT] = {
+        .voltage = 7.2,
+        .no_load_speed = 1000,
+        .time_constant = 50,
+        .stall_torque = 0.15,
+        .friction = 0.05,
+        .backlash = 2.0,
+    },
+};
+
+// Same grouping of motor types as pbio_servo_get_model() in pbio/servo.c
+static const sim_motor_type_t *get_motor_type(pbio_iodev_type_id_t id) {
+    switch (id) {
+        case PBIO_IODEV_TYPE_ID_EV3_MEDIUM_MOTOR:
+            return &sim_motor_types[SIM_MOTOR_EV3_MEDIUM];
+        case PBIO_IODEV_TYPE_ID_EV3_LARGE_MOTOR:
+            return &sim_motor_types[SIM_MOTOR_EV3_LARGE];
+        case PBIO_IODEV_TYPE_ID_MOVE_HUB_MOTOR:
+            return &sim_motor_types[SIM_MOTOR_MOVE_HUB];
+        case PBIO_IODEV_TYPE_ID_INTERACTIVE_MOTOR:
+            return &sim_motor_types[SIM_MOTOR_INTERACTIVE];
+        case PBIO_IODEV_TYPE_ID_CPLUS_L_MOTOR:
+        case PBIO_IODEV_TYPE_ID_SPIKE_M_MOTOR:
+            return &sim_motor_types[SIM_MOTOR_CPLUS_M];
+        case PBIO_IODEV_TYPE_ID_CPLUS_XL_MOTOR:
+        case PBIO_IODEV_TYPE_ID_SPIKE_L_MOTOR:
+            return &sim_motor_types[SIM_MOTOR_CPLUS_L];
+        default:
+            return &sim_motor_types[SIM_MOTOR_DEFAULT];
+    }
+}
+
+static void load_sim_settings(pbdrv_motor_sim_settings_t *s, pbio_iodev_type_id_t id) {
+    const sim_motor_type_t *type = get_motor_type(id);
+
+    // Ignoring friction, the no load speed is where the back-EMF cancels the
+    // supply voltage, and the stall torque is set by the winding resistance.
+    s->voltage = type->voltage;
+    s->k_emf = type->voltage / DEG_TO_RAD(type->no_load_speed);
+    s->resistance = s->k_emf * type->voltage / type->stall_torque;
+
+    // With the windings shorted or driven, speed settles with time constant
+    // J * R / k^2, which gives the inertia.
+    s->inertia = type->time_constant / 1000.0 * s->k_emf * s->k_emf / s->resistance;
+    s->friction = type->friction * type->stall_torque;
+    s->damping = 0;
+
+    // By default, only the output gear sits behind the backlash
+    s->backlash = type->backlash;
+    s->load_inertia = s->inertia / 10;
+    s->load_torque = 0;
+    s->end_stops = false;
+    s->min_angle = 0;
+    s->max_angle = 0;
+}
+
+typedef struct {
+    pbio_iodev_type_id_t id;
+    pbdrv_motor_sim_settings_t settings;
+    bool coasting;
+    int16_t duty_cycle;
+    // Command to apply at the end of the ongoing batch
+    bool pending;
+    bool pending_coasting;
+    int16_t pending_duty_cycle;
+    // Time up to which the state below has been integrated
+    uint32_t time;
+    // Encoder side angle (rad) and speed (rad/s)
+    double angle;
+    double speed;
+    // Output side angle (rad) and speed (rad/s)
+    double load_angle;
+    double load_speed;
+} sim_motor_t;
+
+static sim_motor_t sim_motors[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+
+// Whether motor commands are deferred until the batch is committed
+static bool sim_batch;
+
+// Integrates the encoder side of the gear train over one step
+static void sim_step_motor(sim_motor_t *mtr, double dt) {
+    const pbdrv_motor_sim_settings_t *s = &mtr->settings;
+
+    // Coasting leaves the windings open, so there is no electrical torque.
+    // Otherwise the current follows from the applied and induced voltage.
+    double torque = 0;
+    if (!mtr->coasting) {
+        double voltage = s->voltage * mtr->duty_cycle / PBDRV_MAX_DUTY;
+        torque = s->k_emf * (voltage - s->k_emf * mtr->speed) / s->resistance;
+    }
+    torque -= s->damping * mtr->speed;
+
+    // Friction stops the motor rather than reversing it
+    if (mtr->speed == 0 && fabs(torque) <= s->friction) {
+        return;
+    }
+    double direction = mtr->speed != 0 ? mtr->speed : torque;
+    torque -= direction > 0 ? s->friction : -s->friction;
+
+    double speed = mtr->speed + torque / s->inertia * dt;
+    if (mtr->speed != 0 && (speed > 0) != (mtr->speed > 0)) {
+        speed = 0;
+    }
+    mtr->speed = speed;
+    mtr->angle += speed * dt;
+}
+
+// Integrates the output side of the gear train over one step
+static void sim_step_load(sim_motor_t *mtr, double dt) {
+    const pbdrv_motor_sim_settings_t *s = &mtr->settings;
+
+    if (s->load_inertia > 0) {
+        mtr->load_speed += s->load_torque / s->load_inertia * dt;
+    }
+    mtr->load_angle += mtr->load_speed * dt;
+}
+
+// Keeps the output within the end stops. Returns the stop side if the output
+// is resting against one: 1 for the maximum, -1 for the minimum, 0 otherwise.
+static int sim_apply_end_stops(sim_motor_t *mtr) {
+    const pbdrv_motor_sim_settings_t *s = &mtr->settings;
+
+    if (!s->end_stops) {
+        return 0;
+    }
+    if (mtr->load_angle >= DEG_TO_RAD(s->max_angle)) {
+        mtr->load_angle = DEG_TO_RAD(s->max_angle);
+        mtr->load_speed = fmin(mtr->load_speed, 0);
+        return 1;
+    }
+    if (mtr->load_angle <= DEG_TO_RAD(s->min_angle)) {
+        mtr->load_angle = DEG_TO_RAD(s->min_angle);
+        mtr->load_speed = fmax(mtr->load_speed, 0);
+        return -1;
+    }
+    return 0;
+}
+
+// Resolves contact at either end of the backlash as a plastic collision
+static void sim_apply_backlash(sim_motor_t *mtr, int stop) {
+    const pbdrv_motor_sim_settings_t *s = &mtr->settings;
+
+    double play = DEG_TO_RAD(s->backlash) / 2;
+    double gap = mtr->angle - mtr->load_angle;
+    double excess = gap > play ? gap - play : gap < -play ? gap + play : 0;
+
+    if (excess == 0) {
+        return;
+    }
+
+    // Motor is pushing the output towards the side it is resting against
+    if ((excess > 0 && stop > 0) || (excess < 0 && stop < 0)) {
+        mtr->angle -= excess;
+        mtr->speed = mtr->load_speed;
+        return;
+    }
+
+    // Otherwise both sides move together, conserving momentum
+    double inertia = s->inertia + s->load_inertia;
+    mtr->angle -= excess * s->load_inertia / inertia;
+    mtr->load_angle += excess * s->inertia / inertia;
+    if ((excess > 0) == (mtr->speed > mtr->load_speed)) {
+        double speed = (s->inertia * mtr->speed + s->load_inertia * mtr->load_speed) / inertia;
+        mtr->speed = speed;
+        mtr->load_speed = speed;
+    }
+}
+
+// Brings the motor state up to the current time
+static void sim_update(sim_motor_t *mtr) {
+    uint32_t now = clock_usecs();
+    const double dt = SIM_STEP_US / 1000000.0;
+
+    while ((int32_t)(now - mtr->time) >= SIM_STEP_US) {
+        mtr->time += SIM_STEP_US;
+        sim_step_motor(mtr, dt);
+        sim_step_load(mtr, dt);
+
+        int stop = sim_apply_end_stops(mtr);
+        sim_apply_backlash(mtr, stop);
+
+        // The motor may have pushed the output into an end stop
+        if (!stop && (stop = sim_apply_end_stops(mtr))) {
+            sim_apply_backlash(mtr, stop);
+        }
+    }
+}
+
+static pbio_error_t sim_get_motor(pbio_port_t port, sim_motor_t **mtr) {
+    if (port < PBDRV_CONFIG_FIRST_MOTOR_PORT || port > PBDRV_CONFIG_LAST_MOTOR_PORT) {
+        return PBIO_ERROR_INVALID_PORT;
+    }
+
+    *mtr = &sim_motors[port - PBDRV_CONFIG_FIRST_MOTOR_PORT];
+
+    if ((*mtr)->id == PBIO_IODEV_TYPE_ID_NONE) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    sim_update(*mtr);
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Connects a simulated motor to a port, or disconnects it if @p id is
+ * ::PBIO_IODEV_TYPE_ID_NONE. The motor starts at rest and coasting, with
+ * the default physical parameters for its type.
+ * @param [in]  port    The motor port
+ * @param [in]  id      The motor type
+ * @param [in]  angle   Initial angle of the encoder and output in degrees
+ * @return              ::PBIO_SUCCESS on success or ::PBIO_ERROR_INVALID_PORT
+ *                      if port is not a valid port
+ */
+pbio_error_t pbdrv_motor_sim_attach(pbio_port_t port, pbio_iodev_type_id_t id, int32_t angle) {
+    if (port < PBDRV_CONFIG_FIRST_MOTOR_PORT || port > PBDRV_CONFIG_LAST_MOTOR_PORT) {
+        return PBIO_ERROR_INVALID_PORT;
+    }
+
+    sim_motor_t *mtr = &sim_motors[port - PBDRV_CONFIG_FIRST_MOTOR_PORT];
+
+    mtr->id = id;
+    load_sim_settings(&mtr->settings, id);
+    mtr->coasting = true;
+    mtr->duty_cycle = 0;
+    mtr->pending = false;
+    mtr->time = clock_usecs();
+    mtr->angle = DEG_TO_RAD(angle);
+    mtr->speed = 0;
+    mtr->load_angle = mtr->angle;
+    mtr->load_speed = 0;
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the physical parameters of a simulated motor. They may be modified
+ * at any time and take effect from the current time onwards.
+ * @param [in]  port        The motor port
+ * @param [out] settings    The parameters
+ * @return                  ::PBIO_SUCCESS on success,
+ *                          ::PBIO_ERROR_INVALID_PORT if port is not a valid port
+ *                          ::PBIO_ERROR_NO_DEV if no motor is attached
+ */
+pbio_error_t pbdrv_motor_sim_get_settings(pbio_port_t port, pbdrv_motor_sim_settings_t **settings) {
+    sim_motor_t *mtr;
+    pbio_error_t err = sim_get_motor(port, &mtr);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    *settings = &mtr->settings;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the angle and speed of the encoder side of a simulated motor.
+ * @param [in]  port    The motor port
+ * @param [out] angle   The angle in degrees
+ * @param [out] speed   The speed in degrees per second
+ * @return              ::PBIO_SUCCESS on success,
+ *                      ::PBIO_ERROR_INVALID_PORT if port is not a valid port
+ *                      ::PBIO_ERROR_NO_DEV if no motor is attached
+ */
+pbio_error_t pbdrv_motor_sim_get_angle(pbio_port_t port, double *angle, double *speed) {
+    sim_motor_t *mtr;
+    pbio_error_t err = sim_get_motor(port, &mtr);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    *angle = RAD_TO_DEG(mtr->angle);
+    *speed = RAD_TO_DEG(mtr->speed);
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the angle of the output side of a simulated motor, which differs from
+ * the encoder angle by up to half the backlash.
+ * @param [in]  port    The motor port
+ * @param [out] angle   The angle in degrees
+ * @return              ::PBIO_SUCCESS on success,
+ *                      ::PBIO_ERROR_INVALID_PORT if port is not a valid port
+ *                      ::PBIO_ERROR_NO_DEV if no motor is attached
+ */
+pbio_error_t pbdrv_motor_sim_get_output_angle(pbio_port_t port, double *angle) {
+    sim_motor_t *mtr;
+    pbio_error_t err = sim_get_motor(port, &mtr);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    *angle = RAD_TO_DEG(mtr->load_angle);
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Brings all simulated motors up to the current time. This is otherwise done
+ * on demand when a motor is accessed.
+ */
+void pbdrv_motor_sim_update(void) {
+    for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+        if (sim_motors[i].id != PBIO_IODEV_TYPE_ID_NONE) {
+            sim_update(&sim_motors[i]);
+        }
+    }
+}
+
+// Applies a motor command now, or when the ongoing batch is committed
+static void sim_set_output(sim_motor_t *mtr, bool coasting, int16_t duty_cycle) {
+    if (sim_batch) {
+        mtr->pending = true;
+        mtr->pending_coasting = coasting;
+        mtr->pending_duty_cycle = duty_cycle;
+        return;
+    }
+    mtr->coasting = coasting;
+    mtr->duty_cycle = duty_cycle;
+}
+
+#if PBDRV_CONFIG_MOTOR_BATCH
+
+void pbdrv_motor_batch_begin(void) {
+    sim_batch = true;
+}
+
+pbio_error_t pbdrv_motor_batch_commit(void) {
+    sim_batch = false;
+
+    for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+        sim_motor_t *mtr = &sim_motors[i];
+        if (!mtr->pending) {
+            continue;
+        }
+        // Integrate up to now with the old output, then switch all at once
+        sim_update(mtr);
+        sim_set_output(mtr, mtr->pending_coasting, mtr->pending_duty_cycle);
+        mtr->pending = false;
+    }
+    return PBIO_SUCCESS;
+}
+
+#endif // PBDRV_CONFIG_MOTOR_BATCH
+
+pbio_error_t pbdrv_motor_coast(pbio_port_t port) {
+    sim_motor_t *mtr;
+    pbio_error_t err = sim_get_motor(port, &mtr);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    sim_set_output(mtr, true, 0);
+    return PBIO_SUCCESS;
+}
+
+pbio_error_t pbdrv_motor_set_duty_cycle(pbio_port_t port, int16_t duty_cycle) {
+    sim_motor_t *mtr;
+    pbio_error_t err = sim_get_motor(port, &mtr);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    if (duty_cycle < -PBDRV_MAX_DUTY || duty_cycle > PBDRV_MAX_DUTY) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    sim_set_output(mtr, false, duty_cycle);
+    return PBIO_SUCCESS;
+}
+
+pbio_error_t pbdrv_motor_get_id(pbio_port_t port, pbio_iodev_type_id_t *id) {
+    sim_motor_t *mtr;
+    pbio_error_t err = sim_get_motor(port, &mtr);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    *id = mtr->id;
+    return PBIO_SUCCESS;
+}
+
+pbio_error_t pbdrv_motor_setup(pbio_port_t port, bool is_servo) {
+    sim_motor_t *mtr;
+    return sim_get_motor(port, &mtr);
+}
+
+#endif // PBDRV_CONFIG_MOTOR_SIM
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Simulated motors for running the control loops on a host computer.
+//
+// Each port has a brushed DC motor with an internal gear train. The encoder
+// sits on the motor side of the gear backlash, so it sees the motor inertia
+// directly while the output shaft and any attached load only follow once the
+// backlash is taken up. The motor state is integrated up to clock_usecs()
+// whenever it is accessed, so the simulation runs as fast as the clock is
+// advanced.
+
+#ifndef _PBDRV_SIM_MOTOR_SIM_H_
+#define _PBDRV_SIM_MOTOR_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pbdrv/config.h>
+#include <pbio/error.h>
+#include <pbio/iodev.h>
+#include <pbio/port.h>
+
+/**
+ * Physical parameters of a simulated motor, in SI units as seen at the output
+ * shaft. Angles are in degrees.
+ */
+typedef struct {
+    /** Voltage across the motor at 100% duty cycle (V) */
+    double voltage;
+    /** Winding resistance (Ohm) */
+    double resistance;
+    /** Back-EMF constant, equal to the torque constant (V s / rad) */
+    double k_emf;
+    /** Rotor and gear train inertia on the encoder side (kg m^2) */
+    double inertia;
+    /** Coulomb friction torque (Nm) */
+    double friction;
+    /** Viscous friction (Nm s / rad) */
+    double damping;
+    /** Total play in the gear train between encoder and output (deg) */
+    double backlash;
+    /** Output shaft and load inertia (kg m^2) */
+    double load_inertia;
+    /** Constant external torque acting on the output (Nm) */
+    double load_torque;
+    /** Whether the output is blocked at min_angle and max_angle */
+    bool end_stops;
+    /** Lowest reachable output angle if end_stops is set (deg) */
+    double min_angle;
+    /** Highest reachable output angle if end_stops is set (deg) */
+    double max_angle;
+} pbdrv_motor_sim_settings_t;
+
+#if PBDRV_CONFIG_MOTOR_SIM
+
+pbio_error_t pbdrv_motor_sim_attach(pbio_port_t port, pbio_iodev_type_id_t id, int32_t angle);
+pbio_error_t pbdrv_motor_sim_get_settings(pbio_port_t port, pbdrv_motor_sim_settings_t **settings);
+pbio_error_t pbdrv_motor_sim_get_angle(pbio_port_t port, double *angle, double *speed);
+pbio_error_t pbdrv_motor_sim_get_output_angle(pbio_port_t port, double *angle);
+void pbdrv_motor_sim_update(void);
+
+#else // PBDRV_CONFIG_MOTOR_SIM
+
+static inline pbio_error_t pbdrv_motor_sim_attach(pbio_port_t port, pbio_iodev_type_id_t id, int32_t angle) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbdrv_motor_sim_get_settings(pbio_port_t port, pbdrv_motor_sim_settings_t **settings) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbdrv_motor_sim_get_angle(pbio_port_t port, double *angle, double *speed) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbdrv_motor_sim_get_output_angle(pbio_port_t port, double *angle) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline void pbdrv_motor_sim_update(void) {
+}
+
+#endif // PBDRV_CONFIG_MOTOR_SIM
+
+#endif // _PBDRV_SIM_MOTOR_SIM_H_
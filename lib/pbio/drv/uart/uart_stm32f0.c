@@ -34,6 +34,7 @@ typedef struct {
     uint8_t rx_ring_buf[UART_RING_BUF_SIZE];
     volatile uint8_t rx_ring_buf_head;
     uint8_t rx_ring_buf_tail;
+    bool rx_notified;
     uint8_t *rx_buf;
     uint8_t rx_buf_size;
     uint8_t rx_buf_index;
@@ -81,6 +82,8 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uin
     uart->rx_buf_size = length;
     uart->rx_buf_index = 0;
     uart->rx_result = PBIO_ERROR_AGAIN;
+    // bytes left over after this read are announced again
+    uart->rx_notified = false;
 
     etimer_set(&uart->rx_timer, clock_from_msec(timeout));
 
@@ -115,6 +118,28 @@ void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart_dev) {
     uart->rx_result = PBIO_ERROR_CANCELED;
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart_dev, uint8_t *buf, uint8_t size, uint8_t *length) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+
+    *length = 0;
+
+    if (uart->rx_buf) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    while (*length < size && uart->rx_ring_buf_head != uart->rx_ring_buf_tail) {
+        buf[(*length)++] = uart->rx_ring_buf[uart->rx_ring_buf_tail];
+        uart->rx_ring_buf_tail = (uart->rx_ring_buf_tail + 1) & (UART_RING_BUF_SIZE - 1);
+    }
+
+    // the buffer is empty, so announce the next byte that comes in
+    if (*length < size) {
+        uart->rx_notified = false;
+    }
+
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t length, uint32_t timeout) {
     pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
 
@@ -224,6 +249,11 @@ static void handle_poll() {
                     break;
                 }
             }
+        } else if (!uart->rx_buf && !uart->rx_notified && uart->rx_ring_buf_head != uart->rx_ring_buf_tail) {
+            // let pbdrv_uart_read_available() pick up the bytes, once until
+            // they have all been read
+            uart->rx_notified = true;
+            process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
         }
 
         if (uart->tx_buf && uart->tx_buf_index == uart->tx_buf_size) {
@@ -33,6 +33,8 @@ typedef struct {
     const pbdrv_uart_stm32f4_ll_irq_platform_data_t *pdata;
     /** Circular buffer for caching received bytes. */
     struct ringbuf rx_buf;
+    /** Whether waiting bytes were announced and not yet all read. */
+    bool rx_notified;
     /** Timer for read timeout. */
     struct etimer read_timer;
     /** Timer for write timeout. */
@@ -82,6 +84,8 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uin
     uart->read_buf = msg;
     uart->read_length = length;
     uart->read_pos = 0;
+    // bytes left over after this read are announced again
+    uart->rx_notified = false;
 
     etimer_set(&uart->read_timer, clock_from_msec(timeout));
 
@@ -109,6 +113,32 @@ void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart_dev) {
     // TODO
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart_dev, uint8_t *buf, uint8_t size, uint8_t *length) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+
+    *length = 0;
+
+    if (uart->read_buf) {
+        // Bytes belong to the read operation in progress.
+        return PBIO_ERROR_AGAIN;
+    }
+
+    while (*length < size) {
+        int c = ringbuf_get(&uart->rx_buf);
+        if (c == -1) {
+            break;
+        }
+        buf[(*length)++] = c;
+    }
+
+    // the buffer is empty, so announce the next byte that comes in
+    if (*length < size) {
+        uart->rx_notified = false;
+    }
+
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t length, uint32_t timeout) {
     pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
 
@@ -223,6 +253,12 @@ static void handle_poll() {
             process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
         }
 
+        // broadcast once when bytes start waiting for pbdrv_uart_read_available()
+        if (!uart->read_buf && !uart->rx_notified && ringbuf_elements(&uart->rx_buf)) {
+            uart->rx_notified = true;
+            process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
+        }
+
         // broadcast when write_buf is drained
         if (uart->write_buf && uart->write_pos == uart->write_length) {
             // clearing write_buf to prevent multiple broadcasts
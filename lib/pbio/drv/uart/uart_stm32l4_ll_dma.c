@@ -240,6 +240,40 @@ void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart_dev) {
     // TODO
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart_dev, uint8_t *buf, uint8_t size, uint8_t *length) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+    const pbdrv_uart_stm32l4_ll_dma_platform_data_t *pdata = uart->pdata;
+    uint32_t rx_head;
+
+    *length = 0;
+
+    if (uart->read_buf) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // head is the last position that DMA wrote to
+    rx_head = RX_DATA_SIZE - LL_DMA_GetDataLength(pdata->rx_dma, pdata->rx_dma_ch);
+
+    uint32_t available = (rx_head - uart->rx_tail) & (RX_DATA_SIZE - 1);
+    if (available > size) {
+        available = size;
+    }
+
+    // copy straight out of the DMA buffer, in two parts if it wraps around
+    uint32_t partial_size = RX_DATA_SIZE - uart->rx_tail;
+    if (available > partial_size) {
+        volatile_copy(&uart->rx_data[uart->rx_tail], &buf[0], partial_size);
+        volatile_copy(&uart->rx_data[0], &buf[partial_size], available - partial_size);
+    } else {
+        volatile_copy(&uart->rx_data[uart->rx_tail], &buf[0], available);
+    }
+
+    uart->rx_tail = (uart->rx_tail + available) & (RX_DATA_SIZE - 1);
+    *length = available;
+
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t length, uint32_t timeout) {
     pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
     const pbdrv_uart_stm32l4_ll_dma_platform_data_t *pdata = uart->pdata;
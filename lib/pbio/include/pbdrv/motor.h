@@ -87,6 +87,32 @@ static inline pbio_error_t pbdrv_motor_setup(pbio_port_t port, bool is_servo) {
 
 #endif
 
+#if PBDRV_CONFIG_MOTOR_BATCH
+
+/**
+ * Starts a batch of motor commands. Until ::pbdrv_motor_batch_commit is
+ * called, ::pbdrv_motor_coast and ::pbdrv_motor_set_duty_cycle check their
+ * arguments but defer the actual output.
+ */
+void pbdrv_motor_batch_begin(void);
+
+/**
+ * Applies all motor commands given since ::pbdrv_motor_batch_begin at once.
+ * @return              ::PBIO_SUCCESS if the call was successful,
+ *                      ::PBIO_ERROR_IO if there was an I/O error
+ */
+pbio_error_t pbdrv_motor_batch_commit(void);
+
+#else
+
+static inline void pbdrv_motor_batch_begin(void) {
+}
+static inline pbio_error_t pbdrv_motor_batch_commit(void) {
+    return PBIO_SUCCESS;
+}
+
+#endif
+
 #endif // _PBDRV_MOTOR_H_
 
 /** @}*/
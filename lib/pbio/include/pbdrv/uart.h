@@ -36,6 +36,21 @@ pbio_error_t pbdrv_uart_set_baud_rate(pbdrv_uart_dev_t *uart, uint32_t baud);
 pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout);
 pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart);
 void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart);
+
+/**
+ * Copies bytes that have already been received without waiting for more.
+ * This reads straight from the receive buffer of the driver, so it must not
+ * be used while a read started with pbdrv_uart_read_begin() is pending.
+ * Waiting bytes are announced with a single ::PROCESS_EVENT_COM, and the next
+ * one is only sent after this has returned fewer bytes than *size*.
+ * @param [in]  uart    The UART device
+ * @param [out] buf     Buffer to hold the received bytes
+ * @param [in]  size    Maximum number of bytes to copy to *buf*
+ * @param [out] length  Number of bytes that were copied
+ * @return              ::PBIO_SUCCESS if zero or more bytes were copied or
+ *                      ::PBIO_ERROR_AGAIN if another read is in progress.
+ */
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart, uint8_t *buf, uint8_t size, uint8_t *length);
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout);
 pbio_error_t pbdrv_uart_write_end(pbdrv_uart_dev_t *uart);
 void pbdrv_uart_write_cancel(pbdrv_uart_dev_t *uart);
@@ -57,6 +72,10 @@ static inline pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart) {
 }
 static inline void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart) {
 }
+static inline pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart, uint8_t *buf, uint8_t size, uint8_t *length) {
+    *length = 0;
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
 static inline pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
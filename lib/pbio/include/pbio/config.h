@@ -16,6 +16,51 @@
 #define PBIO_CONFIG_SERVO_PERIOD_MS (6)
 #endif
 
+// motors are polled by a separate control thread instead of pbio_do_one_event()
+#ifndef PBIO_CONFIG_MOTORPOLL_THREAD
+#define PBIO_CONFIG_MOTORPOLL_THREAD (0)
+#endif
+
+// shortest polling interval that servos may be configured to, if the hardware can keep up
+#ifndef PBIO_CONFIG_SERVO_PERIOD_MIN_MS
+#define PBIO_CONFIG_SERVO_PERIOD_MIN_MS (PBIO_CONFIG_SERVO_PERIOD_MS)
+#endif
+
+// polling interval for servos that are passive (holding servos keep their own period)
+#ifndef PBIO_CONFIG_SERVO_PERIOD_IDLE_MS
+#define PBIO_CONFIG_SERVO_PERIOD_IDLE_MS (20)
+#endif
+
+// number of angle targets that can be queued ahead of the ongoing maneuver
+#ifndef PBIO_CONFIG_CONTROL_QUEUE_SIZE
+#define PBIO_CONFIG_CONTROL_QUEUE_SIZE (8)
+#endif
+
+// number of drivebases that can run at the same time
+#ifndef PBIO_CONFIG_NUM_DRIVEBASES
+#define PBIO_CONFIG_NUM_DRIVEBASES (PBDRV_CONFIG_NUM_MOTOR_CONTROLLER / 2)
+#endif
+
+// number of waypoints in a drivebase path
+#ifndef PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+#define PBIO_CONFIG_DRIVEBASE_PATH_SIZE (16)
+#endif
+
+// number of servo groups that can run at the same time
+#ifndef PBIO_CONFIG_NUM_SERVOGROUPS
+#define PBIO_CONFIG_NUM_SERVOGROUPS (PBDRV_CONFIG_NUM_MOTOR_CONTROLLER / 2)
+#endif
+
+// maximum number of servos in one servo group
+#ifndef PBIO_CONFIG_SERVOGROUP_SIZE
+#define PBIO_CONFIG_SERVOGROUP_SIZE (4)
+#endif
+
+// number of samples kept per I/O device for filtering sensor data, 0 to disable
+#ifndef PBIO_CONFIG_IODEV_HISTORY_SIZE
+#define PBIO_CONFIG_IODEV_HISTORY_SIZE (0)
+#endif
+
 #ifndef PBIO_CONFIG_UARTDEV
 #define PBIO_CONFIG_UARTDEV (0)
 #endif
@@ -9,6 +9,7 @@
 
 #include <fixmath.h>
 
+#include <pbio/config.h>
 #include <pbio/error.h>
 #include <pbio/port.h>
 #include <pbio/trajectory.h>
@@ -27,6 +28,8 @@ typedef struct _pbio_control_settings_t {
     int32_t rate_tolerance;         /**< Allowed deviation (counts/s) from target speed. Hence, if speed target is zero, any speed below this tolerance is considered to be standstill. */
     int32_t count_tolerance;        /**< Allowed deviation (counts) from target before motion is considered complete */
     int32_t abs_acceleration;       /**< Encoder acceleration/deceleration rate when beginning to move or stopping. Positive value in counts per second per second */
+    int32_t abs_jerk;               /**< Rate of change of the acceleration in S-curve maneuvers, in counts per second cubed. Zero for trapezoidal maneuvers */
+    int32_t jerk;                   /**< The same jerk limit in user units, as it was set, so that it reads back unchanged */
     int16_t pid_kp;                 /**< Proportional position control constant (and integral speed control constant) */
     int16_t pid_ki;                 /**< Integral position control constant */
     int16_t pid_kd;                 /**< Derivative position control constant (and proportional speed control constant) */
@@ -53,11 +56,11 @@ typedef bool (*pbio_control_on_target_t)(pbio_trajectory_t *trajectory,
     bool stalled);
 
 // Functions to check whether motion is done
-pbio_control_on_target_t pbio_control_on_target_always;
-pbio_control_on_target_t pbio_control_on_target_never;
-pbio_control_on_target_t pbio_control_on_target_angle;
-pbio_control_on_target_t pbio_control_on_target_time;
-pbio_control_on_target_t pbio_control_on_target_stalled;
+extern pbio_control_on_target_t pbio_control_on_target_always;
+extern pbio_control_on_target_t pbio_control_on_target_never;
+extern pbio_control_on_target_t pbio_control_on_target_angle;
+extern pbio_control_on_target_t pbio_control_on_target_time;
+extern pbio_control_on_target_t pbio_control_on_target_stalled;
 
 typedef enum {
     PBIO_CONTROL_NONE,   /**< No control */
@@ -65,6 +68,15 @@ typedef enum {
     PBIO_CONTROL_ANGLE,  /**< Run to an angle */
 } pbio_control_type_t;
 
+/**
+ * Angle target queued to follow the ongoing angle maneuver
+ */
+typedef struct _pbio_control_waypoint_t {
+    int32_t count;  /**< Target count */
+    int32_t rate;   /**< Target rate towards the target count */
+    bool stop;      /**< Whether to stand still at the target count before moving on to the next */
+} pbio_control_waypoint_t;
+
 typedef struct _pbio_control_t {
     pbio_control_type_t type;
     pbio_control_settings_t settings;
@@ -75,6 +87,13 @@ typedef struct _pbio_control_t {
     pbio_control_on_target_t on_target_func;
     bool stalled;
     bool on_target;
+    int32_t time_prev;                  /**< Time of the previous update, to measure the update period */
+    bool stop_at_target;                /**< Whether the ongoing angle maneuver stands still at its target before the next one starts */
+    pbio_actuation_t queue_after_stop;  /**< What to do after the last queued maneuver */
+    pbio_error_t queue_err;             /**< Why the queue ended early, or ::PBIO_SUCCESS */
+    uint8_t queue_start;                /**< Index of the next queued waypoint */
+    uint8_t queue_size;                 /**< Number of queued waypoints */
+    pbio_control_waypoint_t queue[PBIO_CONFIG_CONTROL_QUEUE_SIZE];
 } pbio_control_t;
 
 // Convert control units (counts, rate) and physical user units (deg or mm, deg/s or mm/s)
@@ -83,6 +102,8 @@ int32_t pbio_control_user_to_counts(pbio_control_settings_t *s, int32_t user);
 
 void pbio_control_settings_get_limits(pbio_control_settings_t *s, int32_t *speed, int32_t *acceleration, int32_t *actuation);
 pbio_error_t pbio_control_settings_set_limits(pbio_control_settings_t *ctl, int32_t speed, int32_t acceleration, int32_t actuation);
+int32_t pbio_control_settings_get_jerk(pbio_control_settings_t *s);
+pbio_error_t pbio_control_settings_set_jerk(pbio_control_settings_t *s, int32_t jerk);
 
 void pbio_control_settings_get_pid(pbio_control_settings_t *s, int16_t *pid_kp, int16_t *pid_ki, int16_t *pid_kd, int32_t *integral_range, int32_t *integral_rate, int32_t *control_offset);
 pbio_error_t pbio_control_settings_set_pid(pbio_control_settings_t *s, int16_t pid_kp, int16_t pid_ki, int16_t pid_kd, int32_t integral_range, int32_t integral_rate, int32_t control_offset);
@@ -101,6 +122,8 @@ pbio_error_t pbio_control_start_angle_control(pbio_control_t *ctl, int32_t time_
 pbio_error_t pbio_control_start_relative_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t relative_target_count, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_actuation_t after_stop);
 pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, int32_t time_now, int32_t duration, int32_t count_now, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_control_on_target_t stop_func, pbio_actuation_t after_stop);
 pbio_error_t pbio_control_start_hold_control(pbio_control_t *ctl, int32_t time_now, int32_t target_count);
+bool pbio_control_queue_starts_now(pbio_control_t *ctl);
+pbio_error_t pbio_control_queue_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t target_count, int32_t rate_now, int32_t target_rate, bool stop, pbio_actuation_t after_stop);
 
 
 bool pbio_control_is_stalled(pbio_control_t *ctl);
@@ -4,10 +4,30 @@
 #ifndef _PBIO_DRIVEBASE_H_
 #define _PBIO_DRIVEBASE_H_
 
+#include <pbio/config.h>
+#include <pbio/odometry.h>
 #include <pbio/servo.h>
 
 #if PBDRV_CONFIG_NUM_MOTOR_CONTROLLER != 0
 
+// Point on a path, in the frame of the drivebase pose (mm)
+typedef struct _pbio_drivebase_waypoint_t {
+    int32_t x;
+    int32_t y;
+} pbio_drivebase_waypoint_t;
+
+// Path that the drivebase follows with pure pursuit
+typedef struct _pbio_drivebase_path_t {
+    pbio_drivebase_waypoint_t waypoints[PBIO_CONFIG_DRIVEBASE_PATH_SIZE];
+    pbio_drivebase_waypoint_t start; // Where the first segment starts
+    uint8_t size; // Number of waypoints, or 0 if not following a path
+    uint8_t index; // Waypoint at the end of the current segment
+    int32_t speed; // Drive speed (mm/s)
+    int32_t acceleration; // Drive acceleration at the end of the path (mm/s^2)
+    int32_t lookahead; // Distance to the point on the path that we steer towards (mm)
+    int32_t turn_rate; // Turn rate of the current heading trajectory (deg/s)
+} pbio_drivebase_path_t;
+
 typedef struct _pbio_drivebase_t {
     pbio_servo_t *left;
     pbio_servo_t *right;
@@ -16,10 +36,13 @@ typedef struct _pbio_drivebase_t {
     pbio_log_t log;
     pbio_control_t control_heading;
     pbio_control_t control_distance;
+    pbio_odometry_t odometry;
+    pbio_drivebase_path_t path;
+    uint32_t maneuver; // Counts up each time a command replaces the ongoing maneuver
 } pbio_drivebase_t;
 
 pbio_error_t pbio_drivebase_setup(pbio_drivebase_t *db, pbio_servo_t *left, pbio_servo_t *right, fix16_t wheel_diameter, fix16_t axle_track);
-pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db);
+pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db, int32_t time_now, int32_t count_left, int32_t rate_left, int32_t count_right, int32_t rate_right);
 void pbio_drivebase_claim_servos(pbio_drivebase_t *db, bool claim);
 
 // Finite point to point control
@@ -28,6 +51,10 @@ pbio_error_t pbio_drivebase_straight(pbio_drivebase_t *db, int32_t distance, int
 
 pbio_error_t pbio_drivebase_turn(pbio_drivebase_t *db, int32_t angle, int32_t turn_rate, int32_t turn_acceleration);
 
+// Continuous driving along waypoints
+
+pbio_error_t pbio_drivebase_follow_path(pbio_drivebase_t *db, const pbio_drivebase_waypoint_t *waypoints, uint8_t size, int32_t speed, int32_t acceleration, int32_t lookahead);
+
 // Infinite driving
 
 pbio_error_t pbio_drivebase_drive(pbio_drivebase_t *db, int32_t speed, int32_t turn_rate);
@@ -9,6 +9,8 @@
 
 #include <lego_uart.h>
 
+#include "pbio/config.h"
+#include "pbio/error.h"
 #include "pbio/port.h"
 
 /**
@@ -356,6 +358,30 @@ typedef struct {
     pbio_iodev_mode_t mode_info[0];
 } pbio_iodev_info_t;
 
+/**
+ * Filters that can be applied to the history of an I/O device.
+ */
+typedef enum {
+    /**
+     * Mean of the samples.
+     */
+    PBIO_IODEV_FILTER_AVERAGE,
+    /**
+     * Middle value of the sorted samples. This rejects single outliers.
+     */
+    PBIO_IODEV_FILTER_MEDIAN,
+    /**
+     * Exponentially weighted average, from the oldest to the newest sample.
+     */
+    PBIO_IODEV_FILTER_EXPONENTIAL,
+} pbio_iodev_filter_t;
+
+/**
+ * Maps a raw sample to a value that can be filtered, such as a reading that
+ * means "out of range" to the end of the range.
+ */
+typedef int32_t (*pbio_iodev_normalize_t)(int32_t value);
+
 /**
  * Data structure for holding an I/O device's state.
  */
@@ -368,6 +394,7 @@ typedef struct _pbio_iodev_t pbio_iodev_t;
  */
 typedef struct {
     pbio_error_t (*set_mode_begin)(pbio_iodev_t *iodev, uint8_t mode);
+    pbio_error_t (*set_mode_combo_begin)(pbio_iodev_t *iodev, uint16_t required, uint16_t optional);
     pbio_error_t (*set_mode_end)(pbio_iodev_t *iodev);
     void (*set_mode_cancel)(pbio_iodev_t *iodev);
     pbio_error_t (*set_data_begin)(pbio_iodev_t *iodev, const uint8_t *data);
@@ -395,10 +422,47 @@ struct _pbio_iodev_t {
      * The current active mode.
      */
     uint8_t mode;
+    /**
+     * Bit flags of the modes that the device currently sends together in
+     * one combined data message. Each bit cooresponds to the mode of the same
+     * number (0 to 15). Changing to one of these modes takes effect right
+     * away, since the data for it is already up to date.
+     */
+    uint16_t combo_modes;
     /**
      * Motor capability flags.
      */
     pbio_iodev_motor_flags_t motor_flags;
+    /**
+     * Number of data messages received so far. This increases by one for every
+     * message, so it tells a new sample apart from the same one read twice.
+     */
+    uint32_t sample_count;
+    /**
+     * Time at which the most recent data message was received, as given by
+     * clock_usecs().
+     */
+    uint32_t sample_time;
+    #if PBIO_CONFIG_IODEV_HISTORY_SIZE
+    /**
+     * Ring buffer of the first value of the most recent samples of
+     * *history_mode*.
+     */
+    int32_t history[PBIO_CONFIG_IODEV_HISTORY_SIZE];
+    /**
+     * Index in *history* where the next sample goes.
+     */
+    uint8_t history_head;
+    /**
+     * Number of valid samples in *history*.
+     */
+    uint8_t history_len;
+    /**
+     * The mode of the samples in *history*. This need not be the current
+     * mode, as long as the device keeps sending it in combined data.
+     */
+    uint8_t history_mode;
+    #endif
     /**
      * Most recent binary data read from the device. How to interpret this data
      * is determined by the ::pbio_iodev_mode_t info associated with the current
@@ -413,9 +477,12 @@ struct _pbio_iodev_t {
 size_t pbio_iodev_size_of(pbio_iodev_data_type_t type);
 pbio_error_t pbio_iodev_get_data_format(pbio_iodev_t *iodev, uint8_t mode, uint8_t *len, pbio_iodev_data_type_t *type);
 pbio_error_t pbio_iodev_get_data(pbio_iodev_t *iodev, uint8_t **data);
+pbio_error_t pbio_iodev_get_sample(pbio_iodev_t *iodev, uint32_t *count, uint32_t *time);
+pbio_error_t pbio_iodev_wait_sample(pbio_iodev_t *iodev, uint32_t count);
 pbio_error_t pbio_iodev_set_mode_begin(pbio_iodev_t *iodev, uint8_t mode);
 pbio_error_t pbio_iodev_set_mode_end(pbio_iodev_t *iodev);
 void pbio_iodev_set_mode_cancel(pbio_iodev_t *iodev);
+pbio_error_t pbio_iodev_set_mode_combo_begin(pbio_iodev_t *iodev, uint16_t required, uint16_t optional);
 pbio_error_t pbio_iodev_set_data_begin(pbio_iodev_t *iodev, uint8_t mode, const uint8_t *data);
 pbio_error_t pbio_iodev_set_data_end(pbio_iodev_t *iodev);
 void pbio_iodev_set_data_cancel(pbio_iodev_t *iodev);
@@ -423,4 +490,26 @@ pbio_error_t pbio_iodev_write_begin(pbio_iodev_t *iodev, const uint8_t *data, ui
 pbio_error_t pbio_iodev_write_end(pbio_iodev_t *iodev);
 void pbio_iodev_write_cancel(pbio_iodev_t *iodev);
 
+#if PBIO_CONFIG_IODEV_HISTORY_SIZE
+
+void pbio_iodev_set_history_mode(pbio_iodev_t *iodev, uint8_t mode);
+void pbio_iodev_history_push(pbio_iodev_t *iodev, uint8_t mode, const uint8_t *data);
+pbio_error_t pbio_iodev_get_history(pbio_iodev_t *iodev, int32_t *values, uint8_t *n);
+pbio_error_t pbio_iodev_get_filtered(pbio_iodev_t *iodev, pbio_iodev_filter_t filter, uint8_t n, int32_t weight, pbio_iodev_normalize_t normalize, int32_t *value);
+
+#else // PBIO_CONFIG_IODEV_HISTORY_SIZE
+
+static inline void pbio_iodev_set_history_mode(pbio_iodev_t *iodev, uint8_t mode) {
+}
+static inline void pbio_iodev_history_push(pbio_iodev_t *iodev, uint8_t mode, const uint8_t *data) {
+}
+static inline pbio_error_t pbio_iodev_get_history(pbio_iodev_t *iodev, int32_t *values, uint8_t *n) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbio_iodev_get_filtered(pbio_iodev_t *iodev, pbio_iodev_filter_t filter, uint8_t n, int32_t weight, pbio_iodev_normalize_t normalize, int32_t *value) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
+#endif // PBIO_CONFIG_IODEV_HISTORY_SIZE
+
 #endif // _PBIO_IODEV_H_
@@ -5,6 +5,7 @@
 #define _PBIO_LOGGER_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <pbio/error.h>
@@ -15,10 +16,32 @@
 // Maximum number of values to be logged per sample
 #define MAX_LOG_VALUES (20)
 
+// First byte of each binary log frame
+#define PBIO_LOG_FRAME_SYNC (0xA5)
+
+// Size of a binary log frame header: sync, number of values, and overrun count
+#define PBIO_LOG_FRAME_HEADER_SIZE (4)
+
+// Maximum size of a binary log frame
+#define PBIO_LOG_FRAME_SIZE_MAX (PBIO_LOG_FRAME_HEADER_SIZE + MAX_LOG_VALUES * sizeof(int32_t))
+
+// Version of the packed log format, stored in its header
+#define PBIO_LOG_PACKED_VERSION (1)
+
+// Size of the packed log header: "PBLG", version, number of values, and delta mask
+#define PBIO_LOG_PACKED_HEADER_SIZE (10)
+
 typedef struct _pbio_log_t {
     bool active;
+    bool ring; // Whether to keep logging when full, dropping new samples until rows are popped
+    bool packed; // Whether rows are stored packed, as variable width deltas
+    uint32_t delta_mask; // Columns that are packed as the difference with the previous row
+    uint32_t size; // Bytes used by packed rows
+    int32_t prev[MAX_LOG_VALUES]; // Most recent row, used for packing
     uint32_t skipped;
-    uint32_t sampled;
+    uint32_t sampled; // Rows written so far. Only the producer (the control loop) writes this.
+    uint32_t consumed; // Rows popped so far. Only the consumer writes this.
+    uint32_t overruns; // Samples dropped because the ring was full
     uint32_t len;
     int32_t start;
     uint8_t num_values;
@@ -27,10 +50,16 @@ typedef struct _pbio_log_t {
 } pbio_log_t;
 
 void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div);
+void pbio_logger_start_ring(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div);
+void pbio_logger_start_packed(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div);
+size_t pbio_logger_get_packed(pbio_log_t *log, uint8_t *header, const uint8_t **data);
 pbio_error_t pbio_logger_read(pbio_log_t *log, int32_t sindex, int32_t *buf);
+pbio_error_t pbio_logger_pop(pbio_log_t *log, int32_t *buf);
+pbio_error_t pbio_logger_pop_frame(pbio_log_t *log, uint8_t *frame, size_t *size);
 pbio_error_t pbio_logger_update(pbio_log_t *log, int32_t *buf);
 int32_t pbio_logger_rows(pbio_log_t *log);
 int32_t pbio_logger_cols(pbio_log_t *log);
+uint32_t pbio_logger_overruns(pbio_log_t *log);
 void pbio_logger_stop(pbio_log_t *log);
 
 #endif // _PBIO_LOGGER_H_
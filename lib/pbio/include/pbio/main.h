@@ -4,10 +4,18 @@
 #ifndef _PBIO_MAIN_H_
 #define _PBIO_MAIN_H_
 
+#include <stdint.h>
+
 #include "pbio/config.h"
 
 void pbio_init(void);
 void pbio_stop_all(void);
 int pbio_do_one_event(void);
+uint32_t pbio_get_event_timeout(void);
+uint32_t pbio_get_missed_deadlines(void);
+
+#if PBIO_CONFIG_MOTORPOLL_THREAD
+void pbio_add_missed_deadlines(uint32_t count);
+#endif
 
 #endif // _PBIO_MAIN_H_
@@ -13,4 +13,9 @@ int32_t pbio_math_div_i32_fix16(int32_t a, fix16_t b);
 int32_t pbio_math_mul_i32_fix16(int32_t a, fix16_t b);
 int32_t pbio_math_sqrt(int32_t n);
 
+// Sine and cosine of an angle in millidegrees, scaled by PBIO_MATH_TRIG_ONE
+#define PBIO_MATH_TRIG_ONE (1 << 30)
+int32_t pbio_math_sin(int32_t angle);
+int32_t pbio_math_cos(int32_t angle);
+
 #endif // _PBIO_MATH_H_
@@ -4,22 +4,37 @@
 #ifndef _PBIO_MOTORPOLL_H_
 #define _PBIO_MOTORPOLL_H_
 
+#include <stdbool.h>
+
+#include <pbio/config.h>
 #include <pbio/drivebase.h>
 #include <pbio/error.h>
 #include <pbio/servo.h>
+#include <pbio/servogroup.h>
 
 #if PBDRV_CONFIG_NUM_MOTOR_CONTROLLER != 0
 
 pbio_error_t pbio_motorpoll_get_servo(pbio_port_t port, pbio_servo_t **srv);
 pbio_error_t pbio_motorpoll_get_servo_status(pbio_servo_t *srv);
 pbio_error_t pbio_motorpoll_set_servo_status(pbio_servo_t *srv, pbio_error_t err);
+pbio_error_t pbio_motorpoll_get_servo_period(pbio_servo_t *srv, int32_t *period);
+pbio_error_t pbio_motorpoll_set_servo_period(pbio_servo_t *srv, int32_t period);
 
 pbio_error_t pbio_motorpoll_get_drivebase(pbio_drivebase_t **db);
 pbio_error_t pbio_motorpoll_get_drivebase_status(pbio_drivebase_t *db);
 pbio_error_t pbio_motorpoll_set_drivebase_status(pbio_drivebase_t *db, pbio_error_t err);
+pbio_error_t pbio_motorpoll_get_drivebase_period(pbio_drivebase_t *db, int32_t *period);
+pbio_error_t pbio_motorpoll_set_drivebase_period(pbio_drivebase_t *db, int32_t period);
+
+pbio_error_t pbio_motorpoll_get_servogroup(pbio_servogroup_t **grp);
+pbio_error_t pbio_motorpoll_get_servogroup_status(pbio_servogroup_t *grp);
+pbio_error_t pbio_motorpoll_set_servogroup_status(pbio_servogroup_t *grp, pbio_error_t err);
+pbio_error_t pbio_motorpoll_get_servogroup_period(pbio_servogroup_t *grp, int32_t *period);
+pbio_error_t pbio_motorpoll_set_servogroup_period(pbio_servogroup_t *grp, int32_t period);
 
 void _pbio_motorpoll_reset_all(void);
 void _pbio_motorpoll_poll(void);
+bool _pbio_motorpoll_is_active(void);
 
 #else
 
@@ -27,7 +42,27 @@ static inline void _pbio_motorpoll_reset_all(void) {
 }
 static inline void _pbio_motorpoll_poll(void) {
 }
+static inline bool _pbio_motorpoll_is_active(void) {
+    return false;
+}
 
 #endif // PBDRV_CONFIG_NUM_MOTOR_CONTROLLER
 
+#if PBIO_CONFIG_MOTORPOLL_THREAD
+
+// The platform that runs the control thread provides the lock that it holds
+// while polling. Everything else must hold it to use servos, drivebases,
+// servo groups, or their controllers and logs.
+void pbio_motorpoll_lock(void);
+void pbio_motorpoll_unlock(void);
+
+#else
+
+static inline void pbio_motorpoll_lock(void) {
+}
+static inline void pbio_motorpoll_unlock(void) {
+}
+
+#endif // PBIO_CONFIG_MOTORPOLL_THREAD
+
 #endif // _PBIO_MOTORPOLL_H_
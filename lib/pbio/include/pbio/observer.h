@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef _PBIO_OBSERVER_H_
+#define _PBIO_OBSERVER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * State observer that estimates the rate and acceleration of a motor from
+ * its encoder count and the applied duty cycle.
+ *
+ * It predicts the motion with a first order motor model, and corrects the
+ * prediction with the measured count, alpha-beta-gamma style. What the model
+ * does not explain, such as load and friction, ends up in the disturbance.
+ */
+typedef struct _pbio_observer_t {
+    bool running; // Whether the estimates below are valid
+    int32_t time_prev; // Time of the previous update (us)
+    int32_t count; // Estimated count
+    int32_t count_ext; // Estimated count fraction (millicounts)
+    int32_t rate; // Estimated rate (millicounts/s)
+    int32_t disturbance; // Acceleration not explained by the model (millicounts/s^2)
+    int32_t acceleration; // Estimated acceleration (millicounts/s^2)
+    int32_t rate_max; // Steady state rate at maximum duty (counts/s), or 0 if there is no model
+    int32_t time_constant; // Time to reach 63% of the steady state rate (ms)
+} pbio_observer_t;
+
+void pbio_observer_set_model(pbio_observer_t *obs, int32_t rate_max, int32_t time_constant);
+
+void pbio_observer_reset(pbio_observer_t *obs, int32_t time_now, int32_t count, int32_t rate);
+
+void pbio_observer_update(pbio_observer_t *obs, int32_t time_now, int32_t count, int32_t rate, int32_t duty);
+
+void pbio_observer_get_estimated_state(pbio_observer_t *obs, int32_t *count, int32_t *rate, int32_t *acceleration);
+
+#endif // _PBIO_OBSERVER_H_
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef _PBIO_ODOMETRY_H_
+#define _PBIO_ODOMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <fixmath.h>
+
+/**
+ * Position and heading of a drivebase, integrated from the sum and difference
+ * of its wheel encoder counts on every control update.
+ *
+ * The heading follows the drivebase angle, so it is positive clockwise. The
+ * x axis points forward and the y axis points to the right at heading zero.
+ * An external heading, such as from a gyro, can be fused into the estimate.
+ */
+typedef struct _pbio_odometry_t {
+    bool running; // Whether the previous count below is valid
+    fix16_t counts_per_mm; // Sum of counts for every mm forward
+    fix16_t counts_per_degree; // Difference of counts for every degree of rotation
+    int32_t sum_prev; // Sum of counts at the previous update
+    int32_t heading_offset; // Heading at zero count difference (millidegrees)
+    int32_t heading; // Heading (millidegrees)
+    int64_t x; // Position along the x axis (nanometers)
+    int64_t y; // Position along the y axis (nanometers)
+} pbio_odometry_t;
+
+void pbio_odometry_setup(pbio_odometry_t *odo, fix16_t counts_per_mm, fix16_t counts_per_degree);
+
+void pbio_odometry_update(pbio_odometry_t *odo, int32_t sum, int32_t dif);
+
+void pbio_odometry_fuse_heading(pbio_odometry_t *odo, int32_t heading, int32_t weight);
+
+void pbio_odometry_get_pose(pbio_odometry_t *odo, int32_t *x, int32_t *y, int32_t *heading);
+
+void pbio_odometry_set_pose(pbio_odometry_t *odo, int32_t x, int32_t y, int32_t heading);
+
+#endif // _PBIO_ODOMETRY_H_
@@ -27,6 +27,7 @@
 
 typedef struct _pbio_servo_t {
     bool claimed;
+    uint32_t maneuver; // Counts up each time a command replaces the ongoing maneuver
     pbio_dcmotor_t *dcmotor;
     pbio_tacho_t *tacho;
     pbio_control_t control;
@@ -34,6 +35,8 @@ typedef struct _pbio_servo_t {
     pbio_log_t log;
 } pbio_servo_t;
 
+void pbio_servo_get_model(pbio_iodev_type_id_t id, int32_t *rate_max, int32_t *time_constant);
+
 pbio_error_t pbio_servo_setup(pbio_servo_t *srv, pbio_direction_t direction, fix16_t gear_ratio);
 
 pbio_error_t pbio_servo_reset_angle(pbio_servo_t *srv, int32_t reset_angle, bool reset_to_abs);
@@ -49,9 +52,11 @@ pbio_error_t pbio_servo_run_time(pbio_servo_t *srv, int32_t speed, int32_t durat
 pbio_error_t pbio_servo_run_until_stalled(pbio_servo_t *srv, int32_t speed, pbio_actuation_t after_stop);
 pbio_error_t pbio_servo_run_angle(pbio_servo_t *srv, int32_t speed, int32_t angle, pbio_actuation_t after_stop);
 pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_actuation_t after_stop);
+pbio_error_t pbio_servo_queue_target(pbio_servo_t *srv, int32_t speed, int32_t target, bool stop, pbio_actuation_t after_stop);
 pbio_error_t pbio_servo_track_target(pbio_servo_t *srv, int32_t target);
 
-pbio_error_t pbio_servo_control_update(pbio_servo_t *srv);
+pbio_error_t pbio_servo_get_state(pbio_servo_t *srv, int32_t time_now, int32_t *count_now, int32_t *rate_now);
+pbio_error_t pbio_servo_control_update(pbio_servo_t *srv, int32_t time_now, int32_t count_now, int32_t rate_now);
 
 #endif // PBDRV_CONFIG_NUM_MOTOR_CONTROLLER
 
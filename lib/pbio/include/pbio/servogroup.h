@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef _PBIO_SERVOGROUP_H_
+#define _PBIO_SERVOGROUP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pbio/config.h>
+#include <pbio/servo.h>
+
+#if PBDRV_CONFIG_NUM_MOTOR_CONTROLLER != 0
+
+/**
+ * Servos that are controlled together. Each axis of the group is a weighted
+ * sum of the servo angles, given by a row of the mixing matrix. Each axis has
+ * its own controller, and the control signal of each axis is distributed
+ * back over the servos with the same weights.
+ *
+ * A drivebase is the special case of two servos with the axes [1, 1] (sum)
+ * and [1, -1] (difference).
+ */
+typedef struct _pbio_servogroup_t {
+    uint8_t size;
+    pbio_servo_t *servos[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int8_t mix[PBIO_CONFIG_SERVOGROUP_SIZE][PBIO_CONFIG_SERVOGROUP_SIZE];
+    pbio_log_t log;
+    pbio_control_t control[PBIO_CONFIG_SERVOGROUP_SIZE];
+    uint32_t maneuver; // Counts up each time a command replaces the ongoing maneuver
+} pbio_servogroup_t;
+
+pbio_error_t pbio_servogroup_setup(pbio_servogroup_t *grp, pbio_servo_t **servos, uint8_t size, const int8_t *mix);
+pbio_error_t pbio_servogroup_update(pbio_servogroup_t *grp, int32_t time_now, const int32_t *count, const int32_t *rate);
+void pbio_servogroup_claim_servos(pbio_servogroup_t *grp, bool claim);
+bool pbio_servogroup_is_done(pbio_servogroup_t *grp);
+bool pbio_servogroup_is_passive(pbio_servogroup_t *grp);
+
+pbio_error_t pbio_servogroup_run(pbio_servogroup_t *grp, uint8_t axis, int32_t speed);
+pbio_error_t pbio_servogroup_run_target(pbio_servogroup_t *grp, uint8_t axis, int32_t speed, int32_t target, pbio_actuation_t after_stop);
+pbio_error_t pbio_servogroup_stop(pbio_servogroup_t *grp, pbio_actuation_t after_stop);
+pbio_error_t pbio_servogroup_stop_force(pbio_servogroup_t *grp);
+
+pbio_error_t pbio_servogroup_get_state(pbio_servogroup_t *grp, uint8_t axis, int32_t *angle, int32_t *speed);
+
+#endif // PBDRV_CONFIG_NUM_MOTOR_CONTROLLER
+
+#endif // _PBIO_SERVOGROUP_H_
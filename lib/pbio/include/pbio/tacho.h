@@ -11,6 +11,7 @@
 #include <pbio/config.h>
 #include <pbdrv/counter.h>
 #include <pbio/dcmotor.h>
+#include <pbio/observer.h>
 
 typedef struct _pbio_tacho_t pbio_tacho_t;
 
@@ -24,6 +25,10 @@ pbio_error_t pbio_tacho_reset_angle(pbio_tacho_t *tacho, int32_t reset_angle, bo
 pbio_error_t pbio_tacho_get_rate(pbio_tacho_t *tacho, int32_t *encoder_rate);
 pbio_error_t pbio_tacho_get_angular_rate(pbio_tacho_t *tacho, int32_t *angular_rate);
 
+pbio_error_t pbio_tacho_set_model(pbio_tacho_t *tacho, int32_t rate_max, int32_t time_constant);
+pbio_error_t pbio_tacho_get_state(pbio_tacho_t *tacho, int32_t time_now, int32_t duty, int32_t *count, int32_t *rate);
+pbio_error_t pbio_tacho_get_estimated_state(pbio_tacho_t *tacho, int32_t *rate, int32_t *acceleration);
+
 #else
 
 static inline pbio_error_t pbio_tacho_get(pbio_port_t port, pbio_tacho_t **tacho, pbio_direction_t direction, fix16_t gear_ratio) {
@@ -46,6 +51,16 @@ static inline pbio_error_t pbio_tacho_get_angular_rate(pbio_tacho_t *tacho, int3
     return PBIO_ERROR_NOT_SUPPORTED;
 }
 
+static inline pbio_error_t pbio_tacho_set_model(pbio_tacho_t *tacho, int32_t rate_max, int32_t time_constant) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbio_tacho_get_state(pbio_tacho_t *tacho, int32_t time_now, int32_t duty, int32_t *count, int32_t *rate) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbio_tacho_get_estimated_state(pbio_tacho_t *tacho, int32_t *rate, int32_t *acceleration) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
 #endif // PBIO_CONFIG_TACHO
 
 #endif // _PBIO_TACHO_H_
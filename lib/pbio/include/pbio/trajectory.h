@@ -29,10 +29,36 @@
 // Macro to evaluate division of speed by acceleration (w/a), yielding time, in the appropriate units
 #define wdiva(w, a) ((((w) * US_PER_MS) / a) * MS_PER_SECOND)
 
+/**
+ * Shape of the speed profile of a trajectory
+ */
+typedef enum {
+    PBIO_TRAJECTORY_TYPE_TRAPEZOID,     /**< Constant acceleration, with steps in acceleration */
+    PBIO_TRAJECTORY_TYPE_S_CURVE,       /**< Acceleration that ramps up and down with limited jerk */
+} pbio_trajectory_type_t;
+
+/**
+ * Segments of a trajectory
+ */
+typedef enum {
+    PBIO_TRAJECTORY_PHASE_NONE,         /**< No reference has been evaluated yet */
+    PBIO_TRAJECTORY_PHASE_ACCELERATE,   /**< From t0 to t1 */
+    PBIO_TRAJECTORY_PHASE_CONSTANT,     /**< From t1 to t2, or forever */
+    PBIO_TRAJECTORY_PHASE_DECELERATE,   /**< From t2 to t3 */
+    PBIO_TRAJECTORY_PHASE_HOLD,         /**< After t3 */
+} pbio_trajectory_phase_t;
+
 /**
  * Motor trajectory parameters for an ideal maneuver without disturbances
+ *
+ * S-curve trajectories follow the average position of the trapezoid below
+ * over the last tj microseconds. This ramps each change of acceleration over
+ * tj, so they end tj later than the trapezoid, at t3 + tj.
  */
 typedef struct _pbio_trajectory_t {
+    pbio_trajectory_type_t type;        /**<  Shape of the speed profile, kept when making new trajectories */
+    int32_t jerk;                        /**<  Encoder jerk for S-curve trajectories */
+    int32_t tj;                          /**<  Duration of each jerk phase for S-curve trajectories, or 0 */
     bool forever;                       /**<  Whether maneuver has end-point */
     int32_t t0;                        /**<  Time at start of maneuver */
     int32_t t1;                        /**<  Time after the acceleration in-phase */
@@ -50,10 +76,22 @@ typedef struct _pbio_trajectory_t {
     int32_t w1;                          /**<  Encoder rate target when not accelerating */
     int32_t a0;                          /**<  Encoder acceleration during in-phase */
     int32_t a2;                          /**<  Encoder acceleration during out-phase */
+    pbio_trajectory_phase_t cache_phase; /**<  Phase of the last evaluated reference, or none if the trajectory changed */
+    int32_t cache_time;                  /**<  Time of the last evaluated reference */
+    int32_t cache_count;                 /**<  Last evaluated reference count */
+    int32_t cache_count_ext;             /**<  As above, but additional millicounts */
+    int32_t cache_rate;                  /**<  Last evaluated reference rate */
+    int32_t cache_acceleration;          /**<  Last evaluated reference acceleration */
+    int64_t cache_dist;                  /**<  Constant speed phase: floor(w1 * (time - t1) / 1000) */
+    int32_t cache_dist_rem;              /**<  Constant speed phase: remainder of the above, 0 to 999 */
+    int32_t cache_mcount_div;            /**<  Constant speed phase: reference millicount floor divided by 1000 */
+    int32_t cache_mcount_rem;            /**<  Constant speed phase: remainder of the above, 0 to 999 */
 } pbio_trajectory_t;
 
 // Core trajectory generators
 
+void pbio_trajectory_set_type(pbio_trajectory_t *ref, pbio_trajectory_type_t type, int32_t jerk);
+
 void pbio_trajectory_make_stationary(pbio_trajectory_t *ref, int32_t t0, int32_t th0);
 
 pbio_error_t pbio_trajectory_make_time_based(pbio_trajectory_t *ref, int32_t t0, int32_t duration, int32_t th0, int32_t th0_ext, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax);
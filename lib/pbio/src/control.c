@@ -9,6 +9,85 @@
 #include <pbio/trajectory.h>
 #include <pbio/integrator.h>
 
+static pbio_error_t start_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t target_count, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_actuation_t after_stop);
+
+// Ends the queue after the ongoing maneuver, because the next one could not be started
+static void control_abort_queue(pbio_control_t *ctl, pbio_error_t err) {
+    ctl->queue_size = 0;
+    ctl->queue_err = err;
+    ctl->stop_at_target = true;
+    ctl->after_stop = ctl->queue_after_stop;
+}
+
+// Starts the next queued angle maneuver once the ongoing one is far enough along
+static void control_update_queue(pbio_control_t *ctl, int32_t time_now, int32_t time_ref, int32_t count_now, int32_t rate_now) {
+
+    if (ctl->queue_size == 0 || ctl->type != PBIO_CONTROL_ANGLE) {
+        return;
+    }
+
+    pbio_trajectory_t *ref = &ctl->trajectory;
+    pbio_control_waypoint_t *next = &ctl->queue[ctl->queue_start];
+    int32_t acceleration = ctl->settings.abs_acceleration;
+
+    // The next maneuver continues in the same direction if the ongoing one
+    // is stationary or moves towards the next target.
+    bool forward = ref->th3 - ref->th0 >= 0;
+    bool same_direction = forward ? next->count - ref->th3 >= 0 : next->count - ref->th3 <= 0;
+
+    // Blending requires enough distance to decelerate from the current speed
+    bool can_blend = same_direction && ((int64_t)ref->w1 * ref->w1) / (2 * acceleration) <= abs(next->count - ref->th2);
+
+    pbio_error_t err;
+    if (!ctl->stop_at_target && can_blend) {
+        // Wait until the ongoing maneuver would start decelerating
+        if (time_ref - ref->t2 < 0) {
+            return;
+        }
+        // Continue at the current speed from the start of the deceleration phase,
+        // so that the reference position and speed have no discontinuities.
+        // The blend is made on a copy, so a failure leaves the ongoing maneuver intact.
+        int32_t count_ref, count_ref_ext, rate_ref, acceleration_ref;
+        pbio_trajectory_get_reference(ref, ref->t2, &count_ref, &count_ref_ext, &rate_ref, &acceleration_ref);
+        pbio_trajectory_t blend = *ref;
+        err = pbio_trajectory_make_angle_based(&blend, ref->t2, count_ref, next->count, rate_ref, next->rate, ctl->settings.max_rate, acceleration, acceleration);
+        if (err == PBIO_SUCCESS) {
+            *ref = blend;
+        }
+    } else {
+        // Otherwise wait for the motor to stand still at the target
+        if (!ctl->on_target) {
+            return;
+        }
+        err = start_angle_control(ctl, time_now, count_now, next->count, rate_now, next->rate, acceleration, ctl->after_stop);
+    }
+
+    // If the next maneuver can't be started, finish the ongoing one as the last
+    if (err != PBIO_SUCCESS) {
+        control_abort_queue(ctl, err);
+        return;
+    }
+
+    // Move on to the next waypoint, keeping position control for all but the last
+    ctl->queue_start = (ctl->queue_start + 1) % PBIO_CONFIG_CONTROL_QUEUE_SIZE;
+    ctl->queue_size--;
+    ctl->stop_at_target = next->stop;
+    ctl->after_stop = ctl->queue_size ? PBIO_ACTUATION_HOLD : ctl->queue_after_stop;
+    ctl->on_target = false;
+    ctl->on_target_func = pbio_control_on_target_angle;
+}
+
+// Gets the time (ms) since the previous update. If there was no recent
+// update, such as when a maneuver begins, assume the default servo period.
+static int32_t control_get_loop_time(pbio_control_t *ctl, int32_t time_now) {
+    int32_t loop_time = (time_now - ctl->time_prev + US_PER_MS / 2) / US_PER_MS;
+    ctl->time_prev = time_now;
+    if (loop_time < PBIO_CONFIG_SERVO_PERIOD_MIN_MS || loop_time > PBIO_CONFIG_SERVO_PERIOD_IDLE_MS) {
+        return PBIO_CONFIG_SERVO_PERIOD_MS;
+    }
+    return loop_time;
+}
+
 void control_update(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t rate_now, pbio_actuation_t *actuation_type, int32_t *control) {
 
     // Declare current time, positions, rates, and their reference value and error
@@ -22,6 +101,9 @@ void control_update(pbio_control_t *ctl, int32_t time_now, int32_t count_now, in
     // This compensates for any time we may have spent pausing when the motor was stalled.
     time_ref = pbio_control_get_ref_time(ctl, time_now);
 
+    // Move on to queued maneuvers if it is time to do so
+    control_update_queue(ctl, time_now, time_ref, count_now, rate_now);
+
     // Get reference signals
     pbio_trajectory_get_reference(&ctl->trajectory, time_ref, &count_ref, &count_ref_ext, &rate_ref, &acceleration_ref);
 
@@ -55,7 +137,9 @@ void control_update(pbio_control_t *ctl, int32_t time_now, int32_t count_now, in
     // We want to stop building up further errors if we are at the proportional duty limit. So, we pause the trajectory
     // if we get at this limit. We wait a little longer though, to make sure it does not fall back to below the limit
     // within one sample, which we can predict using the current rate times the loop time, with a factor two tolerance.
-    int32_t max_windup_duty = (ctl->settings.max_control - ctl->settings.control_offset) + (ctl->settings.pid_kp * abs(rate_now) * PBIO_CONFIG_SERVO_PERIOD_MS * 2) / MS_PER_SECOND;
+    // The loop time is measured, since controllers may be updated at different periods.
+    int32_t loop_time = control_get_loop_time(ctl, time_now);
+    int32_t max_windup_duty = (ctl->settings.max_control - ctl->settings.control_offset) + (ctl->settings.pid_kp * abs(rate_now) * loop_time * 2) / MS_PER_SECOND;
 
     // Position anti-windup: pause trajectory or integration if falling behind despite using maximum duty
 
@@ -109,26 +193,40 @@ void control_update(pbio_control_t *ctl, int32_t time_now, int32_t count_now, in
 }
 
 
+// Discards queued maneuvers, along with the reason the previous queue ended
+static void control_clear_queue(pbio_control_t *ctl) {
+    ctl->queue_size = 0;
+    ctl->queue_err = PBIO_SUCCESS;
+    ctl->stop_at_target = false;
+}
+
 void pbio_control_stop(pbio_control_t *ctl) {
+    // Discard queued maneuvers, but keep the queue error for the awaiting caller
+    ctl->queue_size = 0;
+    ctl->stop_at_target = false;
     ctl->type = PBIO_CONTROL_NONE;
     ctl->on_target = true;
     ctl->on_target_func = pbio_control_on_target_always;
     ctl->stalled = false;
 }
 
-pbio_error_t pbio_control_start_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t target_count, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_actuation_t after_stop) {
+// Selects S-curves for new maneuvers if a jerk limit is set, else trapezoids
+static void control_set_trajectory_type(pbio_control_t *ctl, pbio_trajectory_t *trajectory) {
+    pbio_trajectory_set_type(trajectory, PBIO_TRAJECTORY_TYPE_S_CURVE, ctl->settings.abs_jerk);
+}
+
+static pbio_error_t start_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t target_count, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_actuation_t after_stop) {
 
     pbio_error_t err;
 
-    // Set new maneuver action and stop type, and state
-    ctl->after_stop = after_stop;
-    ctl->on_target = false;
-    ctl->on_target_func = pbio_control_on_target_angle;
+    // Compute the trajectory on a copy, so the ongoing maneuver is left
+    // untouched if the new one is invalid
+    pbio_trajectory_t trajectory = ctl->trajectory;
+    control_set_trajectory_type(ctl, &trajectory);
 
-    // Compute the trajectory
     if (ctl->type == PBIO_CONTROL_NONE) {
         // If no control is ongoing, start from physical state
-        err = pbio_trajectory_make_angle_based(&ctl->trajectory, time_now, count_now, target_count, rate_now, target_rate, ctl->settings.max_rate, acceleration, ctl->settings.abs_acceleration);
+        err = pbio_trajectory_make_angle_based(&trajectory, time_now, count_now, target_count, rate_now, target_rate, ctl->settings.max_rate, acceleration, ctl->settings.abs_acceleration);
         if (err != PBIO_SUCCESS) {
             return err;
         }
@@ -137,12 +235,18 @@ pbio_error_t pbio_control_start_angle_control(pbio_control_t *ctl, int32_t time_
         int32_t time_ref = pbio_control_get_ref_time(ctl, time_now);
 
         // Make the new trajectory and try to patch to existing one
-        err = pbio_trajectory_make_angle_based_patched(&ctl->trajectory, time_ref, target_count, target_rate, ctl->settings.max_rate, acceleration, ctl->settings.abs_acceleration);
+        err = pbio_trajectory_make_angle_based_patched(&trajectory, time_ref, target_count, target_rate, ctl->settings.max_rate, acceleration, ctl->settings.abs_acceleration);
         if (err != PBIO_SUCCESS) {
             return err;
         }
     }
 
+    // Set new maneuver action and stop type, and state
+    ctl->trajectory = trajectory;
+    ctl->after_stop = after_stop;
+    ctl->on_target = false;
+    ctl->on_target_func = pbio_control_on_target_angle;
+
     // Reset PID control if needed
     if (ctl->type != PBIO_CONTROL_ANGLE) {
         // New angle maneuver, so reset the rate integrator
@@ -156,6 +260,62 @@ pbio_error_t pbio_control_start_angle_control(pbio_control_t *ctl, int32_t time_
     return PBIO_SUCCESS;
 }
 
+pbio_error_t pbio_control_start_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t target_count, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_actuation_t after_stop) {
+    // A new maneuver replaces anything that was queued
+    control_clear_queue(ctl);
+
+    return start_angle_control(ctl, time_now, count_now, target_count, rate_now, target_rate, acceleration, after_stop);
+}
+
+// Whether a queued angle maneuver starts right away, rather than after the
+// ongoing one
+bool pbio_control_queue_starts_now(pbio_control_t *ctl) {
+    return ctl->type != PBIO_CONTROL_ANGLE || (ctl->on_target && ctl->queue_size == 0);
+}
+
+pbio_error_t pbio_control_queue_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t target_count, int32_t rate_now, int32_t target_rate, bool stop, pbio_actuation_t after_stop) {
+
+    // Return error for zero speed, like angle control would do once started
+    if (target_rate == 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // If no angle maneuver is in progress, just start this one right away
+    if (pbio_control_queue_starts_now(ctl)) {
+        pbio_error_t err = pbio_control_start_angle_control(ctl, time_now, count_now, target_count, rate_now, target_rate, ctl->settings.abs_acceleration, after_stop);
+        ctl->stop_at_target = stop;
+        return err;
+    }
+
+    // Otherwise append it to the queue, if there is room for it
+    if (ctl->queue_size == PBIO_CONFIG_CONTROL_QUEUE_SIZE) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // Check that the maneuver is valid now, from standstill at the previous
+    // target, rather than finding out when it is its turn to start.
+    int32_t count_prev = ctl->queue_size ?
+        ctl->queue[(ctl->queue_start + ctl->queue_size - 1) % PBIO_CONFIG_CONTROL_QUEUE_SIZE].count :
+        ctl->trajectory.th3;
+    pbio_trajectory_t check = ctl->trajectory;
+    pbio_error_t err = pbio_trajectory_make_angle_based(&check, time_now, count_prev, target_count, 0, target_rate, ctl->settings.max_rate, ctl->settings.abs_acceleration, ctl->settings.abs_acceleration);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    pbio_control_waypoint_t *waypoint = &ctl->queue[(ctl->queue_start + ctl->queue_size) % PBIO_CONFIG_CONTROL_QUEUE_SIZE];
+    waypoint->count = target_count;
+    waypoint->rate = target_rate;
+    waypoint->stop = stop;
+    ctl->queue_size++;
+
+    // Keep controlling the position until the last queued maneuver completes
+    ctl->after_stop = PBIO_ACTUATION_HOLD;
+    ctl->queue_after_stop = after_stop;
+
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbio_control_start_relative_angle_control(pbio_control_t *ctl, int32_t time_now, int32_t count_now, int32_t relative_target_count, int32_t rate_now, int32_t target_rate, int32_t acceleration, pbio_actuation_t after_stop) {
 
     // Get the count from which the relative count is to be counted
@@ -185,6 +345,9 @@ pbio_error_t pbio_control_start_relative_angle_control(pbio_control_t *ctl, int3
 
 pbio_error_t pbio_control_start_hold_control(pbio_control_t *ctl, int32_t time_now, int32_t target_count) {
 
+    // Holding replaces anything that was queued
+    control_clear_queue(ctl);
+
     // Set new maneuver action and stop type, and state
     ctl->after_stop = PBIO_ACTUATION_HOLD;
     ctl->on_target = false;
@@ -210,10 +373,14 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, int32_t time_
 
     pbio_error_t err;
 
+    // A new maneuver replaces anything that was queued
+    control_clear_queue(ctl);
+
     // Set new maneuver action and stop type, and state
     ctl->after_stop = after_stop;
     ctl->on_target = false;
     ctl->on_target_func = stop_func;
+    control_set_trajectory_type(ctl, &ctl->trajectory);
 
     // Compute the trajectory
     if (ctl->type == PBIO_CONTROL_TIMED) {
@@ -265,7 +432,7 @@ pbio_control_on_target_t pbio_control_on_target_never = _pbio_control_on_target_
 
 static bool _pbio_control_on_target_angle(pbio_trajectory_t *trajectory, pbio_control_settings_t *settings, int32_t time, int32_t count, int32_t rate, bool stalled) {
     // if not enough time has expired to be done even in the ideal case, we are certainly not done
-    if (time - trajectory->t3 < 0) {
+    if (time - trajectory->t3 - trajectory->tj < 0) {
         return false;
     }
 
@@ -290,7 +457,7 @@ static bool _pbio_control_on_target_angle(pbio_trajectory_t *trajectory, pbio_co
 pbio_control_on_target_t pbio_control_on_target_angle = _pbio_control_on_target_angle;
 
 static bool _pbio_control_on_target_time(pbio_trajectory_t *trajectory, pbio_control_settings_t *settings, int32_t time, int32_t count, int32_t rate, bool stalled) {
-    return time >= trajectory->t3;
+    return time >= trajectory->t3 + trajectory->tj;
 }
 pbio_control_on_target_t pbio_control_on_target_time = _pbio_control_on_target_time;
 
@@ -313,6 +480,19 @@ void pbio_control_settings_get_limits(pbio_control_settings_t *s, int32_t *speed
     *actuation = s->max_control / s->actuation_scale;
 }
 
+int32_t pbio_control_settings_get_jerk(pbio_control_settings_t *s) {
+    return s->jerk;
+}
+
+pbio_error_t pbio_control_settings_set_jerk(pbio_control_settings_t *s, int32_t jerk) {
+    if (jerk < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    s->jerk = jerk;
+    s->abs_jerk = pbio_control_user_to_counts(s, jerk);
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbio_control_settings_set_limits(pbio_control_settings_t *s, int32_t speed, int32_t acceleration, int32_t actuation) {
     if (speed < 1 || acceleration < 1 || actuation < 1) {
         return PBIO_ERROR_INVALID_ARG;
@@ -407,5 +587,5 @@ bool pbio_control_is_stalled(pbio_control_t *ctl) {
 }
 
 bool pbio_control_is_done(pbio_control_t *ctl) {
-    return ctl->type == PBIO_CONTROL_NONE || ctl->on_target;
+    return ctl->type == PBIO_CONTROL_NONE || (ctl->on_target && ctl->queue_size == 0);
 }
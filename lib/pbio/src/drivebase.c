@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: MIT
 // Copyright (c) 2018-2020 The Pybricks Authors
 
+#include <stdlib.h>
+
 #include <contiki.h>
 
 #include <pbio/error.h>
@@ -25,6 +27,7 @@ static pbio_error_t drivebase_adopt_settings(pbio_control_settings_t *s_distance
     // As acceleration, we take double the single motor amount, because drivebases are
     // usually expected to respond quickly to speed setpoint changes
     s_distance->abs_acceleration = (s_left->abs_acceleration + s_right->abs_acceleration) * 2;
+    s_distance->abs_jerk = (s_left->abs_jerk + s_right->abs_jerk) * 2;
 
     // Although counts/errors add up twice as fast, both motors actuate, so apply half of the average PID
     s_distance->pid_kp = (s_left->pid_kp + s_right->pid_kp) / 4;
@@ -48,6 +51,19 @@ static pbio_error_t drivebase_adopt_settings(pbio_control_settings_t *s_distance
     return PBIO_SUCCESS;
 }
 
+// Get the drivebase state from the state of both motors
+static void drivebase_combine_state(int32_t count_left, int32_t rate_left, int32_t count_right, int32_t rate_right,
+    int32_t *sum,
+    int32_t *sum_rate,
+    int32_t *dif,
+    int32_t *dif_rate) {
+
+    *sum = count_left + count_right;
+    *sum_rate = rate_left + rate_right;
+    *dif = count_left - count_right;
+    *dif_rate = rate_left - rate_right;
+}
+
 // Get the physical state of a drivebase
 static pbio_error_t drivebase_get_state(pbio_drivebase_t *db,
     int32_t *time_now,
@@ -61,34 +77,19 @@ static pbio_error_t drivebase_get_state(pbio_drivebase_t *db,
     // Read current state of this motor: current time, speed, and position
     *time_now = clock_usecs();
 
-    int32_t count_left;
-    err = pbio_tacho_get_count(db->left->tacho, &count_left);
+    int32_t count_left, rate_left;
+    err = pbio_servo_get_state(db->left, *time_now, &count_left, &rate_left);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
-    int32_t count_right;
-    err = pbio_tacho_get_count(db->right->tacho, &count_right);
+    int32_t count_right, rate_right;
+    err = pbio_servo_get_state(db->right, *time_now, &count_right, &rate_right);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
-    int32_t rate_left;
-    err = pbio_tacho_get_rate(db->left->tacho, &rate_left);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
-
-    int32_t rate_right;
-    err = pbio_tacho_get_rate(db->right->tacho, &rate_right);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
-
-    *sum = count_left + count_right;
-    *sum_rate = rate_left + rate_right;
-    *dif = count_left - count_right;
-    *dif_rate = rate_left - rate_right;
+    drivebase_combine_state(count_left, rate_left, count_right, rate_right, sum, sum_rate, dif, dif_rate);
 
     return PBIO_SUCCESS;
 }
@@ -217,6 +218,9 @@ pbio_error_t pbio_drivebase_setup(pbio_drivebase_t *db, pbio_servo_t *left, pbio
     // Initialize log
     db->log.num_values = DRIVEBASE_LOG_NUM_VALUES;
 
+    // Pack time, counts, and rates, and their references as the change since the previous row
+    db->log.delta_mask = 1 << 0 | 1 << 1 | 1 << 2 | 1 << 3 | 1 << 5 | 1 << 6 | 1 << 8 | 1 << 10 | 1 << 12 | 1 << 14;
+
     // Adopt settings as the average or sum of both servos, except scaling
     err = drivebase_adopt_settings(&db->control_distance.settings, &db->control_heading.settings, &db->left->control.settings, &db->right->control.settings);
     if (err != PBIO_SUCCESS) {
@@ -249,6 +253,13 @@ pbio_error_t pbio_drivebase_setup(pbio_drivebase_t *db, pbio_servo_t *left, pbio
                 )
             );
 
+    // Jerk in user units follows from the combined jerk in counts
+    db->control_heading.settings.jerk = pbio_control_counts_to_user(&db->control_heading.settings, db->control_heading.settings.abs_jerk);
+    db->control_distance.settings.jerk = pbio_control_counts_to_user(&db->control_distance.settings, db->control_distance.settings.abs_jerk);
+
+    // Start tracking the pose from here
+    pbio_odometry_setup(&db->odometry, db->control_distance.settings.counts_per_unit, db->control_heading.settings.counts_per_unit);
+
     return PBIO_SUCCESS;
 }
 
@@ -257,6 +268,8 @@ void pbio_drivebase_claim_servos(pbio_drivebase_t *db, bool claim) {
     // Stop control
     pbio_control_stop(&db->left->control);
     pbio_control_stop(&db->right->control);
+    db->left->maneuver++;
+    db->right->maneuver++;
     // Set claim status
     db->left->claimed = claim;
     db->right->claimed = claim;
@@ -266,6 +279,10 @@ pbio_error_t pbio_drivebase_stop(pbio_drivebase_t *db, pbio_actuation_t after_st
 
     pbio_error_t err;
 
+    // This replaces the ongoing maneuver and any path that is being followed
+    db->maneuver++;
+    db->path.size = 0;
+
     int32_t sum_control;
     int32_t dif_control;
 
@@ -290,6 +307,8 @@ pbio_error_t pbio_drivebase_stop(pbio_drivebase_t *db, pbio_actuation_t after_st
 pbio_error_t pbio_drivebase_stop_force(pbio_drivebase_t *db) {
 
     // Stop control so polling will stop
+    db->maneuver++;
+    db->path.size = 0;
     pbio_control_stop(&db->control_distance);
     pbio_control_stop(&db->control_heading);
 
@@ -309,19 +328,141 @@ pbio_error_t pbio_drivebase_stop_force(pbio_drivebase_t *db) {
     return pbio_servo_stop_force(db->right);
 }
 
-pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db) {
-    // Get the physical state
-    int32_t time_now, sum, sum_rate, dif, dif_rate;
-    pbio_error_t err = drivebase_get_state(db, &time_now, &sum, &sum_rate, &dif, &dif_rate);
+// Starts driving a distance straight from the given state, with the servos already claimed
+static pbio_error_t drivebase_start_straight(pbio_drivebase_t *db, int32_t time_now, int32_t sum, int32_t sum_rate, int32_t dif, int32_t dif_rate, int32_t distance, int32_t drive_speed, int32_t drive_acceleration) {
+
+    pbio_error_t err;
+
+    // Sum controller performs a maneuver to drive a distance
+    int32_t relative_sum_target = pbio_control_user_to_counts(&db->control_distance.settings, distance);
+    int32_t target_sum_rate = pbio_control_user_to_counts(&db->control_distance.settings, drive_speed);
+    int32_t sum_acceleration = pbio_control_user_to_counts(&db->control_distance.settings, drive_acceleration);
+
+    err = pbio_control_start_relative_angle_control(&db->control_distance, time_now, sum, relative_sum_target, sum_rate, target_sum_rate, sum_acceleration, PBIO_ACTUATION_HOLD);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
+    // Dif controller just holds still
+    int32_t relative_dif_target = 0;
+    int32_t target_dif_rate = db->control_heading.settings.max_rate;
+    int32_t dif_acceleration = db->control_heading.settings.abs_acceleration;
+
+    return pbio_control_start_relative_angle_control(&db->control_heading, time_now, dif, relative_dif_target, dif_rate, target_dif_rate, dif_acceleration, PBIO_ACTUATION_HOLD);
+}
+
+// Distance from the end of the path below which we stop steering (mm)
+#define DRIVEBASE_PATH_FINISH_MIN (10)
+
+// Millidegrees per radian, for converting the curvature to a turn rate
+#define DRIVEBASE_MDEG_PER_RAD (57296)
+
+// Change of the steering turn rate below which the heading trajectory is kept (deg/s)
+#define DRIVEBASE_PATH_TURN_RATE_STEP (5)
+
+// Steers towards the point on the path one lookahead distance ahead, using
+// pure pursuit. Near the end of the path, drive the remaining distance
+// straight so the drivebase comes to a controlled stop on the last waypoint.
+// This starts from the state sampled for this update, without reading the
+// motors again or going through the public maneuver calls.
+static pbio_error_t drivebase_path_update(pbio_drivebase_t *db, int32_t time_now, int32_t sum, int32_t sum_rate, int32_t dif, int32_t dif_rate) {
+
+    pbio_drivebase_path_t *path = &db->path;
+
+    // Current pose in mm and millidegrees
+    int32_t x, y, heading;
+    pbio_odometry_get_pose(&db->odometry, &x, &y, &heading);
+    x /= 1000;
+    y /= 1000;
+
+    // Find the segment we are on, and how far along it we are
+    int32_t goal_x, goal_y, remaining;
+    while (true) {
+        pbio_drivebase_waypoint_t *a = path->index == 0 ? &path->start : &path->waypoints[path->index - 1];
+        pbio_drivebase_waypoint_t *b = &path->waypoints[path->index];
+        int32_t dx = b->x - a->x;
+        int32_t dy = b->y - a->y;
+        int32_t length = pbio_math_sqrt(dx * dx + dy * dy);
+
+        // Projection of the robot onto the segment, limited to the segment
+        int32_t along = length == 0 ? 0 : (int32_t)(((int64_t)(x - a->x) * dx + (int64_t)(y - a->y) * dy) / length);
+        along = max(0, min(along, length));
+        remaining = length - along;
+
+        // Move on to the next segment if the goal would be beyond this one
+        if (remaining < path->lookahead && path->index + 1 < path->size) {
+            path->index++;
+            continue;
+        }
+
+        // Goal point is one lookahead distance further along the segment
+        int32_t ahead = min(along + path->lookahead, length);
+        goal_x = length == 0 ? b->x : a->x + dx * ahead / length;
+        goal_y = length == 0 ? b->y : a->y + dy * ahead / length;
+        break;
+    }
+
+    // Close to the last waypoint, finish with a straight maneuver
+    if (path->index + 1 == path->size && remaining < max(path->lookahead / 2, DRIVEBASE_PATH_FINISH_MIN)) {
+        path->size = 0;
+        return drivebase_start_straight(db, time_now, sum, sum_rate, dif, dif_rate, remaining, path->speed, path->acceleration);
+    }
+
+    // Goal in the frame of the drivebase: forward and to the right (mm)
+    int32_t sin_heading = pbio_math_sin(heading);
+    int32_t cos_heading = pbio_math_cos(heading);
+    int64_t forward = ((int64_t)(goal_x - x) * cos_heading + (int64_t)(goal_y - y) * sin_heading) / PBIO_MATH_TRIG_ONE;
+    int64_t right = ((int64_t)(goal_y - y) * cos_heading - (int64_t)(goal_x - x) * sin_heading) / PBIO_MATH_TRIG_ONE;
+
+    // The arc through the goal has curvature 2 * right / distance^2. At the
+    // path speed, this gives the turn rate in degrees per second.
+    int64_t distance_sq = forward * forward + right * right;
+    int32_t turn_rate = 0;
+    if (distance_sq > 0) {
+        turn_rate = (int32_t)(path->speed * 2 * right * DRIVEBASE_MDEG_PER_RAD / 1000 / distance_sq);
+    }
+
+    // Bound by the maximum turn rate
+    int32_t turn_rate_limit, turn_acceleration_limit, _;
+    pbio_control_settings_get_limits(&db->control_heading.settings, &turn_rate_limit, &turn_acceleration_limit, &_);
+    turn_rate = max(-turn_rate_limit, min(turn_rate, turn_rate_limit));
+
+    // Keep the heading trajectory unless the turn rate changed noticeably, so
+    // it is only replanned a few times per curve instead of on every update.
+    if (abs(turn_rate - path->turn_rate) < DRIVEBASE_PATH_TURN_RATE_STEP) {
+        return PBIO_SUCCESS;
+    }
+    path->turn_rate = turn_rate;
+
+    // Update the heading reference, like a call to pbio_drivebase_drive would
+    int32_t target_turn_rate = pbio_control_user_to_counts(&db->control_heading.settings, turn_rate);
+    return pbio_control_start_timed_control(&db->control_heading, time_now, DURATION_FOREVER, dif, dif_rate, target_turn_rate, db->control_heading.settings.abs_acceleration, pbio_control_on_target_never, PBIO_ACTUATION_COAST);
+}
+
+pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db, int32_t time_now, int32_t count_left, int32_t rate_left, int32_t count_right, int32_t rate_right) {
+
+    pbio_error_t err;
+
+    // Get the physical state
+    int32_t sum, sum_rate, dif, dif_rate;
+    drivebase_combine_state(count_left, rate_left, count_right, rate_right, &sum, &sum_rate, &dif, &dif_rate);
+
+    // Integrate the pose, also while passive
+    pbio_odometry_update(&db->odometry, sum, dif);
+
     // If passive, log and exit
     if (db->control_heading.type == PBIO_CONTROL_NONE || db->control_distance.type == PBIO_CONTROL_NONE) {
         return drivebase_log_update(db, time_now, sum, sum_rate, 0, dif, dif_rate, 0);
     }
 
+    // Steer along the path, if following one
+    if (db->path.size > 0) {
+        err = drivebase_path_update(db, time_now, sum, sum_rate, dif, dif_rate);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
     // Get control signals
     int32_t sum_control, dif_control;
     pbio_actuation_t sum_actuation, dif_actuation;
@@ -345,6 +486,10 @@ pbio_error_t pbio_drivebase_straight(pbio_drivebase_t *db, int32_t distance, int
 
     pbio_error_t err;
 
+    // This replaces the ongoing maneuver and any path that is being followed
+    db->maneuver++;
+    db->path.size = 0;
+
     // Claim both servos for use by drivebase
     pbio_drivebase_claim_servos(db, true);
 
@@ -355,33 +500,17 @@ pbio_error_t pbio_drivebase_straight(pbio_drivebase_t *db, int32_t distance, int
         return err;
     }
 
-    // Sum controller performs a maneuver to drive a distance
-    int32_t relative_sum_target = pbio_control_user_to_counts(&db->control_distance.settings, distance);
-    int32_t target_sum_rate = pbio_control_user_to_counts(&db->control_distance.settings, drive_speed);
-    int32_t sum_acceleration = pbio_control_user_to_counts(&db->control_distance.settings, drive_acceleration);
-
-    err = pbio_control_start_relative_angle_control(&db->control_distance, time_now, sum, relative_sum_target, sum_rate, target_sum_rate, sum_acceleration, PBIO_ACTUATION_HOLD);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
-
-    // Dif controller just holds still
-    int32_t relative_dif_target = 0;
-    int32_t target_dif_rate = db->control_heading.settings.max_rate;
-    int32_t dif_acceleration = db->control_heading.settings.abs_acceleration;
-
-    err = pbio_control_start_relative_angle_control(&db->control_heading, time_now, dif, relative_dif_target, dif_rate, target_dif_rate, dif_acceleration, PBIO_ACTUATION_HOLD);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
-
-    return PBIO_SUCCESS;
+    return drivebase_start_straight(db, time_now, sum, sum_rate, dif, dif_rate, distance, drive_speed, drive_acceleration);
 }
 
 pbio_error_t pbio_drivebase_turn(pbio_drivebase_t *db, int32_t angle, int32_t turn_rate, int32_t turn_acceleration) {
 
     pbio_error_t err;
 
+    // This replaces the ongoing maneuver and any path that is being followed
+    db->maneuver++;
+    db->path.size = 0;
+
     // Claim both servos for use by drivebase
     pbio_drivebase_claim_servos(db, true);
 
@@ -415,10 +544,55 @@ pbio_error_t pbio_drivebase_turn(pbio_drivebase_t *db, int32_t angle, int32_t tu
 
     return PBIO_SUCCESS;
 }
+/**
+ * Drives along a path through the given waypoints without stopping, and
+ * comes to a stop on the last one. The waypoints are in the frame of the
+ * drivebase pose. The path is copied, so the caller need not keep it.
+ * @param [in]  db              the drivebase
+ * @param [in]  waypoints       points to drive through (mm)
+ * @param [in]  size            number of waypoints
+ * @param [in]  speed           forward speed (mm/s)
+ * @param [in]  acceleration    acceleration for the final stop (mm/s^2)
+ * @param [in]  lookahead       distance to the point on the path to steer towards (mm)
+ */
+pbio_error_t pbio_drivebase_follow_path(pbio_drivebase_t *db, const pbio_drivebase_waypoint_t *waypoints, uint8_t size, int32_t speed, int32_t acceleration, int32_t lookahead) {
+
+    if (size == 0 || size > PBIO_CONFIG_DRIVEBASE_PATH_SIZE || speed <= 0 || acceleration <= 0 || lookahead <= 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Start driving forward. Steering starts on the next update.
+    pbio_error_t err = pbio_drivebase_drive(db, speed, 0);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    pbio_drivebase_path_t *path = &db->path;
+    int32_t heading;
+    pbio_odometry_get_pose(&db->odometry, &path->start.x, &path->start.y, &heading);
+    path->start.x /= 1000;
+    path->start.y /= 1000;
+    for (uint8_t i = 0; i < size; i++) {
+        path->waypoints[i] = waypoints[i];
+    }
+    path->index = 0;
+    path->speed = speed;
+    path->acceleration = acceleration;
+    path->lookahead = lookahead;
+    path->turn_rate = 0;
+    path->size = size;
+
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbio_drivebase_drive(pbio_drivebase_t *db, int32_t speed, int32_t turn_rate) {
 
     pbio_error_t err;
 
+    // This replaces the ongoing maneuver and any path that is being followed
+    db->maneuver++;
+    db->path.size = 0;
+
     // Claim both servos for use by drivebase
     pbio_drivebase_claim_servos(db, true);
 
@@ -470,6 +644,7 @@ pbio_error_t pbio_drivebase_get_state(pbio_drivebase_t *db, int32_t *distance, i
 
 pbio_error_t pbio_drivebase_reset_state(pbio_drivebase_t *db) {
     int32_t time_now, sum_rate, dif_rate;
+    pbio_odometry_set_pose(&db->odometry, 0, 0, 0);
     return drivebase_get_state(db, &time_now, &db->sum_offset, &sum_rate, &db->dif_offset, &dif_rate);
 }
 
@@ -72,6 +72,50 @@ pbio_error_t pbio_iodev_get_data(pbio_iodev_t *iodev, uint8_t **data) {
     return PBIO_SUCCESS;
 }
 
+/**
+ * Gets the sequence number and time of the most recent data message.
+ * @param [in]  iodev       The I/O device
+ * @param [out] count       Number of data messages received so far
+ * @param [out] time        Time at which the data was received (microseconds)
+ * @return                  ::PBIO_SUCCESS on success
+ *                          ::PBIO_ERROR_NO_DEV if the port does not have a device attached
+ */
+pbio_error_t pbio_iodev_get_sample(pbio_iodev_t *iodev, uint32_t *count, uint32_t *time) {
+    if (iodev->info->type_id == PBIO_IODEV_TYPE_ID_NONE) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    *count = iodev->sample_count;
+    *time = iodev->sample_time;
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Checks if a data message newer than a given one has been received.
+ *
+ * This is polled until it no longer returns ::PBIO_ERROR_AGAIN to wait for
+ * the next sample, so a loop can run exactly as fast as the device sends data.
+ *
+ * @param [in]  iodev       The I/O device
+ * @param [in]  count       Sequence number of the last sample that was used,
+ *                          as given by ::pbio_iodev_get_sample()
+ * @return                  ::PBIO_SUCCESS if a newer sample is available
+ *                          ::PBIO_ERROR_AGAIN if no newer sample was received yet
+ *                          ::PBIO_ERROR_NO_DEV if the port does not have a device attached
+ */
+pbio_error_t pbio_iodev_wait_sample(pbio_iodev_t *iodev, uint32_t count) {
+    if (iodev->info->type_id == PBIO_IODEV_TYPE_ID_NONE) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    if (iodev->sample_count == count) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    return PBIO_SUCCESS;
+}
+
 /**
  * Sets the mode of an I/O device.
  * @param [in]  iodev       The I/O device
@@ -108,6 +152,33 @@ void pbio_iodev_set_mode_cancel(pbio_iodev_t *iodev) {
     iodev->ops->set_mode_cancel(iodev);
 }
 
+/**
+ * Makes an I/O device send the data of several modes at the same time.
+ *
+ * Once this completes, changing to any of the modes in
+ * pbio_iodev_t.combo_modes takes effect right away. Completion is awaited
+ * with ::pbio_iodev_set_mode_end(), like any other mode change.
+ *
+ * The device can only send a limited amount of data at once. All modes in
+ * @p required are combined or none at all. Modes in @p optional are added
+ * in order of their number for as long as they fit.
+ *
+ * @param [in]  iodev       The I/O device
+ * @param [in]  required    Bit flags of the modes that must be combined
+ * @param [in]  optional    Bit flags of other modes to add if they fit
+ * @return                  ::PBIO_SUCCESS on success
+ *                          ::PBIO_ERROR_INVALID_ARG if the required modes can't be combined
+ *                          ::PBIO_ERROR_AGAIN if the device is busy with something else
+ *                          ::PBIO_ERROR_NOT_SUPPORTED if the device does not support mode combinations
+ */
+pbio_error_t pbio_iodev_set_mode_combo_begin(pbio_iodev_t *iodev, uint16_t required, uint16_t optional) {
+    if (!iodev->ops->set_mode_combo_begin) {
+        return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    return iodev->ops->set_mode_combo_begin(iodev, required, optional);
+}
+
 /**
  * Sets the raw data of an I/O device.
  * @param [in]  iodev       The I/O device
@@ -183,3 +254,163 @@ void pbio_iodev_write_cancel(pbio_iodev_t *iodev) {
 
     iodev->ops->write_cancel(iodev);
 }
+
+#if PBIO_CONFIG_IODEV_HISTORY_SIZE
+
+/**
+ * Selects the mode that the history is kept for. The history starts over if
+ * this is another mode than before. Device drivers call this when the device
+ * stops sending all other modes, so that the history has no gaps.
+ * @param [in]  iodev       The I/O device
+ * @param [in]  mode        The mode to keep the history for
+ */
+void pbio_iodev_set_history_mode(pbio_iodev_t *iodev, uint8_t mode) {
+    if (iodev->history_mode != mode) {
+        iodev->history_mode = mode;
+        iodev->history_len = 0;
+    }
+}
+
+/**
+ * Adds the first value of a sample to the history. This is called by the
+ * device driver each time a sample is received, including samples of modes
+ * that are only part of combined data. Samples of other modes than the
+ * history mode are ignored.
+ * @param [in]  iodev       The I/O device
+ * @param [in]  mode        The mode of the sample
+ * @param [in]  data        The values of the sample, laid out like *bin_data*
+ */
+void pbio_iodev_history_push(pbio_iodev_t *iodev, uint8_t mode, const uint8_t *data) {
+    if (mode != iodev->history_mode) {
+        return;
+    }
+
+    int32_t value;
+    switch (iodev->info->mode_info[mode].data_type) {
+        case PBIO_IODEV_DATA_TYPE_INT8:
+            value = *(int8_t *)data;
+            break;
+        case PBIO_IODEV_DATA_TYPE_INT16:
+            value = *(int16_t *)data;
+            break;
+        case PBIO_IODEV_DATA_TYPE_INT32:
+            value = *(int32_t *)data;
+            break;
+        case PBIO_IODEV_DATA_TYPE_FLOAT:
+            value = *(float *)data;
+            break;
+        default:
+            return;
+    }
+
+    iodev->history[iodev->history_head] = value;
+    iodev->history_head = (iodev->history_head + 1) % PBIO_CONFIG_IODEV_HISTORY_SIZE;
+    if (iodev->history_len < PBIO_CONFIG_IODEV_HISTORY_SIZE) {
+        iodev->history_len++;
+    }
+}
+
+/**
+ * Gets the most recent samples of the first value of the history mode.
+ * @param [in]  iodev       The I/O device
+ * @param [out] values      Samples from oldest to newest
+ * @param [inout] n         Number of samples requested, then the number of
+ *                          samples that were available
+ * @return                  ::PBIO_SUCCESS on success
+ *                          ::PBIO_ERROR_INVALID_ARG if *n* is 0 or more than
+ *                          PBIO_CONFIG_IODEV_HISTORY_SIZE
+ *                          ::PBIO_ERROR_AGAIN if no samples of the history mode
+ *                          were received yet
+ *                          ::PBIO_ERROR_NO_DEV if the port does not have a device attached
+ */
+pbio_error_t pbio_iodev_get_history(pbio_iodev_t *iodev, int32_t *values, uint8_t *n) {
+    if (iodev->info->type_id == PBIO_IODEV_TYPE_ID_NONE) {
+        return PBIO_ERROR_NO_DEV;
+    }
+    if (*n == 0 || *n > PBIO_CONFIG_IODEV_HISTORY_SIZE) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    if (iodev->history_len == 0) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    if (*n > iodev->history_len) {
+        *n = iodev->history_len;
+    }
+
+    // Walk back from the newest sample
+    uint8_t index = iodev->history_head;
+    for (uint8_t i = *n; i > 0; i--) {
+        index = (index + PBIO_CONFIG_IODEV_HISTORY_SIZE - 1) % PBIO_CONFIG_IODEV_HISTORY_SIZE;
+        values[i - 1] = iodev->history[index];
+    }
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Filters the most recent samples of the first value of the history mode.
+ * @param [in]  iodev       The I/O device
+ * @param [in]  filter      The filter to apply
+ * @param [in]  n           Number of samples to filter. Fewer are used if
+ *                          not as many were received yet.
+ * @param [in]  weight      Weight of each new sample in the exponential
+ *                          filter (1--100 %). Ignored by other filters.
+ * @param [in]  normalize   Applied to each sample before filtering, or NULL
+ *                          to filter the raw samples
+ * @param [out] value       The filtered value
+ * @return                  ::PBIO_SUCCESS on success
+ *                          ::PBIO_ERROR_INVALID_ARG if an argument is out of range
+ *                          ::PBIO_ERROR_AGAIN if no samples of the history mode
+ *                          were received yet
+ *                          ::PBIO_ERROR_NO_DEV if the port does not have a device attached
+ */
+pbio_error_t pbio_iodev_get_filtered(pbio_iodev_t *iodev, pbio_iodev_filter_t filter, uint8_t n, int32_t weight, pbio_iodev_normalize_t normalize, int32_t *value) {
+    int32_t values[PBIO_CONFIG_IODEV_HISTORY_SIZE];
+    int64_t sum = 0;
+
+    pbio_error_t err = pbio_iodev_get_history(iodev, values, &n);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    for (uint8_t i = 0; normalize && i < n; i++) {
+        values[i] = normalize(values[i]);
+    }
+
+    switch (filter) {
+        case PBIO_IODEV_FILTER_AVERAGE:
+            for (uint8_t i = 0; i < n; i++) {
+                sum += values[i];
+            }
+            *value = sum / n;
+            return PBIO_SUCCESS;
+        case PBIO_IODEV_FILTER_MEDIAN:
+            // Insertion sort is fast enough for a few samples
+            for (uint8_t i = 1; i < n; i++) {
+                int32_t v = values[i];
+                uint8_t j = i;
+                for (; j > 0 && values[j - 1] > v; j--) {
+                    values[j] = values[j - 1];
+                }
+                values[j] = v;
+            }
+            *value = n % 2 ? values[n / 2] : ((int64_t)values[n / 2 - 1] + values[n / 2]) / 2;
+            return PBIO_SUCCESS;
+        case PBIO_IODEV_FILTER_EXPONENTIAL:
+            if (weight < 1 || weight > 100) {
+                return PBIO_ERROR_INVALID_ARG;
+            }
+            // Keep the state in hundredths so that small steps don't round away
+            sum = (int64_t)values[0] * 100;
+            for (uint8_t i = 1; i < n; i++) {
+                sum += ((int64_t)values[i] * 100 - sum) * weight / 100;
+            }
+            *value = sum / 100;
+            return PBIO_SUCCESS;
+        default:
+            return PBIO_ERROR_INVALID_ARG;
+    }
+}
+
+#endif // PBIO_CONFIG_IODEV_HISTORY_SIZE
@@ -8,6 +8,7 @@
 #include <contiki.h>
 
 #include <stdbool.h>
+#include <string.h>
 
 #include <pbdrv/pwm.h>
 
@@ -21,6 +22,9 @@ struct _pbio_lightgrid_t {
     uint8_t frame_index;
     uint8_t interval;
     const uint8_t *frame_data;
+    // Brightness of each pixel as last written to the PWM device, or
+    // UINT8_MAX if it is not known. Pixels that don't change are skipped.
+    uint8_t pixels[25];
 };
 
 PROCESS(pbio_lightgrid_process, "light grid");
@@ -33,6 +37,9 @@ pbio_error_t pbio_lightgrid_get_dev(pbio_lightgrid_t **lightgrid) {
     // Get data
     grid->data = &pbdrv_lightgrid_platform_data;
 
+    // Write all pixels the next time, since we don't know what is shown now
+    memset(grid->pixels, UINT8_MAX, sizeof(grid->pixels));
+
     // Get PWM device
     pbio_error_t err = pbdrv_pwm_get_dev(grid->data->id, &grid->pwm);
     if (err != PBIO_SUCCESS) {
@@ -63,7 +70,7 @@ pbio_error_t pbio_lightgrid_set_rows(pbio_lightgrid_t *lightgrid, const uint8_t
             // The pixel is on of the bit is high.
             bool on = rows[i] & (1 << (size - 1 - j));
             // Set the pixel.
-            err = pbdrv_pwm_set_duty(lightgrid->pwm, lightgrid->data->channels[i * size + j], on * UINT16_MAX);
+            err = pbio_lightgrid_set_pixel(lightgrid, i, j, on * 100);
             if (err != PBIO_SUCCESS) {
                 return err;
             }
@@ -82,10 +89,22 @@ pbio_error_t pbio_lightgrid_set_pixel(pbio_lightgrid_t *lightgrid, uint8_t row,
         return PBIO_SUCCESS;
     }
 
+    // Return early if the pixel already has this brightness
+    uint8_t index = row * size + col;
+    if (lightgrid->pixels[index] == brightness) {
+        return PBIO_SUCCESS;
+    }
+
     // Scale brightness quadratically from 0 to UINT16_MAX
     int32_t duty = brightness * brightness * UINT16_MAX / 10000;
 
-    return pbdrv_pwm_set_duty(lightgrid->pwm, lightgrid->data->channels[row * size + col], duty);
+    pbio_error_t err = pbdrv_pwm_set_duty(lightgrid->pwm, lightgrid->data->channels[index], duty);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    lightgrid->pixels[index] = brightness;
+    return PBIO_SUCCESS;
 }
 
 // Displays an image on the screen
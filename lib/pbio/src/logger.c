@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include <contiki.h>
 
@@ -11,17 +12,87 @@
 #include <pbio/error.h>
 #include <pbio/logger.h>
 
-/**
- * Starts logging in the background.
- * @param [in]  log     pointer to log
- * @param [in]  buf     array large enough to hold @p len rows of data
- * @param [in]  len     maximum number of rows that can be logged
- * @param [in]  div     clock divider to slow down sampling period
- */
-void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div) {
+// The control loop writes rows and a consumer may pop them at the same time,
+// so each side publishes its own counter only after the row data is in place.
+static uint32_t logger_load(const uint32_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+}
+
+static void logger_store(uint32_t *counter, uint32_t value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELEASE);
+}
+
+// Packed rows start with a 2-bit width code for each column, followed by the
+// zigzag encoded values (or deltas) with as many bytes as the code says.
+#define PACKED_WIDTH_BITS (2)
+#define PACKED_WIDTHS_PER_BYTE (8 / PACKED_WIDTH_BITS)
+
+static const uint8_t packed_width_bytes[] = { 0, 1, 2, 4 };
+
+static uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static size_t packed_row_size_max(pbio_log_t *log) {
+    return (log->num_values + PACKED_WIDTHS_PER_BYTE - 1) / PACKED_WIDTHS_PER_BYTE + log->num_values * sizeof(int32_t);
+}
+
+// Packs a row after the previous one, and returns the number of bytes written
+static size_t logger_pack_row(pbio_log_t *log, uint8_t *dest, const int32_t *row) {
+
+    uint8_t *widths = dest;
+    uint8_t *pos = dest + (log->num_values + PACKED_WIDTHS_PER_BYTE - 1) / PACKED_WIDTHS_PER_BYTE;
+    memset(widths, 0, pos - widths);
+
+    for (uint8_t i = 0; i < log->num_values; i++) {
+        // Deltas wrap around like the counters they come from
+        int32_t value = log->delta_mask & (1 << i) ? (int32_t)((uint32_t)row[i] - (uint32_t)log->prev[i]) : row[i];
+        uint32_t encoded = zigzag_encode(value);
+
+        uint8_t code = encoded == 0 ? 0 : encoded <= UINT8_MAX ? 1 : encoded <= UINT16_MAX ? 2 : 3;
+        widths[i / PACKED_WIDTHS_PER_BYTE] |= code << (i % PACKED_WIDTHS_PER_BYTE * PACKED_WIDTH_BITS);
+
+        for (uint8_t b = 0; b < packed_width_bytes[code]; b++) {
+            *pos++ = encoded >> (b * 8);
+        }
+        log->prev[i] = row[i];
+    }
+    return pos - dest;
+}
+
+// Unpacks the row at src, given the previous row in row. Returns the number of bytes read.
+static size_t logger_unpack_row(pbio_log_t *log, const uint8_t *src, int32_t *row) {
+
+    const uint8_t *widths = src;
+    const uint8_t *pos = src + (log->num_values + PACKED_WIDTHS_PER_BYTE - 1) / PACKED_WIDTHS_PER_BYTE;
+
+    for (uint8_t i = 0; i < log->num_values; i++) {
+        uint8_t code = (widths[i / PACKED_WIDTHS_PER_BYTE] >> (i % PACKED_WIDTHS_PER_BYTE * PACKED_WIDTH_BITS)) & 3;
+
+        uint32_t encoded = 0;
+        for (uint8_t b = 0; b < packed_width_bytes[code]; b++) {
+            encoded |= (uint32_t)*pos++ << (b * 8);
+        }
+        int32_t value = zigzag_decode(encoded);
+        row[i] = log->delta_mask & (1 << i) ? (int32_t)((uint32_t)row[i] + (uint32_t)value) : value;
+    }
+    return pos - src;
+}
+
+static void logger_init(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div, bool ring, bool packed) {
     // (re-)initialize logger status for this servo
     log->sampled = 0;
+    log->consumed = 0;
+    log->overruns = 0;
     log->skipped = 0;
+    log->ring = ring;
+    log->packed = packed;
+    log->size = 0;
+    memset(log->prev, 0, sizeof(log->prev));
     log->data = buf;
     log->len = len;
     log->sample_div = div;
@@ -29,14 +100,78 @@ void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div)
     log->active = true;
 }
 
+/**
+ * Starts logging in the background.
+ * @param [in]  log     pointer to log
+ * @param [in]  buf     array large enough to hold @p len rows of data
+ * @param [in]  len     maximum number of rows that can be logged
+ * @param [in]  div     clock divider to slow down sampling period
+ */
+void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div) {
+    logger_init(log, buf, len, div, false, false);
+}
+
+/**
+ * Starts logging in the background until stopped. Rows must be popped as
+ * they come in. If the buffer is full, new samples are dropped and counted
+ * as overruns, so the control loop never waits for the consumer.
+ * @param [in]  log     pointer to log
+ * @param [in]  buf     array large enough to hold @p len rows of data
+ * @param [in]  len     number of rows that can be buffered
+ * @param [in]  div     clock divider to slow down sampling period
+ */
+void pbio_logger_start_ring(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div) {
+    logger_init(log, buf, len, div, true, false);
+}
+
+/**
+ * Starts logging in the background, with rows packed as they come in. Most
+ * values change little from one row to the next, so this fits several times
+ * more rows in the same buffer. Rows can be read back with pbio_logger_read()
+ * or taken out in packed form with pbio_logger_get_packed().
+ * @param [in]  log     pointer to log
+ * @param [in]  buf     array large enough to hold @p len unpacked rows of data
+ * @param [in]  len     number of unpacked rows that fit in @p buf
+ * @param [in]  div     clock divider to slow down sampling period
+ */
+void pbio_logger_start_packed(pbio_log_t *log, int32_t *buf, uint32_t len, int32_t div) {
+    logger_init(log, buf, len, div, false, true);
+}
+
+/**
+ * Gets the packed log along with a header that describes it. The header is
+ * "PBLG", the format version, the number of values per row, and the delta
+ * mask as a little endian uint32.
+ * @param [in]  log     pointer to log
+ * @param [out] header  buffer of ::PBIO_LOG_PACKED_HEADER_SIZE bytes
+ * @param [out] data    packed rows
+ * @return              size of the packed rows in bytes
+ */
+size_t pbio_logger_get_packed(pbio_log_t *log, uint8_t *header, const uint8_t **data) {
+    memcpy(header, "PBLG", 4);
+    header[4] = PBIO_LOG_PACKED_VERSION;
+    header[5] = log->num_values;
+    header[6] = log->delta_mask;
+    header[7] = log->delta_mask >> 8;
+    header[8] = log->delta_mask >> 16;
+    header[9] = log->delta_mask >> 24;
+
+    *data = (const uint8_t *)log->data;
+    return log->packed ? log->size : 0;
+}
+
 int32_t pbio_logger_rows(pbio_log_t *log) {
-    return log->sampled;
+    return logger_load(&log->sampled) - logger_load(&log->consumed);
 }
 
 int32_t pbio_logger_cols(pbio_log_t *log) {
     return log->num_values;
 }
 
+uint32_t pbio_logger_overruns(pbio_log_t *log) {
+    return log->overruns;
+}
+
 void pbio_logger_stop(pbio_log_t *log) {
     // Release the logger for re-use
     log->active = false;
@@ -55,28 +190,57 @@ pbio_error_t pbio_logger_update(pbio_log_t *log, int32_t *buf) {
     }
     log->skipped = 0;
 
+    uint32_t sampled = log->sampled;
+
+    if (log->packed) {
+        // Stop when the next row might not fit
+        uint8_t *dest = (uint8_t *)log->data;
+        if (log->size + packed_row_size_max(log) > log->len * log->num_values * sizeof(int32_t)) {
+            log->active = false;
+            return PBIO_SUCCESS;
+        }
+
+        int32_t row[MAX_LOG_VALUES];
+        row[0] = (int32_t)(clock_usecs() - log->start) / 1000;
+        for (uint8_t i = NUM_DEFAULT_LOG_VALUES; i < log->num_values; i++) {
+            row[i] = buf[i - NUM_DEFAULT_LOG_VALUES];
+        }
+        log->size += logger_pack_row(log, dest + log->size, row);
+        logger_store(&log->sampled, sampled + 1);
+        return PBIO_SUCCESS;
+    }
+
+    uint32_t used = sampled - logger_load(&log->consumed);
+
     // Raise error if log is full, which should not happen
-    if (log->sampled > log->len) {
+    if (used > log->len) {
         log->active = false;
         return PBIO_ERROR_FAILED;
     }
 
-    // Stop successfully when done
-    if (log->sampled == log->len) {
+    if (used == log->len) {
+        // In a ring, drop the sample until the consumer catches up
+        if (log->ring) {
+            log->overruns++;
+            return PBIO_SUCCESS;
+        }
+        // Otherwise, stop successfully when done
         log->active = false;
         return PBIO_SUCCESS;
     }
 
+    int32_t *row = &log->data[(sampled % log->len) * log->num_values];
+
     // Write time of logging
-    log->data[log->sampled * log->num_values] = (clock_usecs() - log->start) / 1000;
+    row[0] = (int32_t)(clock_usecs() - log->start) / 1000;
 
     // Write the data
     for (uint8_t i = NUM_DEFAULT_LOG_VALUES; i < log->num_values; i++) {
-        log->data[log->sampled * log->num_values + i] = buf[i - NUM_DEFAULT_LOG_VALUES];
+        row[i] = buf[i - NUM_DEFAULT_LOG_VALUES];
     }
 
     // Increment sample counter
-    log->sampled++;
+    logger_store(&log->sampled, sampled + 1);
 
     return PBIO_SUCCESS;
 }
@@ -88,18 +252,102 @@ pbio_error_t pbio_logger_read(pbio_log_t *log, int32_t sindex, int32_t *buf) {
         return PBIO_ERROR_INVALID_ARG;
     }
 
+    uint32_t consumed = logger_load(&log->consumed);
+    uint32_t rows = logger_load(&log->sampled) - consumed;
+
     // Get index or latest sample if requested index is -1
-    uint32_t index = sindex < 0 ? log->sampled - 1 : (uint32_t)sindex;
+    uint32_t index = sindex < 0 ? rows - 1 : (uint32_t)sindex;
 
     // Ensure index is within bounds
-    if (index >= log->sampled) {
+    if (index >= rows) {
         return PBIO_ERROR_INVALID_ARG;
     }
 
-    // Read the data
+    if (log->packed) {
+        // The latest row is kept unpacked
+        if (index == rows - 1) {
+            memcpy(buf, log->prev, log->num_values * sizeof(int32_t));
+            return PBIO_SUCCESS;
+        }
+        // Otherwise unpack all rows up to the requested one
+        const uint8_t *src = (const uint8_t *)log->data;
+        memset(buf, 0, log->num_values * sizeof(int32_t));
+        for (uint32_t i = 0; i <= index; i++) {
+            src += logger_unpack_row(log, src, buf);
+        }
+        return PBIO_SUCCESS;
+    }
+
+    // Read the data, counting from the oldest row that has not been popped
+    int32_t *row = &log->data[((consumed + index) % log->len) * log->num_values];
+    for (uint8_t i = 0; i < log->num_values; i++) {
+        buf[i] = row[i];
+    }
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Reads the oldest row and removes it from the log.
+ * @param [in]  log     pointer to log
+ * @param [out] buf     array large enough to hold one row of data
+ * @return              ::PBIO_ERROR_AGAIN if there are no rows
+ */
+pbio_error_t pbio_logger_pop(pbio_log_t *log, int32_t *buf) {
+
+    // Packed rows can only be taken out all at once
+    if (log->packed) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    pbio_error_t err = pbio_logger_read(log, 0, buf);
+    if (err == PBIO_ERROR_INVALID_ARG) {
+        return PBIO_ERROR_AGAIN;
+    }
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Free up the row for the producer
+    logger_store(&log->consumed, log->consumed + 1);
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Pops the oldest row as a binary frame. The frame starts with
+ * ::PBIO_LOG_FRAME_SYNC, the number of values, and the overrun count so far
+ * as a little endian uint16, followed by the values as little endian int32.
+ * The overrun count stays at UINT16_MAX once it gets there, rather than
+ * wrapping around. Use pbio_logger_overruns() for the full count.
+ * @param [in]  log     pointer to log
+ * @param [out] frame   buffer of at least ::PBIO_LOG_FRAME_SIZE_MAX bytes
+ * @param [out] size    size of the frame
+ * @return              ::PBIO_ERROR_AGAIN if there are no rows
+ */
+pbio_error_t pbio_logger_pop_frame(pbio_log_t *log, uint8_t *frame, size_t *size) {
+
+    int32_t data[MAX_LOG_VALUES];
+    pbio_error_t err = pbio_logger_pop(log, data);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    uint16_t overruns = log->overruns > UINT16_MAX ? UINT16_MAX : log->overruns;
+    frame[0] = PBIO_LOG_FRAME_SYNC;
+    frame[1] = log->num_values;
+    frame[2] = overruns;
+    frame[3] = overruns >> 8;
+
+    uint8_t *value = &frame[PBIO_LOG_FRAME_HEADER_SIZE];
     for (uint8_t i = 0; i < log->num_values; i++) {
-        buf[i] = log->data[index * log->num_values + i];
+        uint32_t v = data[i];
+        *value++ = v;
+        *value++ = v >> 8;
+        *value++ = v >> 16;
+        *value++ = v >> 24;
     }
+    *size = value - frame;
 
     return PBIO_SUCCESS;
 }
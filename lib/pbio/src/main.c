@@ -7,6 +7,7 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <contiki.h>
 
@@ -25,6 +26,7 @@
 #include "processes.h"
 
 static clock_time_t prev_fast_poll_time;
+static uint32_t missed_deadlines;
 
 AUTOSTART_PROCESSES(
 #if PBDRV_CONFIG_ADC
@@ -64,6 +66,8 @@ void pbio_init(void) {
     _pbdrv_button_init();
     autostart_start(autostart_processes);
     _pbio_motorpoll_reset_all();
+    prev_fast_poll_time = clock_time();
+    missed_deadlines = 0;
 }
 
 /**
@@ -74,26 +78,104 @@ void pbio_stop_all(void) {
     #if PBIO_CONFIG_LIGHT
     pbio_light_animation_stop_all();
     #endif
+    pbio_motorpoll_lock();
     _pbio_motorpoll_reset_all();
+    pbio_motorpoll_unlock();
 }
 
 /**
  * Checks for and performs pending background tasks. This function is meant to
  * be called as frequently as possible. To conserve power, you can wait for an
- * interrupt after all events have been processed (i.e. return value is 0).
+ * interrupt after all events have been processed (i.e. return value is 0), or
+ * sleep for the time given by pbio_get_event_timeout().
  * @return      The number of still-pending events.
  */
 int pbio_do_one_event(void) {
+    #if !PBIO_CONFIG_MOTORPOLL_THREAD
     clock_time_t now = clock_time();
+    clock_time_t period = clock_from_msec(PBIO_CONFIG_SERVO_PERIOD_MIN_MS);
+    clock_time_t elapsed = now - prev_fast_poll_time;
 
     // pbio_do_one_event() can be called quite frequently (e.g. in a tight loop) so we
     // don't want to call all of the subroutines unless enough time has
     // actually elapsed to do something useful.
-    if (now - prev_fast_poll_time >= clock_from_msec(PBIO_CONFIG_SERVO_PERIOD_MS)) {
+    if (elapsed >= period) {
         _pbio_motorpoll_poll();
-        prev_fast_poll_time = clock_time();
+
+        // Polls are kept on a fixed grid, so the servo updates don't drift by
+        // however late this call happened to be. If we are late by a whole
+        // period or more, those polls are lost, so start a new grid from now.
+        if (elapsed < period * 2) {
+            prev_fast_poll_time += period;
+        } else {
+            if (_pbio_motorpoll_is_active()) {
+                missed_deadlines += elapsed / period - 1;
+            }
+            prev_fast_poll_time = now;
+        }
     }
+    #endif
     return process_run();
 }
 
+/**
+ * Gets the time until pbio_do_one_event() next has something to do. This is
+ * the next motor poll if any motors are in use, or else the next expiring
+ * Contiki event timer. Callers may sleep for this long instead of polling.
+ * Motors that are polled by a control thread are not included.
+ *
+ * The result is limited to PBIO_CONFIG_SERVO_PERIOD_IDLE_MS, so that motors
+ * and timers started in the meantime are picked up soon enough.
+ * @return      Time until the next deadline (ms), or 0 if it already passed.
+ */
+uint32_t pbio_get_event_timeout(void) {
+    clock_time_t now = clock_time();
+    clock_time_t timeout = clock_from_msec(PBIO_CONFIG_SERVO_PERIOD_IDLE_MS);
+
+    if (!PBIO_CONFIG_MOTORPOLL_THREAD && _pbio_motorpoll_is_active()) {
+        clock_time_t elapsed = now - prev_fast_poll_time;
+        clock_time_t period = clock_from_msec(PBIO_CONFIG_SERVO_PERIOD_MIN_MS);
+        if (elapsed >= period) {
+            return 0;
+        }
+        if (period - elapsed < timeout) {
+            timeout = period - elapsed;
+        }
+    }
+
+    if (etimer_pending()) {
+        clock_time_t remaining = etimer_next_expiration_time() - now;
+        // Timers that already expired wrap around to a large value
+        if (remaining > (clock_time_t)~0 / 2) {
+            return 0;
+        }
+        if (remaining < timeout) {
+            timeout = remaining;
+        }
+    }
+
+    return clock_to_msec(timeout);
+}
+
+/**
+ * Gets the number of motor polls that were skipped because
+ * pbio_do_one_event() was not called in time, since pbio_init().
+ * @return      The number of missed deadlines.
+ */
+uint32_t pbio_get_missed_deadlines(void) {
+    // This may be counted by a control thread while we read it
+    return __atomic_load_n(&missed_deadlines, __ATOMIC_RELAXED);
+}
+
+#if PBIO_CONFIG_MOTORPOLL_THREAD
+/**
+ * Adds to the number of skipped motor polls, for platforms that poll the
+ * motors from their own control thread.
+ * @param [in]  count   The number of polls that were missed.
+ */
+void pbio_add_missed_deadlines(uint32_t count) {
+    __atomic_fetch_add(&missed_deadlines, count, __ATOMIC_RELAXED);
+}
+#endif
+
 /** @}*/
@@ -5,6 +5,8 @@
 #include <inttypes.h>
 #include <fixmath.h>
 
+#include <pbio/math.h>
+
 int32_t pbio_math_sign(int32_t a) {
     if (a == 0) {
         return 0;
@@ -46,3 +48,53 @@ int32_t pbio_math_sqrt(int32_t n) {
         x0 = x1;
     }
 }
+
+// sin(k degrees) * PBIO_MATH_TRIG_ONE for k = 0..90
+static const int32_t sin_table[] = {
+    0, 18739379, 37473049, 56195305, 74900443, 93582766,
+    112236583, 130856211, 149435979, 167970228, 186453311, 204879599,
+    223243478, 241539355, 259761657, 277904834, 295963357, 313931728,
+    331804471, 349576144, 367241333, 384794656, 402230767, 419544355,
+    436730145, 453782903, 470697435, 487468587, 504091252, 520560366,
+    536870912, 553017922, 568996477, 584801711, 600428808, 615873009,
+    631129609, 646193961, 661061475, 675727625, 690187940, 704438018,
+    718473518, 732290163, 745883746, 759250125, 772385229, 785285058,
+    797945680, 810363241, 822533958, 834454122, 846120104, 857528349,
+    868675383, 879557810, 890172315, 900515665, 910584710, 920376381,
+    929887697, 939115760, 948057759, 956710970, 965072759, 973140576,
+    980911966, 988384560, 995556083, 1002424350, 1008987269, 1015242840,
+    1021189159, 1026824413, 1032146887, 1037154959, 1041847103, 1046221891,
+    1050277989, 1054014162, 1057429273, 1060522280, 1063292242, 1065738315,
+    1067859754, 1069655912, 1071126243, 1072270298, 1073087729, 1073578288,
+    1073741824,
+};
+
+int32_t pbio_math_sin(int32_t angle) {
+    // Reduce to 0..360 degrees, then to the first quadrant
+    angle %= 360000;
+    if (angle < 0) {
+        angle += 360000;
+    }
+    int32_t sign = 1;
+    if (angle >= 180000) {
+        angle -= 180000;
+        sign = -1;
+    }
+    if (angle > 90000) {
+        angle = 180000 - angle;
+    }
+
+    // Interpolate between whole degrees
+    int32_t k = angle / 1000;
+    int32_t frac = angle % 1000;
+    int32_t value = sin_table[k];
+    if (frac != 0) {
+        value += (int32_t)((int64_t)(sin_table[k + 1] - sin_table[k]) * frac / 1000);
+    }
+    return sign * value;
+}
+
+int32_t pbio_math_cos(int32_t angle) {
+    // Shift in range first, so adding 90 degrees cannot overflow
+    return pbio_math_sin(angle % 360000 + 90000);
+}
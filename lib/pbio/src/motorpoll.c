@@ -1,18 +1,123 @@
 // SPDX-License-Identifier: MIT
 // Copyright (c) 2018-2020 The Pybricks Authors
 
+#include <contiki.h>
+
+#include <pbdrv/motor.h>
+
 #include <pbio/control.h>
 #include <pbio/drivebase.h>
 #include <pbio/motorpoll.h>
 #include <pbio/servo.h>
+#include <pbio/servogroup.h>
 
 #if PBDRV_CONFIG_NUM_MOTOR_CONTROLLER != 0
 
 static pbio_servo_t servo[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
 static pbio_error_t servo_err[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
 
-static pbio_drivebase_t drivebase;
-static pbio_error_t drivebase_err;
+// Drivebases and servo groups are in use while their status is PBIO_ERROR_AGAIN
+static pbio_drivebase_t drivebase[PBIO_CONFIG_NUM_DRIVEBASES];
+static pbio_error_t drivebase_err[PBIO_CONFIG_NUM_DRIVEBASES];
+
+static pbio_servogroup_t servogroup[PBIO_CONFIG_NUM_SERVOGROUPS];
+static pbio_error_t servogroup_err[PBIO_CONFIG_NUM_SERVOGROUPS];
+
+// Physical state of each servo, sampled at the start of each poll
+static int32_t servo_count[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+static int32_t servo_rate[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+static pbio_error_t servo_state_err[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+
+// Update period (ms) during maneuvers and time of the last update (us)
+static int32_t servo_period[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+static int32_t servo_time[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+static int32_t drivebase_period[PBIO_CONFIG_NUM_DRIVEBASES];
+static int32_t drivebase_time[PBIO_CONFIG_NUM_DRIVEBASES];
+static int32_t servogroup_period[PBIO_CONFIG_NUM_SERVOGROUPS];
+static int32_t servogroup_time[PBIO_CONFIG_NUM_SERVOGROUPS];
+
+// Gets the index of the servo, or -1 if it is not one of ours
+static int motorpoll_get_servo_index(pbio_servo_t *srv) {
+    for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+        if (srv == &servo[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Gets the index of the drivebase, or -1 if it is not one of ours
+static int motorpoll_get_drivebase_index(pbio_drivebase_t *db) {
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        if (db == &drivebase[d]) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+// Gets the index of the servo group, or -1 if it is not one of ours
+static int motorpoll_get_servogroup_index(pbio_servogroup_t *grp) {
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        if (grp == &servogroup[g]) {
+            return g;
+        }
+    }
+    return -1;
+}
+
+static bool motorpoll_drivebase_uses_servo(int d, pbio_servo_t *srv) {
+    return drivebase[d].left == srv || drivebase[d].right == srv;
+}
+
+static bool motorpoll_servogroup_uses_servo(int g, pbio_servo_t *srv) {
+    for (uint8_t j = 0; j < servogroup[g].size; j++) {
+        if (servogroup[g].servos[j] == srv) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A servo can be driven by only one drivebase or group at a time. Any other
+// drivebase or group that still uses one of the given servos stops being polled.
+static void motorpoll_release_servo(pbio_servo_t *srv, pbio_drivebase_t *db_keep, pbio_servogroup_t *grp_keep) {
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        if (&drivebase[d] != db_keep && drivebase_err[d] == PBIO_ERROR_AGAIN && motorpoll_drivebase_uses_servo(d, srv)) {
+            drivebase_err[d] = PBIO_ERROR_INVALID_OP;
+        }
+    }
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        if (&servogroup[g] != grp_keep && servogroup_err[g] == PBIO_ERROR_AGAIN && motorpoll_servogroup_uses_servo(g, srv)) {
+            servogroup_err[g] = PBIO_ERROR_INVALID_OP;
+        }
+    }
+}
+
+static pbio_error_t motorpoll_check_period(int32_t period) {
+    if (period < PBIO_CONFIG_SERVO_PERIOD_MIN_MS || period > PBIO_CONFIG_SERVO_PERIOD_IDLE_MS) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    return PBIO_SUCCESS;
+}
+
+// Checks if an update is due. Passive controllers drop to the idle period.
+// Holding controllers keep their period, so that hold stiffness and stall
+// detection are the same as during maneuvers. Polls run every PBIO_CONFIG_SERVO_PERIOD_MIN_MS,
+// so allow half a poll of jitter to avoid skipping a poll now and then.
+static bool motorpoll_is_due(int32_t time_now, int32_t time_prev, int32_t period, bool idle) {
+    if (idle && period < PBIO_CONFIG_SERVO_PERIOD_IDLE_MS) {
+        period = PBIO_CONFIG_SERVO_PERIOD_IDLE_MS;
+    }
+    return time_now - time_prev >= (period * 1000 - PBIO_CONFIG_SERVO_PERIOD_MIN_MS * 500);
+}
+
+// Gets a previous update time for a controller that starts being polled, so
+// that it is due right away. Times are compared by difference, which is only
+// valid for controllers that are polled regularly.
+static int32_t motorpoll_start_time(void) {
+    return (int32_t)clock_usecs() - PBIO_CONFIG_SERVO_PERIOD_IDLE_MS * 1000;
+}
 
 // Get pointer to servo by port index
 pbio_error_t pbio_motorpoll_get_servo(pbio_port_t port, pbio_servo_t **srv) {
@@ -30,6 +135,9 @@ pbio_error_t pbio_motorpoll_get_servo(pbio_port_t port, pbio_servo_t **srv) {
 pbio_error_t pbio_motorpoll_set_servo_status(pbio_servo_t *srv, pbio_error_t err) {
     for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
         if (srv == &servo[i]) {
+            if (err == PBIO_ERROR_AGAIN && servo_err[i] != PBIO_ERROR_AGAIN) {
+                servo_time[i] = motorpoll_start_time();
+            }
             servo_err[i] = err;
             return PBIO_SUCCESS;
         }
@@ -47,75 +155,326 @@ pbio_error_t pbio_motorpoll_get_servo_status(pbio_servo_t *srv) {
     return PBIO_ERROR_INVALID_ARG;
 }
 
-// Get pointer to drivebase
-pbio_error_t pbio_motorpoll_get_drivebase(pbio_drivebase_t **db) {
-    // Get pointer to device (at the moment, there is only one drivebase)
-    *db = &drivebase;
+// Get update period (ms) of the servo during maneuvers
+pbio_error_t pbio_motorpoll_get_servo_period(pbio_servo_t *srv, int32_t *period) {
+    int i = motorpoll_get_servo_index(srv);
+    if (i < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    *period = servo_period[i];
     return PBIO_SUCCESS;
 }
 
+// Set update period (ms) of the servo during maneuvers
+pbio_error_t pbio_motorpoll_set_servo_period(pbio_servo_t *srv, int32_t period) {
+    int i = motorpoll_get_servo_index(srv);
+    if (i < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    pbio_error_t err = motorpoll_check_period(period);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    servo_period[i] = period;
+    return PBIO_SUCCESS;
+}
+
+// Get pointer to a drivebase that is not in use
+pbio_error_t pbio_motorpoll_get_drivebase(pbio_drivebase_t **db) {
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        if (drivebase_err[d] != PBIO_ERROR_AGAIN) {
+            *db = &drivebase[d];
+            return PBIO_SUCCESS;
+        }
+    }
+    return PBIO_ERROR_NO_DEV;
+}
+
 // Set status of the drivebase, which tells us whether to poll or not
 pbio_error_t pbio_motorpoll_set_drivebase_status(pbio_drivebase_t *db, pbio_error_t err) {
-    if (db != &drivebase) {
+    int d = motorpoll_get_drivebase_index(db);
+    if (d < 0) {
         return PBIO_ERROR_INVALID_ARG;
     }
-    drivebase_err = err;
+    if (err == PBIO_ERROR_AGAIN) {
+        motorpoll_release_servo(db->left, db, NULL);
+        motorpoll_release_servo(db->right, db, NULL);
+        if (drivebase_err[d] != PBIO_ERROR_AGAIN) {
+            drivebase_time[d] = motorpoll_start_time();
+        }
+    }
+    drivebase_err[d] = err;
     return PBIO_SUCCESS;
 }
 
 // Get status of the drivebase, which tells us whether to poll or not
 pbio_error_t pbio_motorpoll_get_drivebase_status(pbio_drivebase_t *db) {
-    if (db != &drivebase) {
+    int d = motorpoll_get_drivebase_index(db);
+    if (d < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    return drivebase_err[d];
+}
+
+// Get update period (ms) of the drivebase during maneuvers
+pbio_error_t pbio_motorpoll_get_drivebase_period(pbio_drivebase_t *db, int32_t *period) {
+    int d = motorpoll_get_drivebase_index(db);
+    if (d < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    *period = drivebase_period[d];
+    return PBIO_SUCCESS;
+}
+
+// Set update period (ms) of the drivebase during maneuvers
+pbio_error_t pbio_motorpoll_set_drivebase_period(pbio_drivebase_t *db, int32_t period) {
+    int d = motorpoll_get_drivebase_index(db);
+    if (d < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    pbio_error_t err = motorpoll_check_period(period);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    drivebase_period[d] = period;
+    return PBIO_SUCCESS;
+}
+
+// Get pointer to a servo group that is not in use
+pbio_error_t pbio_motorpoll_get_servogroup(pbio_servogroup_t **grp) {
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        if (servogroup_err[g] != PBIO_ERROR_AGAIN) {
+            *grp = &servogroup[g];
+            return PBIO_SUCCESS;
+        }
+    }
+    return PBIO_ERROR_NO_DEV;
+}
+
+// Set status of the servo group, which tells us whether to poll or not
+pbio_error_t pbio_motorpoll_set_servogroup_status(pbio_servogroup_t *grp, pbio_error_t err) {
+    int g = motorpoll_get_servogroup_index(grp);
+    if (g < 0) {
         return PBIO_ERROR_INVALID_ARG;
     }
-    return drivebase_err;
+    if (err == PBIO_ERROR_AGAIN) {
+        for (uint8_t j = 0; j < grp->size; j++) {
+            motorpoll_release_servo(grp->servos[j], NULL, grp);
+        }
+        if (servogroup_err[g] != PBIO_ERROR_AGAIN) {
+            servogroup_time[g] = motorpoll_start_time();
+        }
+    }
+    servogroup_err[g] = err;
+    return PBIO_SUCCESS;
 }
 
+// Get status of the servo group, which tells us whether to poll or not
+pbio_error_t pbio_motorpoll_get_servogroup_status(pbio_servogroup_t *grp) {
+    int g = motorpoll_get_servogroup_index(grp);
+    if (g < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    return servogroup_err[g];
+}
+
+// Get update period (ms) of the servo group during maneuvers
+pbio_error_t pbio_motorpoll_get_servogroup_period(pbio_servogroup_t *grp, int32_t *period) {
+    int g = motorpoll_get_servogroup_index(grp);
+    if (g < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    *period = servogroup_period[g];
+    return PBIO_SUCCESS;
+}
+
+// Set update period (ms) of the servo group during maneuvers
+pbio_error_t pbio_motorpoll_set_servogroup_period(pbio_servogroup_t *grp, int32_t period) {
+    int g = motorpoll_get_servogroup_index(grp);
+    if (g < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    pbio_error_t err = motorpoll_check_period(period);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    servogroup_period[g] = period;
+    return PBIO_SUCCESS;
+}
 
 void _pbio_motorpoll_reset_all(void) {
 
     // Set ports for all servos on init
     for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
         servo[i].port = PBIO_PORT_A + i;
+        servo_period[i] = PBIO_CONFIG_SERVO_PERIOD_MS;
     }
 
-    pbio_error_t err;
-
-    // Force stop the drivebase
-    err = pbio_drivebase_stop_force(&drivebase);
-    if (err != PBIO_SUCCESS) {
-        drivebase_err = err;
+    // Force stop all drivebases and servo groups, so they are free to use again
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        drivebase_period[d] = PBIO_CONFIG_SERVO_PERIOD_MS;
+        drivebase_err[d] = pbio_drivebase_stop_force(&drivebase[d]);
+    }
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        servogroup_period[g] = PBIO_CONFIG_SERVO_PERIOD_MS;
+        servogroup_err[g] = pbio_servogroup_stop_force(&servogroup[g]);
     }
 
     // Force stop the servos
     for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
-        err = pbio_servo_stop_force(&servo[i]);
+        pbio_error_t err = pbio_servo_stop_force(&servo[i]);
         if (err != PBIO_SUCCESS) {
             servo_err[i] = err;
         }
     }
 }
 
+// Gets the sampled state of the servos of a group, or the first error
+static pbio_error_t motorpoll_get_servogroup_state(pbio_servogroup_t *grp, int32_t *count, int32_t *rate) {
+    for (uint8_t j = 0; j < grp->size; j++) {
+        int i = grp->servos[j] - servo;
+        if (servo_state_err[i] != PBIO_SUCCESS) {
+            return servo_state_err[i];
+        }
+        count[j] = servo_count[i];
+        rate[j] = servo_rate[i];
+    }
+    return PBIO_SUCCESS;
+}
+
+// Whether any servo, drivebase or servo group is currently being polled
+bool _pbio_motorpoll_is_active(void) {
+    for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+        if (servo_err[i] == PBIO_ERROR_AGAIN) {
+            return true;
+        }
+    }
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        if (drivebase_err[d] == PBIO_ERROR_AGAIN) {
+            return true;
+        }
+    }
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        if (servogroup_err[g] == PBIO_ERROR_AGAIN) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void _pbio_motorpoll_poll(void) {
 
     pbio_error_t err;
 
+    // Find out which controllers are due for an update in this poll
+    int32_t time_now = clock_usecs();
+    bool servo_due[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+    bool servo_sample[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
+    for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+        servo_due[i] = servo_err[i] == PBIO_ERROR_AGAIN &&
+            motorpoll_is_due(time_now, servo_time[i], servo_period[i], servo[i].control.type == PBIO_CONTROL_NONE);
+        servo_sample[i] = servo_due[i];
+    }
+    bool drivebase_due[PBIO_CONFIG_NUM_DRIVEBASES];
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        drivebase_due[d] = drivebase_err[d] == PBIO_ERROR_AGAIN &&
+            motorpoll_is_due(time_now, drivebase_time[d], drivebase_period[d],
+                drivebase[d].control_distance.type == PBIO_CONTROL_NONE && drivebase[d].control_heading.type == PBIO_CONTROL_NONE);
+        if (drivebase_due[d]) {
+            servo_sample[drivebase[d].left - servo] = true;
+            servo_sample[drivebase[d].right - servo] = true;
+        }
+    }
+    bool servogroup_due[PBIO_CONFIG_NUM_SERVOGROUPS];
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        servogroup_due[g] = servogroup_err[g] == PBIO_ERROR_AGAIN &&
+            motorpoll_is_due(time_now, servogroup_time[g], servogroup_period[g], pbio_servogroup_is_passive(&servogroup[g]));
+        for (uint8_t j = 0; servogroup_due[g] && j < servogroup[g].size; j++) {
+            servo_sample[servogroup[g].servos[j] - servo] = true;
+        }
+    }
+
+    // Sample all motors in use first, so that all controllers see the state
+    // at the same time
+    for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+        if (servo_sample[i]) {
+            servo_state_err[i] = pbio_servo_get_state(&servo[i], time_now, &servo_count[i], &servo_rate[i]);
+        }
+    }
+
+    // Motor outputs are collected and applied together at the end
+    pbdrv_motor_batch_begin();
+
     // Poll servos
     for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
         // Poll servo again if it says so, and save error if encountered
-        if (servo_err[i] == PBIO_ERROR_AGAIN) {
-            err = pbio_servo_control_update(&servo[i]);
+        if (servo_due[i]) {
+            servo_time[i] = time_now;
+            err = servo_state_err[i];
+            if (err == PBIO_SUCCESS) {
+                err = pbio_servo_control_update(&servo[i], time_now, servo_count[i], servo_rate[i]);
+            }
             if (err != PBIO_SUCCESS) {
                 servo_err[i] = err;
             }
         }
     }
 
-    // Poll drivebase again if it says so, and save error if encountered
-    if (drivebase_err == PBIO_ERROR_AGAIN) {
-        err = pbio_drivebase_update(&drivebase);
+    // Poll drivebases again if they say so, and save error if encountered
+    for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+        if (!drivebase_due[d]) {
+            continue;
+        }
+        drivebase_time[d] = time_now;
+        // The drivebase uses the state of its servos, which were sampled above
+        int left = drivebase[d].left - servo;
+        int right = drivebase[d].right - servo;
+        err = servo_state_err[left];
+        if (err == PBIO_SUCCESS) {
+            err = servo_state_err[right];
+        }
+        if (err == PBIO_SUCCESS) {
+            err = pbio_drivebase_update(&drivebase[d], time_now, servo_count[left], servo_rate[left], servo_count[right], servo_rate[right]);
+        }
+        if (err != PBIO_SUCCESS) {
+            drivebase_err[d] = err;
+        }
+    }
+
+    // Poll servo groups again if they say so, and save error if encountered
+    for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+        if (!servogroup_due[g]) {
+            continue;
+        }
+        servogroup_time[g] = time_now;
+        int32_t count[PBIO_CONFIG_SERVOGROUP_SIZE];
+        int32_t rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+        err = motorpoll_get_servogroup_state(&servogroup[g], count, rate);
+        if (err == PBIO_SUCCESS) {
+            err = pbio_servogroup_update(&servogroup[g], time_now, count, rate);
+        }
         if (err != PBIO_SUCCESS) {
-            drivebase_err = err;
+            servogroup_err[g] = err;
+        }
+    }
+
+    // Apply all motor outputs at once
+    err = pbdrv_motor_batch_commit();
+    if (err != PBIO_SUCCESS) {
+        for (int i = 0; i < PBDRV_CONFIG_NUM_MOTOR_CONTROLLER; i++) {
+            if (servo_err[i] == PBIO_ERROR_AGAIN) {
+                servo_err[i] = err;
+            }
+        }
+        for (int d = 0; d < PBIO_CONFIG_NUM_DRIVEBASES; d++) {
+            if (drivebase_err[d] == PBIO_ERROR_AGAIN) {
+                drivebase_err[d] = err;
+            }
+        }
+        for (int g = 0; g < PBIO_CONFIG_NUM_SERVOGROUPS; g++) {
+            if (servogroup_err[g] == PBIO_ERROR_AGAIN) {
+                servogroup_err[g] = err;
+            }
         }
     }
 }
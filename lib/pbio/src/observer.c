@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <contiki.h>
+
+#include <pbdrv/motor.h>
+
+#include <pbio/config.h>
+
+#include <pbio/observer.h>
+#include <pbio/trajectory.h>
+
+// Observer gains, per mille, for updates OBSERVER_TIME_REF apart. For other
+// update intervals, they are scaled to keep the same bandwidth in time.
+#define OBSERVER_GAIN_COUNT (300)
+#define OBSERVER_GAIN_RATE (50)
+#define OBSERVER_GAIN_DISTURBANCE (2)
+#define OBSERVER_TIME_REF (PBIO_CONFIG_SERVO_PERIOD_MS * US_PER_MS)
+
+// Beyond this interval the count gain would exceed 1, so the gains stop
+// growing to keep the filter stable
+#define OBSERVER_TIME_SCALE_MAX (OBSERVER_TIME_REF * 1000 / OBSERVER_GAIN_COUNT)
+
+// Updates closer together than this are skipped, so that reading the state
+// twice in one control iteration does not disturb the estimate
+#define OBSERVER_TIME_MIN (500)
+
+// If there has not been an update for this long, the estimate is stale and
+// starts over from the measured state
+#define OBSERVER_TIME_MAX (100 * US_PER_MS)
+
+// Bound on the disturbance estimate (millicounts/s^2)
+#define OBSERVER_DISTURBANCE_MAX (100000000)
+
+static int64_t as_mcount(int32_t count, int32_t count_ext) {
+    return ((int64_t)count) * 1000 + count_ext;
+}
+
+static void as_count(int64_t mcount, int32_t *count, int32_t *count_ext) {
+    *count = (int32_t)(mcount / 1000);
+    *count_ext = mcount - ((int64_t)*count) * 1000;
+}
+
+// Acceleration (millicounts/s^2) of a motor at the given rate and duty, according to the model
+static int32_t observer_get_model_acceleration(pbio_observer_t *obs, int32_t rate, int32_t duty) {
+    if (obs->rate_max == 0) {
+        return 0;
+    }
+    int64_t rate_steady = ((int64_t)duty) * obs->rate_max * 1000 / PBDRV_MAX_DUTY;
+    return (rate_steady - rate) * MS_PER_SECOND / obs->time_constant;
+}
+
+void pbio_observer_set_model(pbio_observer_t *obs, int32_t rate_max, int32_t time_constant) {
+    obs->rate_max = time_constant > 0 ? rate_max : 0;
+    obs->time_constant = time_constant;
+}
+
+void pbio_observer_reset(pbio_observer_t *obs, int32_t time_now, int32_t count, int32_t rate) {
+    obs->running = true;
+    obs->time_prev = time_now;
+    obs->count = count;
+    obs->count_ext = 0;
+    obs->rate = rate * 1000;
+    obs->disturbance = 0;
+    obs->acceleration = 0;
+}
+
+void pbio_observer_update(pbio_observer_t *obs, int32_t time_now, int32_t count, int32_t rate, int32_t duty) {
+
+    int32_t dt = time_now - obs->time_prev;
+
+    // Start over from the measured state if the estimate is stale
+    if (!obs->running || dt < 0 || dt > OBSERVER_TIME_MAX) {
+        pbio_observer_reset(obs, time_now, count, rate);
+        return;
+    }
+
+    // Nothing to do if we just updated
+    if (dt < OBSERVER_TIME_MIN) {
+        return;
+    }
+    obs->time_prev = time_now;
+
+    // Predict the state at this time, given the duty applied since the previous update
+    int64_t acceleration = observer_get_model_acceleration(obs, obs->rate, duty) + obs->disturbance;
+    int64_t rate_change = acceleration * dt / US_PER_SECOND;
+    int64_t mcount = as_mcount(obs->count, obs->count_ext) + (obs->rate + rate_change / 2) * dt / US_PER_SECOND;
+    int64_t mrate = obs->rate + rate_change;
+
+    // The count, rate, and disturbance gains grow with the first, second, and
+    // third power of the update interval, respectively (parts per million)
+    int64_t scale = min(dt, OBSERVER_TIME_SCALE_MAX);
+    int64_t gain_count = OBSERVER_GAIN_COUNT * 1000 * scale / OBSERVER_TIME_REF;
+    int64_t gain_rate = OBSERVER_GAIN_RATE * 1000 * scale * scale / OBSERVER_TIME_REF / OBSERVER_TIME_REF;
+    int64_t gain_disturbance = OBSERVER_GAIN_DISTURBANCE * 1000 * scale * scale * scale / OBSERVER_TIME_REF / OBSERVER_TIME_REF / OBSERVER_TIME_REF;
+
+    // Correct the prediction using the difference with the measured count
+    int64_t error = as_mcount(count, 0) - mcount;
+    mcount += error * gain_count / 1000000;
+    mrate += error * gain_rate / 1000 * US_PER_MS / dt;
+    int64_t disturbance = obs->disturbance + (error * gain_disturbance / 1000 * 2 * US_PER_MS / dt) * US_PER_SECOND / dt;
+
+    // Do not let the disturbance run away while the measurement disagrees with the model
+    if (disturbance > OBSERVER_DISTURBANCE_MAX) {
+        disturbance = OBSERVER_DISTURBANCE_MAX;
+    } else if (disturbance < -OBSERVER_DISTURBANCE_MAX) {
+        disturbance = -OBSERVER_DISTURBANCE_MAX;
+    }
+
+    as_count(mcount, &obs->count, &obs->count_ext);
+    obs->rate = mrate;
+    obs->disturbance = disturbance;
+    obs->acceleration = observer_get_model_acceleration(obs, obs->rate, duty) + obs->disturbance;
+}
+
+void pbio_observer_get_estimated_state(pbio_observer_t *obs, int32_t *count, int32_t *rate, int32_t *acceleration) {
+    *count = obs->count;
+    *rate = obs->rate / 1000;
+    *acceleration = obs->acceleration / 1000;
+}
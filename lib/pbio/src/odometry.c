@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <pbio/math.h>
+#include <pbio/odometry.h>
+
+// Converts counts to thousandths or millionths of the user unit
+#define ODOMETRY_MILLI (1000)
+#define ODOMETRY_MICRO (1000000)
+
+static int64_t odometry_counts_to_user(int32_t counts, fix16_t counts_per_unit, int32_t scale) {
+    return (int64_t)counts * scale * fix16_one / counts_per_unit;
+}
+
+// Heading that corresponds to the given count difference (millidegrees)
+static int32_t odometry_get_heading(pbio_odometry_t *odo, int32_t dif) {
+    return (int32_t)odometry_counts_to_user(dif, odo->counts_per_degree, ODOMETRY_MILLI) + odo->heading_offset;
+}
+
+/**
+ * Sets the drivebase geometry and resets the pose to zero.
+ * @param [in]  odo                 the odometry
+ * @param [in]  counts_per_mm       sum of counts for every mm forward
+ * @param [in]  counts_per_degree   difference of counts for every degree of rotation
+ */
+void pbio_odometry_setup(pbio_odometry_t *odo, fix16_t counts_per_mm, fix16_t counts_per_degree) {
+    odo->counts_per_mm = counts_per_mm;
+    odo->counts_per_degree = counts_per_degree;
+    odo->running = false;
+    pbio_odometry_set_pose(odo, 0, 0, 0);
+}
+
+/**
+ * Integrates the motion since the previous update. The heading follows from
+ * the count difference directly, and the distance traveled is projected on
+ * the heading halfway through the update interval.
+ * @param [in]  odo     the odometry
+ * @param [in]  sum     sum of the wheel counts
+ * @param [in]  dif     difference of the wheel counts
+ */
+void pbio_odometry_update(pbio_odometry_t *odo, int32_t sum, int32_t dif) {
+
+    // The first update only sets the starting point
+    if (!odo->running) {
+        odo->heading_offset = odo->heading - (int32_t)odometry_counts_to_user(dif, odo->counts_per_degree, ODOMETRY_MILLI);
+        odo->sum_prev = sum;
+        odo->running = true;
+        return;
+    }
+
+    int32_t heading = odometry_get_heading(odo, dif);
+    int32_t heading_mid = odo->heading + (heading - odo->heading) / 2;
+    int64_t distance = odometry_counts_to_user(sum - odo->sum_prev, odo->counts_per_mm, ODOMETRY_MICRO);
+
+    odo->x += distance * pbio_math_cos(heading_mid) / PBIO_MATH_TRIG_ONE;
+    odo->y += distance * pbio_math_sin(heading_mid) / PBIO_MATH_TRIG_ONE;
+    odo->heading = heading;
+    odo->sum_prev = sum;
+}
+
+/**
+ * Moves the heading towards an externally measured heading, such as the
+ * integrated rate of a gyro. This corrects the heading for wheel slip.
+ * @param [in]  odo     the odometry
+ * @param [in]  heading measured heading (millidegrees)
+ * @param [in]  weight  how much of the difference to correct now (0--100 %)
+ */
+void pbio_odometry_fuse_heading(pbio_odometry_t *odo, int32_t heading, int32_t weight) {
+    int32_t correction = (heading - odo->heading) * weight / 100;
+    odo->heading_offset += correction;
+    odo->heading += correction;
+}
+
+/**
+ * Gets the pose as of the latest update.
+ * @param [in]  odo     the odometry
+ * @param [out] x       position along the x axis (micrometers)
+ * @param [out] y       position along the y axis (micrometers)
+ * @param [out] heading heading (millidegrees)
+ */
+void pbio_odometry_get_pose(pbio_odometry_t *odo, int32_t *x, int32_t *y, int32_t *heading) {
+    *x = odo->x / 1000;
+    *y = odo->y / 1000;
+    *heading = odo->heading;
+}
+
+/**
+ * Sets the pose. Following updates continue from here.
+ * @param [in]  odo     the odometry
+ * @param [in]  x       position along the x axis (micrometers)
+ * @param [in]  y       position along the y axis (micrometers)
+ * @param [in]  heading heading (millidegrees)
+ */
+void pbio_odometry_set_pose(pbio_odometry_t *odo, int32_t x, int32_t y, int32_t heading) {
+    odo->x = (int64_t)x * 1000;
+    odo->y = (int64_t)y * 1000;
+    if (odo->running) {
+        odo->heading_offset += heading - odo->heading;
+    }
+    odo->heading = heading;
+}
@@ -120,6 +120,58 @@ static pbio_control_settings_t settings_servo_default = {
     .actuation_scale = 100,
 };
 
+/**
+ * Gets the approximate no-load speed and mechanical time constant of a motor
+ * type. This is the one table of physical motor constants: the speed observer
+ * in the tacho uses it, and so do the simulated motors in drv/sim.
+ * @param [in]  id              The motor type
+ * @param [out] rate_max        No-load speed at maximum duty (deg/s), or 0 if unknown
+ * @param [out] time_constant   Mechanical time constant (ms), or 0 if unknown
+ */
+void pbio_servo_get_model(pbio_iodev_type_id_t id, int32_t *rate_max, int32_t *time_constant) {
+    switch (id) {
+        case PBIO_IODEV_TYPE_ID_EV3_MEDIUM_MOTOR:
+            *rate_max = 1600;
+            *time_constant = 15;
+            break;
+        case PBIO_IODEV_TYPE_ID_EV3_LARGE_MOTOR:
+            *rate_max = 1050;
+            *time_constant = 30;
+            break;
+        case PBIO_IODEV_TYPE_ID_MOVE_HUB_MOTOR:
+            *rate_max = 1500;
+            *time_constant = 20;
+            break;
+        case PBIO_IODEV_TYPE_ID_INTERACTIVE_MOTOR:
+            *rate_max = 1000;
+            *time_constant = 20;
+            break;
+        case PBIO_IODEV_TYPE_ID_CPLUS_L_MOTOR:
+        case PBIO_IODEV_TYPE_ID_SPIKE_M_MOTOR:
+            *rate_max = 1300;
+            *time_constant = 20;
+            break;
+        case PBIO_IODEV_TYPE_ID_CPLUS_XL_MOTOR:
+        case PBIO_IODEV_TYPE_ID_SPIKE_L_MOTOR:
+            *rate_max = 1050;
+            *time_constant = 30;
+            break;
+        default:
+            // Unknown motor, so estimate speed from the encoder only
+            *rate_max = 0;
+            *time_constant = 0;
+            break;
+    }
+}
+
+// Sets the motor model that helps the tacho estimate the speed
+static pbio_error_t load_servo_model(pbio_tacho_t *tacho, pbio_iodev_type_id_t id) {
+    int32_t rate_max;
+    int32_t time_constant;
+    pbio_servo_get_model(id, &rate_max, &time_constant);
+    return pbio_tacho_set_model(tacho, rate_max * PBDRV_CONFIG_COUNTER_COUNTS_PER_DEGREE, time_constant);
+}
+
 static void load_servo_settings(pbio_control_settings_t *s, pbio_iodev_type_id_t id) {
     switch (id) {
         case PBIO_IODEV_TYPE_ID_EV3_MEDIUM_MOTOR:
@@ -162,6 +214,9 @@ pbio_error_t pbio_servo_setup(pbio_servo_t *srv, pbio_direction_t direction, fix
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get, coast, and configure dc motor
     err = pbio_dcmotor_get(srv->port, &srv->dcmotor, direction, true);
     if (err != PBIO_SUCCESS) {
@@ -178,6 +233,10 @@ pbio_error_t pbio_servo_setup(pbio_servo_t *srv, pbio_direction_t direction, fix
 
     // Load default settings for this device type
     load_servo_settings(&srv->control.settings, srv->dcmotor->id);
+    err = load_servo_model(srv->tacho, srv->dcmotor->id);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
 
     // For a servo, counts per output unit is counts per degree at the gear train output
     srv->control.settings.counts_per_unit = fix16_mul(F16C(PBDRV_CONFIG_COUNTER_COUNTS_PER_DEGREE, 0), gear_ratio);
@@ -185,6 +244,9 @@ pbio_error_t pbio_servo_setup(pbio_servo_t *srv, pbio_direction_t direction, fix
     // Configure the logs for a servo
     srv->log.num_values = SERVO_LOG_NUM_VALUES;
 
+    // Pack time, count, and rate, and their references as the change since the previous row
+    srv->log.delta_mask = 1 << 0 | 1 << 1 | 1 << 2 | 1 << 3 | 1 << 6 | 1 << 7;
+
     return PBIO_SUCCESS;
 }
 
@@ -232,25 +294,30 @@ pbio_error_t pbio_servo_reset_angle(pbio_servo_t *srv, int32_t reset_angle, bool
 }
 
 // Get the physical state of a single motor
-static pbio_error_t servo_get_state(pbio_servo_t *srv, int32_t *time_now, int32_t *count_now, int32_t *rate_now) {
+pbio_error_t pbio_servo_get_state(pbio_servo_t *srv, int32_t time_now, int32_t *count_now, int32_t *rate_now) {
 
     pbio_error_t err;
 
-    // Read current state of this motor: current time, speed, and position
-    *time_now = clock_usecs();
-    err = pbio_tacho_get_count(srv->tacho, count_now);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
-    err = pbio_tacho_get_rate(srv->tacho, rate_now);
+    // The duty cycle applied so far helps to estimate the speed
+    pbio_passivity_t state;
+    int32_t duty_now;
+    err = pbio_dcmotor_get_state(srv->dcmotor, &state, &duty_now);
     if (err != PBIO_SUCCESS) {
         return err;
     }
-    return PBIO_SUCCESS;
+
+    // Read current state of this motor: speed and position
+    return pbio_tacho_get_state(srv->tacho, time_now, duty_now, count_now, rate_now);
+}
+
+// Get the physical state of a single motor along with the current time
+static pbio_error_t servo_get_state(pbio_servo_t *srv, int32_t *time_now, int32_t *count_now, int32_t *rate_now) {
+    *time_now = clock_usecs();
+    return pbio_servo_get_state(srv, *time_now, count_now, rate_now);
 }
 
 // Actuate a single motor
-static pbio_error_t pbio_servo_actuate(pbio_servo_t *srv, pbio_actuation_t actuation_type, int32_t control) {
+static pbio_error_t pbio_servo_actuate(pbio_servo_t *srv, int32_t time_now, pbio_actuation_t actuation_type, int32_t control) {
 
     // Apply the calculated actuation, by type
     switch (actuation_type)
@@ -260,7 +327,7 @@ static pbio_error_t pbio_servo_actuate(pbio_servo_t *srv, pbio_actuation_t actua
         case PBIO_ACTUATION_BRAKE:
             return pbio_dcmotor_brake(srv->dcmotor);
         case PBIO_ACTUATION_HOLD:
-            return pbio_control_start_hold_control(&srv->control, clock_usecs(), control);
+            return pbio_control_start_hold_control(&srv->control, time_now, control);
         case PBIO_ACTUATION_DUTY:
             return pbio_dcmotor_set_duty_cycle_sys(srv->dcmotor, control);
     }
@@ -310,16 +377,9 @@ static pbio_error_t pbio_servo_log_update(pbio_servo_t *srv, int32_t time_now, i
     return pbio_logger_update(&srv->log, buf);
 }
 
-pbio_error_t pbio_servo_control_update(pbio_servo_t *srv) {
+pbio_error_t pbio_servo_control_update(pbio_servo_t *srv, int32_t time_now, int32_t count_now, int32_t rate_now) {
 
-    // Read the physical state
-    int32_t time_now;
-    int32_t count_now;
-    int32_t rate_now;
-    pbio_error_t err = servo_get_state(srv, &time_now, &count_now, &rate_now);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
+    pbio_error_t err;
 
     // Control action to be calculated
     pbio_actuation_t actuation;
@@ -340,7 +400,7 @@ pbio_error_t pbio_servo_control_update(pbio_servo_t *srv) {
     control_update(&srv->control, time_now, count_now, rate_now, &actuation, &control);
 
     // Apply the control type and signal
-    err = pbio_servo_actuate(srv, actuation, control);
+    err = pbio_servo_actuate(srv, time_now, actuation, control);
     if (err != PBIO_SUCCESS) {
         return err;
     }
@@ -358,6 +418,9 @@ pbio_error_t pbio_servo_set_duty_cycle(pbio_servo_t *srv, int32_t duty_steps) {
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     pbio_control_stop(&srv->control);
     return pbio_dcmotor_set_duty_cycle_usr(srv->dcmotor, duty_steps);
 }
@@ -369,6 +432,9 @@ pbio_error_t pbio_servo_stop(pbio_servo_t *srv, pbio_actuation_t after_stop) {
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get control payload
     int32_t control;
     if (after_stop == PBIO_ACTUATION_HOLD) {
@@ -384,12 +450,13 @@ pbio_error_t pbio_servo_stop(pbio_servo_t *srv, pbio_actuation_t after_stop) {
     }
 
     // Apply the actuation
-    return pbio_servo_actuate(srv, after_stop, control);
+    return pbio_servo_actuate(srv, clock_usecs(), after_stop, control);
 }
 
 pbio_error_t pbio_servo_stop_force(pbio_servo_t *srv) {
     // Set control status passive so poll won't call it again
     pbio_control_stop(&srv->control);
+    srv->maneuver++;
 
     // Release claim from drivebases or other classes
     srv->claimed = false;
@@ -411,6 +478,9 @@ pbio_error_t pbio_servo_run(pbio_servo_t *srv, int32_t speed) {
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get target rate in unit of counts
     int32_t target_rate = pbio_control_user_to_counts(&srv->control.settings, speed);
 
@@ -444,6 +514,9 @@ pbio_error_t pbio_servo_run_time(pbio_servo_t *srv, int32_t speed, int32_t durat
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get target rate in unit of counts
     int32_t target_rate = pbio_control_user_to_counts(&srv->control.settings, speed);
 
@@ -467,6 +540,9 @@ pbio_error_t pbio_servo_run_until_stalled(pbio_servo_t *srv, int32_t speed, pbio
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get target rate in unit of counts
     int32_t target_rate = pbio_control_user_to_counts(&srv->control.settings, speed);
 
@@ -490,6 +566,9 @@ pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t tar
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get targets in unit of counts
     int32_t target_rate = pbio_control_user_to_counts(&srv->control.settings, speed);
     int32_t target_count = pbio_control_user_to_counts(&srv->control.settings, target);
@@ -504,6 +583,36 @@ pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t tar
     return pbio_control_start_angle_control(&srv->control, time_now, count_now, target_count, rate_now, target_rate, srv->control.settings.abs_acceleration, after_stop);
 }
 
+pbio_error_t pbio_servo_queue_target(pbio_servo_t *srv, int32_t speed, int32_t target, bool stop, pbio_actuation_t after_stop) {
+
+    pbio_error_t err;
+
+    // Return if this servo is already in use by higher level entity
+    if (srv->claimed) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    // Get targets in unit of counts
+    int32_t target_rate = pbio_control_user_to_counts(&srv->control.settings, speed);
+    int32_t target_count = pbio_control_user_to_counts(&srv->control.settings, target);
+
+    // Get the initial physical motor state.
+    int32_t time_now, count_now, rate_now;
+    err = servo_get_state(srv, &time_now, &count_now, &rate_now);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // If this starts a new maneuver instead of appending to the ongoing one,
+    // it replaces that one like any other command
+    bool starts_now = pbio_control_queue_starts_now(&srv->control);
+    err = pbio_control_queue_angle_control(&srv->control, time_now, count_now, target_count, rate_now, target_rate, stop, after_stop);
+    if (err == PBIO_SUCCESS && starts_now) {
+        srv->maneuver++;
+    }
+    return err;
+}
+
 pbio_error_t pbio_servo_run_angle(pbio_servo_t *srv, int32_t speed, int32_t angle, pbio_actuation_t after_stop) {
 
     pbio_error_t err;
@@ -513,6 +622,9 @@ pbio_error_t pbio_servo_run_angle(pbio_servo_t *srv, int32_t speed, int32_t angl
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get targets in unit of counts
     int32_t target_rate = pbio_control_user_to_counts(&srv->control.settings, speed);
     int32_t relative_target_count = pbio_control_user_to_counts(&srv->control.settings, angle);
@@ -535,6 +647,9 @@ pbio_error_t pbio_servo_track_target(pbio_servo_t *srv, int32_t target) {
         return PBIO_ERROR_INVALID_OP;
     }
 
+    // This replaces the ongoing maneuver, if any
+    srv->maneuver++;
+
     // Get the intitial state, either based on physical motor state or ongoing maneuver
     int32_t time_start = clock_usecs();
     int32_t target_count = pbio_control_user_to_counts(&srv->control.settings, target);
@@ -0,0 +1,494 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <contiki.h>
+
+#include <pbio/error.h>
+#include <pbio/math.h>
+#include <pbio/servogroup.h>
+
+#if PBDRV_CONFIG_NUM_MOTOR_CONTROLLER != 0
+
+// Fraction-free Gaussian elimination, to find out whether the mix can be
+// inverted without leaving integer arithmetic.
+static bool servogroup_mix_is_invertible(pbio_servogroup_t *grp) {
+    int64_t a[PBIO_CONFIG_SERVOGROUP_SIZE][PBIO_CONFIG_SERVOGROUP_SIZE];
+    uint8_t n = grp->size;
+
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t j = 0; j < n; j++) {
+            a[i][j] = grp->mix[i][j];
+        }
+    }
+
+    int64_t pivot_prev = 1;
+    for (uint8_t k = 0; k < n; k++) {
+        // Find a row with a nonzero pivot
+        if (a[k][k] == 0) {
+            uint8_t r = k + 1;
+            while (r < n && a[r][k] == 0) {
+                r++;
+            }
+            if (r == n) {
+                return false;
+            }
+            for (uint8_t j = 0; j < n; j++) {
+                int64_t swap = a[k][j];
+                a[k][j] = a[r][j];
+                a[r][j] = swap;
+            }
+        }
+        for (uint8_t i = k + 1; i < n; i++) {
+            for (uint8_t j = k + 1; j < n; j++) {
+                a[i][j] = (a[i][j] * a[k][k] - a[i][k] * a[k][j]) / pivot_prev;
+            }
+            a[i][k] = 0;
+        }
+        pivot_prev = a[k][k];
+    }
+    return a[n - 1][n - 1] != 0;
+}
+
+// Adopt settings for each axis from the servos it is made of
+static pbio_error_t servogroup_adopt_settings(pbio_servogroup_t *grp) {
+
+    pbio_control_settings_t *s_first = &grp->servos[0]->control.settings;
+
+    for (uint8_t i = 0; i < grp->size; i++) {
+        pbio_control_settings_t *s = &grp->control[i].settings;
+        memset(s, 0, sizeof(*s));
+        s->max_control = s_first->max_control;
+        s->stall_time = s_first->stall_time;
+
+        int32_t weight_sum = 0;
+        int32_t weight_sq_sum = 0;
+        int32_t pid_kp = 0;
+        int32_t pid_ki = 0;
+        int32_t pid_kd = 0;
+
+        for (uint8_t j = 0; j < grp->size; j++) {
+            pbio_control_settings_t *s_srv = &grp->servos[j]->control.settings;
+            int32_t w = abs(grp->mix[i][j]);
+            if (w == 0) {
+                continue;
+            }
+            weight_sum += w;
+            weight_sq_sum += w * w;
+
+            // Rate/count limits add up, because the axis state is a sum of motor states
+            s->max_rate += w * s_srv->max_rate;
+            s->rate_tolerance += w * s_srv->rate_tolerance;
+            s->count_tolerance += w * s_srv->count_tolerance;
+            s->stall_rate_limit += w * s_srv->stall_rate_limit;
+            s->integral_range += w * s_srv->integral_range;
+            s->integral_rate += w * s_srv->integral_rate;
+            s->abs_acceleration += w * s_srv->abs_acceleration;
+            s->abs_jerk += w * s_srv->abs_jerk;
+
+            // Weighted sum of gains, scaled down below
+            pid_kp += w * s_srv->pid_kp;
+            pid_ki += w * s_srv->pid_ki;
+            pid_kd += w * s_srv->pid_kd;
+
+            // Maxima are bound by the least capable motor
+            s->max_control = min(s->max_control, s_srv->max_control);
+            s->stall_time = min(s->stall_time, s_srv->stall_time);
+        }
+
+        // The control signal of an axis is applied to each motor with its weight,
+        // and moves the axis by the weight again. So, the loop gain grows with the
+        // sum of squared weights, and we use the weighted average gain divided by it.
+        // Gains are small integers, so round to nearest rather than truncate.
+        int32_t gain_div = weight_sum * weight_sq_sum;
+        s->pid_kp = (pid_kp + gain_div / 2) / gain_div;
+        s->pid_ki = (pid_ki + gain_div / 2) / gain_div;
+        s->pid_kd = (pid_kd + gain_div / 2) / gain_div;
+
+        // We require that actuation scale and offsets are the same for all motors, and use them as-is
+        s->actuation_scale = s_first->actuation_scale;
+        s->control_offset = s_first->control_offset;
+
+        // Axis units are those of the servos, with the weights applied
+        s->counts_per_unit = s_first->counts_per_unit;
+        s->jerk = pbio_control_counts_to_user(s, s->abs_jerk);
+    }
+
+    for (uint8_t j = 1; j < grp->size; j++) {
+        pbio_control_settings_t *s_srv = &grp->servos[j]->control.settings;
+        if (s_srv->actuation_scale != s_first->actuation_scale ||
+            s_srv->control_offset != s_first->control_offset ||
+            s_srv->counts_per_unit != s_first->counts_per_unit) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+// Get the state of each axis from the state of the servos
+static void servogroup_combine_state(pbio_servogroup_t *grp, const int32_t *count, const int32_t *rate, int32_t *axis_count, int32_t *axis_rate) {
+    for (uint8_t i = 0; i < grp->size; i++) {
+        axis_count[i] = 0;
+        axis_rate[i] = 0;
+        for (uint8_t j = 0; j < grp->size; j++) {
+            axis_count[i] += grp->mix[i][j] * count[j];
+            axis_rate[i] += grp->mix[i][j] * rate[j];
+        }
+    }
+}
+
+// Get the physical state of each axis
+static pbio_error_t servogroup_get_state(pbio_servogroup_t *grp, int32_t *time_now, int32_t *axis_count, int32_t *axis_rate) {
+
+    int32_t count[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+
+    *time_now = clock_usecs();
+
+    for (uint8_t j = 0; j < grp->size; j++) {
+        pbio_error_t err = pbio_servo_get_state(grp->servos[j], *time_now, &count[j], &rate[j]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    servogroup_combine_state(grp, count, rate, axis_count, axis_rate);
+    return PBIO_SUCCESS;
+}
+
+// Apply a passive actuation to all servos, or distribute the axis duty cycles over the servos
+static pbio_error_t servogroup_actuate(pbio_servogroup_t *grp, pbio_actuation_t actuation, const int32_t *axis_control) {
+    pbio_error_t err;
+
+    for (uint8_t j = 0; j < grp->size; j++) {
+        pbio_dcmotor_t *dcmotor = grp->servos[j]->dcmotor;
+        switch (actuation) {
+            case PBIO_ACTUATION_COAST:
+                err = pbio_dcmotor_coast(dcmotor);
+                break;
+            case PBIO_ACTUATION_BRAKE:
+                err = pbio_dcmotor_brake(dcmotor);
+                break;
+            case PBIO_ACTUATION_DUTY: {
+                int32_t duty = 0;
+                for (uint8_t i = 0; i < grp->size; i++) {
+                    duty += grp->mix[i][j] * axis_control[i];
+                }
+                err = pbio_dcmotor_set_duty_cycle_sys(dcmotor, duty);
+                break;
+            }
+            default:
+                err = PBIO_ERROR_INVALID_ARG;
+                break;
+        }
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    // Passive actuation ends the use of the servos by this group
+    if (actuation != PBIO_ACTUATION_DUTY) {
+        pbio_servogroup_claim_servos(grp, false);
+    }
+    return PBIO_SUCCESS;
+}
+
+// Log the state and control signal of each axis
+static pbio_error_t servogroup_log_update(pbio_servogroup_t *grp, int32_t time_now, const int32_t *axis_count, const int32_t *axis_rate, const int32_t *axis_control) {
+    int32_t buf[MAX_LOG_VALUES];
+    buf[0] = (time_now - grp->log.start) / 1000;
+    for (uint8_t i = 0; i < grp->size; i++) {
+        buf[1 + i * 3] = axis_count[i];
+        buf[2 + i * 3] = axis_rate[i];
+        buf[3 + i * 3] = axis_control[i];
+    }
+    return pbio_logger_update(&grp->log, buf);
+}
+
+/**
+ * Sets up a group of servos.
+ * @param [in]  grp     the group
+ * @param [in]  servos  distinct servos with the same gearing
+ * @param [in]  size    number of servos, which is also the number of axes
+ * @param [in]  mix     @p size by @p size invertible mixing matrix, row by row.
+ *                      If NULL, two servos are mixed into their sum and difference,
+ *                      and any other number of servos is controlled one by one.
+ */
+pbio_error_t pbio_servogroup_setup(pbio_servogroup_t *grp, pbio_servo_t **servos, uint8_t size, const int8_t *mix) {
+    pbio_error_t err;
+
+    if (size == 0 || size > PBIO_CONFIG_SERVOGROUP_SIZE || NUM_DEFAULT_LOG_VALUES + 1 + size * 3 > MAX_LOG_VALUES) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Each servo may be used only once
+    for (uint8_t j = 0; j < size; j++) {
+        for (uint8_t k = j + 1; k < size; k++) {
+            if (servos[j] == servos[k]) {
+                return PBIO_ERROR_INVALID_ARG;
+            }
+        }
+    }
+
+    // Stop any existing group motion
+    err = pbio_servogroup_stop_force(grp);
+    if (!(err == PBIO_SUCCESS || err == PBIO_ERROR_NO_DEV)) {
+        return err;
+    }
+
+    // Reset all motors to a passive state
+    for (uint8_t j = 0; j < size; j++) {
+        err = pbio_servo_stop(servos[j], PBIO_ACTUATION_COAST);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    grp->size = size;
+    for (uint8_t i = 0; i < size; i++) {
+        grp->servos[i] = servos[i];
+        for (uint8_t j = 0; j < size; j++) {
+            if (mix) {
+                grp->mix[i][j] = mix[i * size + j];
+            } else if (size == 2) {
+                grp->mix[i][j] = i == 1 && j == 1 ? -1 : 1;
+            } else {
+                grp->mix[i][j] = i == j;
+            }
+        }
+    }
+
+    if (!servogroup_mix_is_invertible(grp)) {
+        grp->size = 0;
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    err = servogroup_adopt_settings(grp);
+    if (err != PBIO_SUCCESS) {
+        grp->size = 0;
+        return err;
+    }
+    pbio_servogroup_claim_servos(grp, false);
+
+    // Log time, and the count, rate, and control of each axis
+    grp->log.num_values = NUM_DEFAULT_LOG_VALUES + 1 + size * 3;
+    grp->log.delta_mask = 1 << 0 | 1 << 1;
+    for (uint8_t i = 0; i < size; i++) {
+        grp->log.delta_mask |= 1 << (2 + i * 3) | 1 << (3 + i * 3);
+    }
+
+    return PBIO_SUCCESS;
+}
+
+// Claim servos so that they cannot be used independently
+void pbio_servogroup_claim_servos(pbio_servogroup_t *grp, bool claim) {
+    for (uint8_t j = 0; j < grp->size; j++) {
+        pbio_control_stop(&grp->servos[j]->control);
+        grp->servos[j]->maneuver++;
+        grp->servos[j]->claimed = claim;
+    }
+}
+
+bool pbio_servogroup_is_done(pbio_servogroup_t *grp) {
+    for (uint8_t i = 0; i < grp->size; i++) {
+        if (!pbio_control_is_done(&grp->control[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool pbio_servogroup_is_passive(pbio_servogroup_t *grp) {
+    for (uint8_t i = 0; i < grp->size; i++) {
+        if (grp->control[i].type != PBIO_CONTROL_NONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+pbio_error_t pbio_servogroup_update(pbio_servogroup_t *grp, int32_t time_now, const int32_t *count, const int32_t *rate) {
+
+    int32_t axis_count[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_control[PBIO_CONFIG_SERVOGROUP_SIZE];
+    servogroup_combine_state(grp, count, rate, axis_count, axis_rate);
+
+    // Axes without control do not contribute to the motor duty
+    bool active = false;
+    pbio_actuation_t passive = PBIO_ACTUATION_COAST;
+    for (uint8_t i = 0; i < grp->size; i++) {
+        axis_control[i] = 0;
+        if (grp->control[i].type == PBIO_CONTROL_NONE) {
+            continue;
+        }
+        pbio_actuation_t actuation;
+        control_update(&grp->control[i], time_now, axis_count[i], axis_rate[i], &actuation, &axis_control[i]);
+        if (actuation == PBIO_ACTUATION_DUTY) {
+            active = true;
+        } else {
+            // The axis just completed its maneuver and stopped itself
+            passive = actuation;
+            axis_control[i] = 0;
+        }
+    }
+
+    // Actuate if any axis is still active. Otherwise apply the passive
+    // actuation if the last maneuver just completed, or just log if idle.
+    pbio_error_t err = PBIO_SUCCESS;
+    if (active) {
+        err = servogroup_actuate(grp, PBIO_ACTUATION_DUTY, axis_control);
+    } else if (grp->servos[0]->claimed) {
+        err = servogroup_actuate(grp, passive, axis_control);
+    }
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return servogroup_log_update(grp, time_now, axis_count, axis_rate, axis_control);
+}
+
+// Claim the servos and start holding the axes that are not doing anything
+static pbio_error_t servogroup_start(pbio_servogroup_t *grp, uint8_t axis, int32_t *time_now, int32_t *axis_count, int32_t *axis_rate) {
+
+    if (axis >= grp->size) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    pbio_error_t err = servogroup_get_state(grp, time_now, axis_count, axis_rate);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Claiming the servos stops their own control, so only do it when starting from passive
+    if (!grp->servos[0]->claimed) {
+        pbio_servogroup_claim_servos(grp, true);
+    }
+
+    for (uint8_t i = 0; i < grp->size; i++) {
+        if (i != axis && grp->control[i].type == PBIO_CONTROL_NONE) {
+            err = pbio_control_start_hold_control(&grp->control[i], *time_now, axis_count[i]);
+            if (err != PBIO_SUCCESS) {
+                return err;
+            }
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+pbio_error_t pbio_servogroup_run(pbio_servogroup_t *grp, uint8_t axis, int32_t speed) {
+
+    // This replaces the ongoing maneuver
+    grp->maneuver++;
+
+    int32_t time_now;
+    int32_t axis_count[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+    pbio_error_t err = servogroup_start(grp, axis, &time_now, axis_count, axis_rate);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    pbio_control_t *ctl = &grp->control[axis];
+    int32_t target_rate = pbio_control_user_to_counts(&ctl->settings, speed);
+    return pbio_control_start_timed_control(ctl, time_now, DURATION_FOREVER, axis_count[axis], axis_rate[axis], target_rate, ctl->settings.abs_acceleration, pbio_control_on_target_never, PBIO_ACTUATION_COAST);
+}
+
+pbio_error_t pbio_servogroup_run_target(pbio_servogroup_t *grp, uint8_t axis, int32_t speed, int32_t target, pbio_actuation_t after_stop) {
+
+    // This replaces the ongoing maneuver
+    grp->maneuver++;
+
+    int32_t time_now;
+    int32_t axis_count[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+    pbio_error_t err = servogroup_start(grp, axis, &time_now, axis_count, axis_rate);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    pbio_control_t *ctl = &grp->control[axis];
+    int32_t target_rate = pbio_control_user_to_counts(&ctl->settings, speed);
+    int32_t target_count = pbio_control_user_to_counts(&ctl->settings, target);
+    return pbio_control_start_angle_control(ctl, time_now, axis_count[axis], target_count, axis_rate[axis], target_rate, ctl->settings.abs_acceleration, after_stop);
+}
+
+pbio_error_t pbio_servogroup_stop(pbio_servogroup_t *grp, pbio_actuation_t after_stop) {
+
+    int32_t time_now;
+    int32_t axis_count[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_control[PBIO_CONFIG_SERVOGROUP_SIZE] = { 0 };
+    pbio_error_t err;
+
+    // This replaces the ongoing maneuver
+    grp->maneuver++;
+
+    if (after_stop != PBIO_ACTUATION_HOLD) {
+        for (uint8_t i = 0; i < grp->size; i++) {
+            pbio_control_stop(&grp->control[i]);
+        }
+        return servogroup_actuate(grp, after_stop, axis_control);
+    }
+
+    // Hold all axes where they are now
+    err = servogroup_get_state(grp, &time_now, axis_count, axis_rate);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    if (!grp->servos[0]->claimed) {
+        pbio_servogroup_claim_servos(grp, true);
+    }
+    for (uint8_t i = 0; i < grp->size; i++) {
+        err = pbio_control_start_hold_control(&grp->control[i], time_now, axis_count[i]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+pbio_error_t pbio_servogroup_stop_force(pbio_servogroup_t *grp) {
+
+    // Stop control so polling will stop
+    grp->maneuver++;
+    for (uint8_t i = 0; i < PBIO_CONFIG_SERVOGROUP_SIZE; i++) {
+        pbio_control_stop(&grp->control[i]);
+    }
+
+    if (grp->size == 0) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    // Try to stop all servos
+    for (uint8_t j = 0; j < grp->size; j++) {
+        pbio_error_t err = pbio_servo_stop_force(grp->servos[j]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+pbio_error_t pbio_servogroup_get_state(pbio_servogroup_t *grp, uint8_t axis, int32_t *angle, int32_t *speed) {
+
+    if (axis >= grp->size) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    int32_t time_now;
+    int32_t axis_count[PBIO_CONFIG_SERVOGROUP_SIZE];
+    int32_t axis_rate[PBIO_CONFIG_SERVOGROUP_SIZE];
+    pbio_error_t err = servogroup_get_state(grp, &time_now, axis_count, axis_rate);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    pbio_control_settings_t *s = &grp->control[axis].settings;
+    *angle = pbio_control_counts_to_user(s, axis_count[axis]);
+    *speed = pbio_control_counts_to_user(s, axis_rate[axis]);
+    return PBIO_SUCCESS;
+}
+
+#endif // PBDRV_CONFIG_NUM_MOTOR_CONTROLLER
@@ -16,6 +16,7 @@ struct _pbio_tacho_t {
     int32_t offset;
     fix16_t counts_per_degree;
     pbdrv_counter_dev_t *counter;
+    pbio_observer_t observer;
 };
 
 static pbio_tacho_t tachos[PBDRV_CONFIG_NUM_MOTOR_CONTROLLER];
@@ -64,6 +65,10 @@ static pbio_error_t pbio_tacho_setup(pbio_tacho_t *tacho, uint8_t counter_id, pb
     // Configure direction
     tacho->direction = direction;
 
+    // Start rate estimation from scratch, without a motor model
+    tacho->observer.running = false;
+    pbio_observer_set_model(&tacho->observer, 0, 0);
+
     // Get counter device
     pbio_error_t err = pbdrv_counter_get_dev(counter_id, &tacho->counter);
     if (err != PBIO_SUCCESS) {
@@ -164,4 +169,48 @@ pbio_error_t pbio_tacho_get_angular_rate(pbio_tacho_t *tacho, int32_t *angular_r
     return PBIO_SUCCESS;
 }
 
+// Set the motor model used for rate estimation. The rate is in counts/s at
+// maximum duty and the time constant is in ms. A rate of 0 disables the model.
+pbio_error_t pbio_tacho_set_model(pbio_tacho_t *tacho, int32_t rate_max, int32_t time_constant) {
+    if (rate_max < 0 || time_constant < 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    pbio_observer_set_model(&tacho->observer, rate_max, time_constant);
+    return PBIO_SUCCESS;
+}
+
+// Get the count along with the estimated rate, given the duty cycle applied since the previous call
+pbio_error_t pbio_tacho_get_state(pbio_tacho_t *tacho, int32_t time_now, int32_t duty, int32_t *count, int32_t *rate) {
+    pbio_error_t err;
+
+    err = pbio_tacho_get_count(tacho, count);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    int32_t rate_raw;
+    err = pbio_tacho_get_rate(tacho, &rate_raw);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // The observer works without the offset, so that resetting the count does not disturb it
+    pbio_observer_update(&tacho->observer, time_now, *count + tacho->offset, rate_raw, duty);
+
+    int32_t count_est, acceleration;
+    pbio_observer_get_estimated_state(&tacho->observer, &count_est, rate, &acceleration);
+
+    return PBIO_SUCCESS;
+}
+
+// Get the rate and acceleration as estimated on the last call to pbio_tacho_get_state
+pbio_error_t pbio_tacho_get_estimated_state(pbio_tacho_t *tacho, int32_t *rate, int32_t *acceleration) {
+    if (!tacho->observer.running) {
+        return PBIO_ERROR_AGAIN;
+    }
+    int32_t count_est;
+    pbio_observer_get_estimated_state(&tacho->observer, &count_est, rate, acceleration);
+    return PBIO_SUCCESS;
+}
+
 #endif // PBIO_CONFIG_TACHO
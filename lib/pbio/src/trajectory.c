@@ -45,7 +45,29 @@ void reverse_trajectory(pbio_trajectory_t *ref) {
     ref->a2 *= -1;
 }
 
+// Longest duration of the jerk phases of an S-curve
+#define JERK_TIME_MAX (500 * US_PER_MS)
+
+void pbio_trajectory_set_type(pbio_trajectory_t *ref, pbio_trajectory_type_t type, int32_t jerk) {
+    ref->type = jerk > 0 ? type : PBIO_TRAJECTORY_TYPE_TRAPEZOID;
+    ref->jerk = jerk;
+}
+
+// Gets the duration of the jerk phases for the given acceleration, or 0 for trapezoids
+static int32_t get_jerk_time(pbio_trajectory_t *ref, int32_t a) {
+    if (ref->type != PBIO_TRAJECTORY_TYPE_S_CURVE) {
+        return 0;
+    }
+    return min((a * MS_PER_SECOND) / ref->jerk, JERK_TIME_MAX / US_PER_MS) * US_PER_MS;
+}
+
 void pbio_trajectory_make_stationary(pbio_trajectory_t *ref, int32_t t0, int32_t th0) {
+    // Discard previously evaluated references
+    ref->cache_phase = PBIO_TRAJECTORY_PHASE_NONE;
+
+    // There is nothing to smooth
+    ref->tj = 0;
+
     // All times equal to initial time:
     ref->t0 = t0;
     ref->t1 = t0;
@@ -82,7 +104,7 @@ static int64_t x_time2(int32_t b, int32_t t) {
     return x_time(x_time(b, t), t) / (2 * US_PER_MS);
 }
 
-pbio_error_t pbio_trajectory_make_time_based(pbio_trajectory_t *ref, int32_t t0, int32_t duration, int32_t th0, int32_t th0_ext, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax) {
+static pbio_error_t make_time_based(pbio_trajectory_t *ref, int32_t t0, int32_t duration, int32_t th0, int32_t th0_ext, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax, int32_t jerk_scale) {
 
     // Work with time intervals instead of absolute time. Read 'm' as '-'.
     int32_t t3mt0;
@@ -121,6 +143,13 @@ pbio_error_t pbio_trajectory_make_time_based(pbio_trajectory_t *ref, int32_t t0,
     // Limit absolute acceleration
     a = min(a, amax);
 
+    // S-curves end tj after the trapezoid, so leave room for that
+    ref->tj = get_jerk_time(ref, a * jerk_scale);
+    if (!ref->forever) {
+        ref->tj = min(ref->tj, t3mt0);
+        t3mt0 -= ref->tj;
+    }
+
     // Limit initial speed
     int32_t max_init = timest(a, t3mt0);
     int32_t abs_max = min(wmax, max_init);
@@ -176,8 +205,9 @@ pbio_error_t pbio_trajectory_make_time_based(pbio_trajectory_t *ref, int32_t t0,
     ref->t2 = t0 + t1mt0 + t2mt1;
     ref->t3 = t0 + t3mt0;
 
-    // Corresponding angle values with millicount/millideg precision
-    int64_t mth0 = as_mcount(th0, th0_ext);
+    // Corresponding angle values with millicount/millideg precision. S-curves
+    // lag behind the trapezoid by half the jerk time, so start it ahead of th0.
+    int64_t mth0 = as_mcount(th0, th0_ext) + (backward ? -1 : 1) * x_time(w0, ref->tj) / 2;
     int64_t mth1 = mth0 + x_time(ref->w0, t1mt0) + x_time2(ref->a0, t1mt0);
     int64_t mth2 = mth1 + x_time(ref->w1, t2mt1);
     int64_t mth3 = mth2 + x_time(ref->w1, t3mt2) + x_time2(ref->a2, t3mt2);
@@ -196,12 +226,17 @@ pbio_error_t pbio_trajectory_make_time_based(pbio_trajectory_t *ref, int32_t t0,
     return PBIO_SUCCESS;
 }
 
-pbio_error_t pbio_trajectory_make_angle_based(pbio_trajectory_t *ref, int32_t t0, int32_t th0, int32_t th3, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax) {
+static pbio_error_t make_angle_based(pbio_trajectory_t *ref, int32_t t0, int32_t th0, int32_t th3, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax, int32_t jerk_scale) {
 
     // Return error for zero speed
     if (wt == 0) {
         return PBIO_ERROR_INVALID_ARG;
     }
+
+    // S-curves lag behind the trapezoid by half the jerk time, so start it ahead of th0
+    ref->tj = get_jerk_time(ref, min(a, amax) * jerk_scale);
+    th0 += x_time(w0, ref->tj) / 2000;
+
     // Return error for maneuver that is too long
     if (abs((th3 - th0) / wt) + 1 > DURATION_MAX_S) {
         return PBIO_ERROR_INVALID_ARG;
@@ -298,35 +333,249 @@ pbio_error_t pbio_trajectory_make_angle_based(pbio_trajectory_t *ref, int32_t t0
     return PBIO_SUCCESS;
 }
 
-// Evaluate the reference speed and velocity at the (shifted) time
-void pbio_trajectory_get_reference(pbio_trajectory_t *traject, int32_t time_ref, int32_t *count_ref, int32_t *count_ref_ext, int32_t *rate_ref, int32_t *acceleration_ref) {
+// S-curves change the acceleration over tj. If it goes from accelerating to
+// decelerating within that time, the change is twice as big, so it must be
+// spread over twice the time to keep the same jerk.
+static bool jerk_time_too_short(pbio_trajectory_t *ref) {
+    return ref->tj > 0 && ref->t1 != ref->t0 && ref->a0 != ref->a2 && ref->t2 - ref->t1 < ref->tj;
+}
+
+pbio_error_t pbio_trajectory_make_time_based(pbio_trajectory_t *ref, int32_t t0, int32_t duration, int32_t th0, int32_t th0_ext, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax) {
+
+    // Discard previously evaluated references
+    ref->cache_phase = PBIO_TRAJECTORY_PHASE_NONE;
+
+    pbio_error_t err = make_time_based(ref, t0, duration, th0, th0_ext, w0, wt, wmax, a, amax, 1);
+    if (err == PBIO_SUCCESS && jerk_time_too_short(ref)) {
+        err = make_time_based(ref, t0, duration, th0, th0_ext, w0, wt, wmax, a, amax, 2);
+    }
+    return err;
+}
+
+pbio_error_t pbio_trajectory_make_angle_based(pbio_trajectory_t *ref, int32_t t0, int32_t th0, int32_t th3, int32_t w0, int32_t wt, int32_t wmax, int32_t a, int32_t amax) {
+
+    // Discard previously evaluated references
+    ref->cache_phase = PBIO_TRAJECTORY_PHASE_NONE;
+
+    pbio_error_t err = make_angle_based(ref, t0, th0, th3, w0, wt, wmax, a, amax, 1);
+    if (err == PBIO_SUCCESS && jerk_time_too_short(ref)) {
+        err = make_angle_based(ref, t0, th0, th3, w0, wt, wmax, a, amax, 2);
+    }
+    return err;
+}
+
+// Largest time step for which the constant speed phase is advanced incrementally
+#define INCREMENT_MAX (100 * US_PER_MS)
+
+// Division by a positive divisor, rounding towards minus infinity
+static int32_t div_floor(int32_t a, int32_t b) {
+    int32_t q = a / b;
+    return a - q * b < 0 ? q - 1 : q;
+}
+
+static int64_t div_floor64(int64_t a, int32_t b) {
+    int64_t q = a / b;
+    return a - q * b < 0 ? q - 1 : q;
+}
+
+// Gets the phase of the reference. For S-curves, the phases are taken to
+// include the tj microseconds over which the trapezoid is averaged.
+static pbio_trajectory_phase_t get_phase(pbio_trajectory_t *traject, int32_t time_ref) {
+    if (time_ref - traject->tj - traject->t1 < 0) {
+        return PBIO_TRAJECTORY_PHASE_ACCELERATE;
+    }
+    if (traject->forever || time_ref - traject->t2 <= 0) {
+        return PBIO_TRAJECTORY_PHASE_CONSTANT;
+    }
+    if (time_ref - traject->tj - traject->t3 <= 0) {
+        return PBIO_TRAJECTORY_PHASE_DECELERATE;
+    }
+    return PBIO_TRAJECTORY_PHASE_HOLD;
+}
+
+// Starting point of one segment of the trapezoid
+typedef struct {
+    int32_t time;
+    int64_t mcount;
+    int32_t rate;
+    int32_t acceleration;
+} segment_t;
+
+// Evaluates an S-curve reference by averaging the position of the trapezoid
+// over the last tj microseconds. Its derivatives are the differences of the
+// trapezoid rate and position across that window, divided by tj.
+static void get_reference_s_curve(pbio_trajectory_t *traject, int32_t time_ref) {
+
+    // Segments of the trapezoid, which continues at its initial speed before t0
+    segment_t segments[] = {
+        { traject->t0, as_mcount(traject->th0, traject->th0_ext), traject->w0, 0 },
+        { traject->t0, as_mcount(traject->th0, traject->th0_ext), traject->w0, traject->a0 },
+        { traject->t1, as_mcount(traject->th1, traject->th1_ext), traject->w1, 0 },
+        { traject->t2, as_mcount(traject->th2, traject->th2_ext), traject->w1, traject->a2 },
+        { traject->t3, as_mcount(traject->th3, traject->th3_ext), 0, 0 },
+    };
+    int n = traject->forever ? 3 : 5;
+
+    int32_t time = time_ref - traject->tj;
+    int64_t mcount_start = 0;
+    int64_t mcount = 0;
+    int32_t rate_start = 0;
+    int32_t rate = 0;
+    int64_t sum = 0;
+    bool first = true;
+
+    for (int i = 0; i < n; i++) {
+        segment_t *segment = &segments[i];
+
+        // Skip the segments that end before the remainder of the window
+        if (i + 1 < n && segments[i + 1].time - time <= 0) {
+            continue;
+        }
+
+        // Evaluate the trapezoid where the window enters this segment
+        int32_t dt = time - segment->time;
+        mcount = segment->mcount + x_time(segment->rate, dt) + x_time2(segment->acceleration, dt);
+        rate = segment->rate + (((int64_t)segment->acceleration) * dt) / US_PER_SECOND;
+        if (first) {
+            mcount_start = mcount;
+            rate_start = rate;
+            first = false;
+        }
+
+        // Add the mean position in this segment, weighted by its duration
+        int32_t end = i + 1 < n && segments[i + 1].time - time_ref < 0 ? segments[i + 1].time : time_ref;
+        int32_t duration = end - time;
+        sum += (mcount - mcount_start + x_time(rate, duration) / 2 + x_time2(segment->acceleration, duration) / 3) * duration;
+
+        // Evaluate the trapezoid where the window ends
+        if (end == time_ref) {
+            mcount += x_time(rate, duration) + x_time2(segment->acceleration, duration);
+            rate += (((int64_t)segment->acceleration) * duration) / US_PER_SECOND;
+            break;
+        }
+        time = end;
+    }
+
+    traject->cache_rate = ((mcount - mcount_start) * 1000) / traject->tj;
+    traject->cache_acceleration = (((int64_t)(rate - rate_start)) * US_PER_SECOND) / traject->tj;
+    as_count(mcount_start + sum / traject->tj, &traject->cache_count, &traject->cache_count_ext);
+}
+
+// Evaluates the reference from the start of the given phase
+static void get_reference_in_phase(pbio_trajectory_t *traject, pbio_trajectory_phase_t phase, int32_t time_ref) {
 
     int64_t mcount_ref;
 
-    if (time_ref - traject->t1 < 0) {
-        // If we are here, then we are still in the acceleration phase. Includes conversion from microseconds to seconds, in two steps to avoid overflows and round off errors
-        *rate_ref = traject->w0 + timest(traject->a0, time_ref - traject->t0);
-        mcount_ref = as_mcount(traject->th0, traject->th0_ext) + x_time(traject->w0, time_ref - traject->t0) + x_time2(traject->a0, time_ref - traject->t0);
-        *acceleration_ref = traject->a0;
-    } else if (traject->forever || time_ref - traject->t2 <= 0) {
-        // If we are here, then we are in the constant speed phase
-        *rate_ref = traject->w1;
-        mcount_ref = as_mcount(traject->th1, traject->th1_ext) + x_time(traject->w1, time_ref - traject->t1);
-        *acceleration_ref = 0;
-    } else if (time_ref - traject->t3 <= 0) {
-        // If we are here, then we are in the deceleration phase
-        *rate_ref = traject->w1 + timest(traject->a2,    time_ref - traject->t2);
-        mcount_ref = as_mcount(traject->th2, traject->th2_ext) + x_time(traject->w1, time_ref - traject->t2) + x_time2(traject->a2, time_ref - traject->t2);
-        *acceleration_ref = traject->a2;
-    } else {
-        // If we are here, we are in the zero speed phase (relevant when holding position)
-        *rate_ref = 0;
-        mcount_ref = as_mcount(traject->th3, traject->th3_ext);
-        *acceleration_ref = 0;
+    // S-curves only differ from the trapezoid while the acceleration changes
+    if (traject->tj > 0 && (phase == PBIO_TRAJECTORY_PHASE_ACCELERATE || phase == PBIO_TRAJECTORY_PHASE_DECELERATE)) {
+        get_reference_s_curve(traject, time_ref);
+        return;
+    }
+
+    switch (phase) {
+        case PBIO_TRAJECTORY_PHASE_ACCELERATE:
+            // If we are here, then we are still in the acceleration phase. Includes conversion from microseconds to seconds, in two steps to avoid overflows and round off errors
+            traject->cache_rate = traject->w0 + timest(traject->a0, time_ref - traject->t0);
+            mcount_ref = as_mcount(traject->th0, traject->th0_ext) + x_time(traject->w0, time_ref - traject->t0) + x_time2(traject->a0, time_ref - traject->t0);
+            traject->cache_acceleration = traject->a0;
+            break;
+        case PBIO_TRAJECTORY_PHASE_CONSTANT: {
+            // If we are here, then we are in the constant speed phase. Also
+            // keep the intermediate results needed to advance incrementally.
+            // S-curves are the trapezoid delayed by half the jerk time here.
+            int64_t dist = ((int64_t)traject->w1) * (time_ref - traject->tj / 2 - traject->t1);
+            traject->cache_dist = div_floor64(dist, US_PER_MS);
+            traject->cache_dist_rem = dist - traject->cache_dist * US_PER_MS;
+            traject->cache_rate = traject->w1;
+            mcount_ref = as_mcount(traject->th1, traject->th1_ext) + dist / US_PER_MS;
+            traject->cache_mcount_div = div_floor64(mcount_ref, 1000);
+            traject->cache_mcount_rem = mcount_ref - ((int64_t)traject->cache_mcount_div) * 1000;
+            traject->cache_acceleration = 0;
+            break;
+        }
+        case PBIO_TRAJECTORY_PHASE_DECELERATE:
+            // If we are here, then we are in the deceleration phase
+            traject->cache_rate = traject->w1 + timest(traject->a2,    time_ref - traject->t2);
+            mcount_ref = as_mcount(traject->th2, traject->th2_ext) + x_time(traject->w1, time_ref - traject->t2) + x_time2(traject->a2, time_ref - traject->t2);
+            traject->cache_acceleration = traject->a2;
+            break;
+        default:
+            // If we are here, we are in the zero speed phase (relevant when holding position)
+            traject->cache_rate = 0;
+            mcount_ref = as_mcount(traject->th3, traject->th3_ext);
+            traject->cache_acceleration = 0;
+            break;
     }
 
     // Split high res angle into counts and millicounts
-    as_count(mcount_ref, count_ref, count_ref_ext);
+    as_count(mcount_ref, &traject->cache_count, &traject->cache_count_ext);
+}
+
+// Advances the constant speed phase reference by a short time step. This
+// gives exactly the same result as evaluating it from the start of the phase,
+// but using only 32-bit division.
+static void advance_constant_phase(pbio_trajectory_t *traject, int32_t dt) {
+
+    // Like x_time, the distance from the start of the phase rounds towards zero
+    int32_t round_old = traject->cache_dist < 0 && traject->cache_dist_rem != 0;
+
+    // Advance the distance w1 * dt / 1000 in floored quotient and remainder form
+    int32_t step = traject->w1 * dt;
+    int32_t step_div = div_floor(step, US_PER_MS);
+    traject->cache_dist_rem += step - step_div * US_PER_MS;
+    if (traject->cache_dist_rem >= US_PER_MS) {
+        traject->cache_dist_rem -= US_PER_MS;
+        step_div++;
+    }
+    traject->cache_dist += step_div;
+
+    int32_t round_new = traject->cache_dist < 0 && traject->cache_dist_rem != 0;
+
+    // Apply the change of the rounded distance to the millicount reference
+    traject->cache_mcount_rem += step_div + round_new - round_old;
+    int32_t carry = div_floor(traject->cache_mcount_rem, 1000);
+    traject->cache_mcount_div += carry;
+    traject->cache_mcount_rem -= carry * 1000;
+
+    // Split into counts and millicounts like as_count, which rounds towards zero
+    if (traject->cache_mcount_div < 0 && traject->cache_mcount_rem != 0) {
+        traject->cache_count = traject->cache_mcount_div + 1;
+        traject->cache_count_ext = traject->cache_mcount_rem - 1000;
+    } else {
+        traject->cache_count = traject->cache_mcount_div;
+        traject->cache_count_ext = traject->cache_mcount_rem;
+    }
+}
+
+// Evaluate the reference speed and velocity at the (shifted) time
+void pbio_trajectory_get_reference(pbio_trajectory_t *traject, int32_t time_ref, int32_t *count_ref, int32_t *count_ref_ext, int32_t *rate_ref, int32_t *acceleration_ref) {
+
+    pbio_trajectory_phase_t phase = traject->cache_phase;
+    int32_t dt = time_ref - traject->cache_time;
+
+    // The reference is evaluated several times per control loop iteration at
+    // the same time, so only compute it if something changed.
+    if (phase == PBIO_TRAJECTORY_PHASE_NONE || dt != 0) {
+        phase = get_phase(traject, time_ref);
+
+        if (phase == PBIO_TRAJECTORY_PHASE_HOLD && traject->cache_phase == PBIO_TRAJECTORY_PHASE_HOLD) {
+            // The reference does not change while holding
+        } else if (phase == PBIO_TRAJECTORY_PHASE_CONSTANT && traject->cache_phase == PBIO_TRAJECTORY_PHASE_CONSTANT &&
+                   dt > 0 && dt <= INCREMENT_MAX && abs(traject->w1) <= INT32_MAX / INCREMENT_MAX) {
+            // Move forward from the previous point, avoiding 64-bit math
+            advance_constant_phase(traject, dt);
+        } else {
+            // Otherwise evaluate from the start of the phase
+            get_reference_in_phase(traject, phase, time_ref);
+        }
+        traject->cache_phase = phase;
+        traject->cache_time = time_ref;
+    }
+
+    *count_ref = traject->cache_count;
+    *count_ref_ext = traject->cache_count_ext;
+    *rate_ref = traject->cache_rate;
+    *acceleration_ref = traject->cache_acceleration;
 
     // Rebase the reference before it overflows after 35 minutes
     if (time_ref - traject->t0 > (DURATION_MAX_S + 120) * MS_PER_SECOND * US_PER_MS) {
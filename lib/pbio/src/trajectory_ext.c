@@ -20,6 +20,7 @@ static pbio_error_t pbio_trajectory_patch(pbio_trajectory_t *ref, bool time_base
     // First get the nominal commanded trajectory. This will be our default if we can't patch onto the existing one.
     pbio_error_t err;
     pbio_trajectory_t nominal;
+    pbio_trajectory_set_type(&nominal, ref->type, ref->jerk);
     if (time_based) {
         err = pbio_trajectory_make_time_based(&nominal, t0, duration, th0, th0_ext, w0, wt, wmax, a, amax);
     } else {
@@ -33,7 +34,9 @@ static pbio_error_t pbio_trajectory_patch(pbio_trajectory_t *ref, bool time_base
     // the trajectories are tangent at this point. Then we can patch the new trajectory
     // by letting its first segment be equal to the current segment of the ongoing trajectory.
     // This provides a seamless transition without having to resort to numerical tricks.
-    if (acceleration_ref == nominal.a0) {
+    // S-curves are not patched this way, since they are averaged over the
+    // earlier part of the trapezoid, which this does not keep.
+    if (ref->type == PBIO_TRAJECTORY_TYPE_TRAPEZOID && acceleration_ref == nominal.a0) {
         // Find which section of the ongoing maneuver we were in, and take corresponding segment starting point
         if (t0 - ref->t1 < 0) {
             // We are still in the acceleration segment, so we can restart from its starting point
@@ -55,11 +55,13 @@
 
 #define EV3_UART_MAX_DATA_ERR       6
 
+#define EV3_UART_MAX_COMBO_VALUES   8       // mode/dataset pairs in one combo
+
 #define EV3_UART_TYPE_MIN           29      // EV3 color sensor
 #define EV3_UART_TYPE_MAX           101
 #define EV3_UART_SPEED_MIN          2400
 #define EV3_UART_SPEED_LPF2         115200  // standard baud rate for Powered Up
-#define EV3_UART_SPEED_MAX          460800  // in practice 115200 is max
+#define EV3_UART_SPEED_MAX          460800  // in practice 115200 is max, but we try what the device advertises
 
 #define EV3_UART_DATA_KEEP_ALIVE_TIMEOUT    100 /* msec */
 #define EV3_UART_IO_TIMEOUT                 250 /* msec */
@@ -131,7 +133,6 @@ typedef enum {
  * struct ev3_uart_port_data - Data for EV3/LPF2 UART Sensor communication
  * @iodev: The I/O device state information struct
  * @pt: Protothread for main communication protocol
- * @data_pt: Protothread for receiving sensor data
  * @speed_pt: Protothread for setting the baud rate
  * @timer: Timer for sending keepalive messages and other delays.
  * @uart: Pointer to the UART device to use for communications
@@ -143,6 +144,15 @@ typedef enum {
  * @new_mode: The mode requested by set_mode. Also used to keep track of mode
  *  in INFO messages while syncing.
  * @new_baud_rate: New baud rate that will be set with ev3_uart_change_bitrate
+ * @fw_version: The firmware version received from the device, or 0 if the
+ *      device did not send it
+ * @probe_speed: Baud rate at which the device acknowledged the SPEED command
+ *      during the current sync, or 0 if it did not
+ * @sync_type_id: Type ID of the device that was last synced on this port.
+ *      This is kept when the device is disconnected.
+ * @sync_fw_version: Firmware version of the device that was last synced
+ * @sync_speed: Baud rate to send the SPEED command at in the next sync, or 0
+ *      to sync at the minimum baud rate right away
  * @info_flags: Flags indicating what information has already been read
  *      from the data.
  * @tacho_count: The tacho count received from an LPF2 motor
@@ -150,6 +160,10 @@ typedef enum {
  * @tx_msg: Buffer to hold messages transmitted to the device
  * @rx_msg: Buffer to hold messages received from the device
  * @rx_msg_size: Size of the current message being received
+ * @rx_frame: Buffer to hold a partial message while receiving data. Once it is
+ *      complete and the checksum is good, it is swapped with @rx_msg.
+ * @rx_frame_pos: Number of bytes in @rx_frame
+ * @rx_frame_size: Size of the message in @rx_frame, according to its header
  * @ext_mode: Extra mode adder for Powered Up devices (for modes > LUMP_MAX_MODE)
  * @write_cmd_size: The size parameter received from a WRITE command
  * @tacho_rate: The tacho rate received from an LPF2 motor
@@ -163,13 +177,16 @@ typedef enum {
  * @mode_change_tx_done: Flag to keep ev3_uart_set_mode_end() blocked until
  * mode has actually changed
  * @speed_payload: Buffer for holding baud rate change message data
- * @mode_combo_payload: Buffer for holding mode combo message data
+ * @mode_combo_payload: Buffer for holding mode combo message data. For sensors,
+ *      this also gives the layout of @combo_data.
  * @mode_combo_size: Actual size of mode combo message
+ * @combo_requested: Modes requested by set_mode_combo_begin that are not
+ *      combined yet
+ * @combo_data: Most recent combined data of all modes in iodev.combo_modes
  */
 typedef struct {
     pbio_iodev_t iodev;
     struct pt pt;
-    struct pt data_pt;
     struct pt speed_pt;
     struct etimer timer;
     pbdrv_uart_dev_t *uart;
@@ -179,12 +196,20 @@ typedef struct {
     uint8_t requested_mode;
     uint8_t new_mode;
     uint32_t new_baud_rate;
+    uint32_t fw_version;
+    uint32_t probe_speed;
+    pbio_iodev_type_id_t sync_type_id;
+    uint32_t sync_fw_version;
+    uint32_t sync_speed;
     uint32_t info_flags;
     int32_t tacho_count;
     int16_t abs_pos;
     uint8_t *tx_msg;
     uint8_t *rx_msg;
     uint8_t rx_msg_size;
+    uint8_t *rx_frame;
+    uint8_t rx_frame_pos;
+    uint8_t rx_frame_size;
     uint8_t ext_mode;
     uint8_t write_cmd_size;
     int8_t tacho_rate;
@@ -196,13 +221,16 @@ typedef struct {
     bool tx_busy;
     bool mode_change_tx_done;
     uint8_t speed_payload[4];
-    uint8_t mode_combo_payload[5];
+    uint8_t mode_combo_payload[2 + EV3_UART_MAX_COMBO_VALUES];
     uint8_t mode_combo_size;
+    uint16_t combo_requested;
+    uint8_t combo_data[PBIO_IODEV_MAX_DATA_SIZE];
 } uartdev_port_data_t;
 
 enum {
     BUF_TX_MSG,
     BUF_RX_MSG,
+    BUF_RX_FRAME,
     NUM_BUF
 };
 
@@ -280,6 +308,74 @@ static uint8_t ev3_uart_get_msg_size(uint8_t header) {
     return size;
 }
 
+// Checks the checksum of a complete message
+static bool ev3_uart_checksum_ok(uartdev_port_data_t *data, const uint8_t *msg, uint8_t msg_size) {
+    uint8_t checksum = 0xFF;
+    for (int i = 0; i < msg_size - 1; i++) {
+        checksum ^= msg[i];
+    }
+    if (checksum == msg[msg_size - 1]) {
+        return true;
+    }
+
+    // The LEGO EV3 color sensor sends bad checksums for RGB-RAW data
+    // (mode 4). The check here could be improved if someone can find a
+    // pattern. If INFO messages are done and we are now receiving data, it is
+    // OK to let this one through.
+    return data->status == PBIO_UARTDEV_STATUS_DATA
+           && data->type_id == PBIO_IODEV_TYPE_ID_EV3_COLOR_SENSOR
+           && msg[0] == (LUMP_MSG_TYPE_DATA | LUMP_MSG_SIZE_8 | 4);
+}
+
+// Checks that a header starts a message that is expected in DATA mode
+static bool ev3_uart_is_data_header(uint8_t header) {
+    uint8_t msg_size = ev3_uart_get_msg_size(header);
+    if (msg_size < 3 || msg_size > EV3_UART_MAX_MESSAGE_SIZE) {
+        return false;
+    }
+
+    uint8_t msg_type = header & LUMP_MSG_TYPE_MASK;
+    uint8_t cmd = header & LUMP_MSG_CMD_MASK;
+    return msg_type == LUMP_MSG_TYPE_DATA || (msg_type == LUMP_MSG_TYPE_CMD &&
+                                              (cmd == LUMP_CMD_WRITE || cmd == LUMP_CMD_EXT_MODE));
+}
+
+// Gets the values of one mode out of the most recent combined data
+static void pbio_uartdev_get_combo_values(uartdev_port_data_t *data, uint8_t mode, uint8_t *values) {
+    uint8_t offset = 0;
+
+    for (int i = 2; i < data->mode_combo_size; i++) {
+        uint8_t combo_mode = data->mode_combo_payload[i] >> 4;
+        uint8_t dataset = data->mode_combo_payload[i] & 0x0F;
+        uint8_t size = pbio_iodev_size_of(data->info->mode_info[combo_mode].data_type);
+        if (combo_mode == mode) {
+            memcpy(values + dataset * size, data->combo_data + offset, size);
+        }
+        offset += size;
+    }
+}
+
+// Records that bin_data now holds a new sample
+static void pbio_uartdev_new_sample(uartdev_port_data_t *data) {
+    data->iodev.sample_time = clock_usecs();
+    data->iodev.sample_count++;
+}
+
+// Adds the sample of the history mode to the history, if the most recent data
+// message has one. Combined data has it even if it is not the current mode.
+static void pbio_uartdev_push_history(uartdev_port_data_t *data) {
+    #if PBIO_CONFIG_IODEV_HISTORY_SIZE
+    pbio_iodev_t *iodev = &data->iodev;
+    if (!iodev->combo_modes) {
+        pbio_iodev_history_push(iodev, iodev->mode, iodev->bin_data);
+    } else if (iodev->combo_modes & (1 << iodev->history_mode)) {
+        uint8_t values[PBIO_IODEV_MAX_DATA_SIZE];
+        pbio_uartdev_get_combo_values(data, iodev->history_mode, values);
+        pbio_iodev_history_push(iodev, iodev->history_mode, values);
+    }
+    #endif
+}
+
 static void pbio_uartdev_set_mode_flags(pbio_iodev_type_id_t type_id, uint8_t mode, lump_mode_flags_t *flags) {
     memset(flags, 0, sizeof(*flags));
 
@@ -325,28 +421,14 @@ static void pbio_uartdev_parse_msg(uartdev_port_data_t *data) {
         mode += data->ext_mode;
     }
 
-    if (msg_size > 1) {
-        uint8_t checksum = 0xFF;
-        for (int i = 0; i < msg_size - 1; i++) {
-            checksum ^= data->rx_msg[i];
-        }
-        if (checksum != data->rx_msg[msg_size - 1]) {
-            DBG_ERR(data->last_err = "Bad checksum");
-            // if INFO messages are done and we are now receiving data, it is
-            // OK to occasionally have a bad checksum
-            if (data->status == PBIO_UARTDEV_STATUS_DATA) {
-
-                // The LEGO EV3 color sensor sends bad checksums
-                // for RGB-RAW data (mode 4). The check here could be
-                // improved if someone can find a pattern.
-                if (data->type_id != PBIO_IODEV_TYPE_ID_EV3_COLOR_SENSOR
-                    || data->rx_msg[0] != (LUMP_MSG_TYPE_DATA | LUMP_MSG_SIZE_8 | 4)) {
-                    return;
-                }
-            } else {
-                goto err;
-            }
+    if (msg_size > 1 && !ev3_uart_checksum_ok(data, data->rx_msg, msg_size)) {
+        DBG_ERR(data->last_err = "Bad checksum");
+        // if INFO messages are done and we are now receiving data, it is
+        // OK to occasionally have a bad checksum
+        if (data->status == PBIO_UARTDEV_STATUS_DATA) {
+            return;
         }
+        goto err;
     }
 
     switch (msg_type) {
@@ -419,6 +501,11 @@ static void pbio_uartdev_parse_msg(uartdev_port_data_t *data) {
                 case LUMP_CMD_WRITE:
                     if (cmd2 & 0x20) {
                         data->write_cmd_size = cmd2 & 0x3;
+                        // The device echoes the combo it is going to send
+                        if (data->combo_requested) {
+                            data->iodev.combo_modes = data->combo_requested;
+                            data->data_rec = false;
+                        }
                         if (PBIO_IODEV_IS_FEEDBACK_MOTOR(&data->iodev)) {
                             // TODO: msg[3] and msg[4] probably give us useful information
                         } else {
@@ -436,7 +523,7 @@ static void pbio_uartdev_parse_msg(uartdev_port_data_t *data) {
                         DBG_ERR(data->last_err = "Received duplicate version INFO");
                         goto err;
                     }
-                    // TODO: this might be useful someday
+                    data->fw_version = uint32_le(data->rx_msg + 1);
                     debug_pr("fw version: %08" PRIx32 "\n", uint32_le(data->rx_msg + 1));
                     debug_pr("hw version: %08" PRIx32 "\n", uint32_le(data->rx_msg + 5));
                     break;
@@ -667,6 +754,14 @@ static void pbio_uartdev_parse_msg(uartdev_port_data_t *data) {
                 if (data->iodev.motor_flags & PBIO_IODEV_MOTOR_FLAG_HAS_ABS_POS) {
                     data->abs_pos = data->rx_msg[7] << 8 | data->rx_msg[6];
                 }
+            } else if (data->iodev.combo_modes) {
+                // Data of all combined modes, in the order they were requested
+                memcpy(data->combo_data, data->rx_msg + 1, msg_size - 2);
+                if (data->iodev.combo_modes & (1 << data->iodev.mode)) {
+                    pbio_uartdev_get_combo_values(data, data->iodev.mode, data->iodev.bin_data);
+                    pbio_uartdev_new_sample(data);
+                }
+                pbio_uartdev_push_history(data);
             } else {
                 if (mode >= data->info->num_modes) {
                     DBG_ERR(data->last_err = "Invalid mode received");
@@ -675,6 +770,8 @@ static void pbio_uartdev_parse_msg(uartdev_port_data_t *data) {
                 data->iodev.mode = mode;
                 if (mode == data->new_mode) {
                     memcpy(data->iodev.bin_data, data->rx_msg + 1, msg_size - 2);
+                    pbio_uartdev_new_sample(data);
+                    pbio_uartdev_push_history(data);
                 }
             }
 
@@ -801,6 +898,28 @@ err:
     PT_EXIT(&data->speed_pt);
 }
 
+// Remembers how the device synced, so that it can sync faster when it is
+// connected to this port again, such as after a reset or a bad message.
+static void pbio_uartdev_save_sync_speed(uartdev_port_data_t *data) {
+    bool known = data->sync_type_id == data->type_id && data->sync_fw_version == data->fw_version;
+    bool skipped = data->sync_type_id != PBIO_IODEV_TYPE_ID_NONE && data->sync_speed == 0;
+
+    if (data->probe_speed == 0) {
+        // The device does not answer the SPEED command, so don't wait for it
+        // next time. If it was not sent at all because another device used to
+        // be here, give this device a chance to answer next time.
+        data->sync_speed = skipped && !known ? EV3_UART_SPEED_LPF2 : 0;
+    } else if (data->new_baud_rate > data->probe_speed && !(known && data->sync_speed > data->probe_speed)) {
+        // The device advertises a higher rate and has not failed at it yet
+        data->sync_speed = data->new_baud_rate;
+    } else {
+        data->sync_speed = data->probe_speed;
+    }
+
+    data->sync_type_id = data->type_id;
+    data->sync_fw_version = data->fw_version;
+}
+
 static PT_THREAD(pbio_uartdev_update(uartdev_port_data_t * data)) {
     pbio_error_t err;
     uint8_t checksum;
@@ -811,6 +930,8 @@ static PT_THREAD(pbio_uartdev_update(uartdev_port_data_t * data)) {
     data->info->type_id = PBIO_IODEV_TYPE_ID_NONE;
     data->iodev.motor_flags = PBIO_IODEV_MOTOR_FLAG_NONE;
     data->ext_mode = 0;
+    data->iodev.combo_modes = 0;
+    data->combo_requested = 0;
     data->status = PBIO_UARTDEV_STATUS_SYNCING;
     // default max tacho rate for BOOST external motor since it is the only
     // motor that does not send this info
@@ -818,24 +939,38 @@ static PT_THREAD(pbio_uartdev_update(uartdev_port_data_t * data)) {
 
     // FIXME: need to flush UART read buffer here
 
-    // Send SPEED command at 115200 baud
-    PBIO_PT_WAIT_READY(&data->pt, pbdrv_uart_set_baud_rate(data->uart, EV3_UART_SPEED_LPF2));
-    PT_SPAWN(&data->pt, &data->speed_pt, pbio_uartdev_send_speed_msg(data, EV3_UART_SPEED_LPF2));
+    // Send SPEED command at 115200 baud, or at whatever worked for the device
+    // that was last synced on this port. This is skipped if that device did
+    // not answer, so that we don't have to wait for the timeout again.
+    data->probe_speed = data->sync_type_id == PBIO_IODEV_TYPE_ID_NONE ? EV3_UART_SPEED_LPF2 : data->sync_speed;
+    while (data->probe_speed) {
+        PBIO_PT_WAIT_READY(&data->pt, pbdrv_uart_set_baud_rate(data->uart, data->probe_speed));
+        PT_SPAWN(&data->pt, &data->speed_pt, pbio_uartdev_send_speed_msg(data, data->probe_speed));
 
-    // read one byte to check for ACK
-    PBIO_PT_WAIT_READY(&data->pt, err = pbdrv_uart_read_begin(data->uart, data->rx_msg, 1, 100));
-    if (err != PBIO_SUCCESS) {
-        DBG_ERR(data->last_err = "UART Rx error during baud");
-        goto err;
+        // read one byte to check for ACK
+        PBIO_PT_WAIT_READY(&data->pt, err = pbdrv_uart_read_begin(data->uart, data->rx_msg, 1, 100));
+        if (err != PBIO_SUCCESS) {
+            DBG_ERR(data->last_err = "UART Rx error during baud");
+            goto err;
+        }
+
+        PBIO_PT_WAIT_READY(&data->pt, err = pbdrv_uart_read_end(data->uart));
+        if (err == PBIO_SUCCESS && data->rx_msg[0] == LUMP_SYS_ACK) {
+            break;
+        }
+        if (err != PBIO_SUCCESS && err != PBIO_ERROR_TIMEDOUT) {
+            DBG_ERR(data->last_err = "UART Rx error during baud");
+            goto err;
+        }
+
+        // if we did not get ACK within 100ms, fall back to the standard speed,
+        // then give up
+        data->probe_speed = data->probe_speed > EV3_UART_SPEED_LPF2 ? EV3_UART_SPEED_LPF2 : 0;
     }
 
-    PBIO_PT_WAIT_READY(&data->pt, err = pbdrv_uart_read_end(data->uart));
-    if ((err == PBIO_SUCCESS && data->rx_msg[0] != LUMP_SYS_ACK) || err == PBIO_ERROR_TIMEDOUT) {
-        // if we did not get ACK within 100ms, then switch to slow baud rate for sync
+    if (!data->probe_speed) {
+        // switch to slow baud rate for sync
         PBIO_PT_WAIT_READY(&data->pt, pbdrv_uart_set_baud_rate(data->uart, EV3_UART_SPEED_MIN));
-    } else if (err != PBIO_SUCCESS) {
-        DBG_ERR(data->last_err = "UART Rx error during baud");
-        goto err;
     }
 
     // To get in sync with the data stream from the sensor, we look for a valid TYPE command.
@@ -893,6 +1028,7 @@ static PT_THREAD(pbio_uartdev_update(uartdev_port_data_t * data)) {
     }
 
     data->type_id = data->rx_msg[1];
+    data->fw_version = 0;
     data->info_flags = EV3_UART_INFO_FLAG_CMD_TYPE;
     data->data_rec = false;
     data->num_data_err = 0;
@@ -966,12 +1102,13 @@ static PT_THREAD(pbio_uartdev_update(uartdev_port_data_t * data)) {
 
     // change the baud rate
     PBIO_PT_WAIT_READY(&data->pt, pbdrv_uart_set_baud_rate(data->uart, data->new_baud_rate));
+    pbio_uartdev_save_sync_speed(data);
 
     // setting type_id in info struct lets external modules know a device is connected
     data->info->type_id = data->type_id;
     data->status = PBIO_UARTDEV_STATUS_DATA;
-    // reset data rx thread
-    PT_INIT(&data->data_pt);
+    // drop any partial message from a previous connection
+    data->rx_frame_pos = 0;
 
     if (PBIO_IODEV_IS_FEEDBACK_MOTOR(&data->iodev)) {
         data->mode_combo_size = __builtin_popcount(data->info->mode_combos) + 2;
@@ -1048,75 +1185,183 @@ err:
     PT_END(&data->pt);
 }
 
-// REVISIT: This is not the greatest. We can easily get a buffer overrun and
-// loose data. For now, the retry after bad message size helps get back into
-// sync with the data stream.
-static PT_THREAD(pbio_uartdev_receive_data(uartdev_port_data_t * data)) {
-    pbio_error_t err;
+// Drops the first bytes of the partial message in *frame* and moves what is
+// left to rx_frame, starting at the first byte that looks like a header.
+static void pbio_uartdev_skip_frame(uartdev_port_data_t *data, const uint8_t *frame, uint8_t skip) {
+    while (skip < data->rx_frame_pos && !ev3_uart_is_data_header(frame[skip])) {
+        skip++;
+    }
+    data->rx_frame_pos -= skip;
+    memmove(data->rx_frame, frame + skip, data->rx_frame_pos);
+    if (data->rx_frame_pos) {
+        data->rx_frame_size = ev3_uart_get_msg_size(data->rx_frame[0]);
+    }
+}
 
-    PT_BEGIN(&data->data_pt);
+// Parses DATA messages from all bytes received so far. The bytes are read
+// straight from the receive buffer of the UART driver into rx_frame, so a
+// message is parsed as soon as its last byte is in, instead of waiting for a
+// separate read of the header and the rest of the message. Partial messages
+// are kept until the next call. Complete messages with a good checksum are
+// swapped into rx_msg. On a bad header or checksum, this resyncs on the next
+// byte that looks like a header.
+static void pbio_uartdev_receive_data(uartdev_port_data_t *data) {
+    uint8_t *frame;
+    uint8_t length;
 
-    while (true) {
-        PBIO_PT_WAIT_READY(&data->data_pt,
-            err = pbdrv_uart_read_begin(data->uart, data->rx_msg, 1, EV3_UART_IO_TIMEOUT));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(data->last_err = "UART Rx data header begin error");
-            break;
-        }
-        PBIO_PT_WAIT_READY(&data->data_pt, err = pbdrv_uart_read_end(data->uart));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(data->last_err = "UART Rx data header end error");
-            break;
-        }
+    while (data->status == PBIO_UARTDEV_STATUS_DATA) {
+        if (data->rx_frame_pos == 0 || data->rx_frame_pos < data->rx_frame_size) {
+            // read the header on its own so that it can be checked before
+            // reading the rest of the message
+            uint8_t size = data->rx_frame_pos ? data->rx_frame_size : 1;
+            frame = data->rx_frame + data->rx_frame_pos;
+            if (pbdrv_uart_read_available(data->uart, frame, size - data->rx_frame_pos, &length) != PBIO_SUCCESS
+                || length == 0) {
+                return;
+            }
 
-        data->rx_msg_size = ev3_uart_get_msg_size(data->rx_msg[0]);
-        if (data->rx_msg_size < 3 || data->rx_msg_size > EV3_UART_MAX_MESSAGE_SIZE) {
-            DBG_ERR(data->last_err = "Bad data message size");
+            if (data->rx_frame_pos == 0) {
+                if (!ev3_uart_is_data_header(frame[0])) {
+                    DBG_ERR(data->last_err = "Bad data message header");
+                    continue;
+                }
+                data->rx_frame_size = ev3_uart_get_msg_size(frame[0]);
+            }
+
+            data->rx_frame_pos += length;
             continue;
         }
 
-        uint8_t msg_type = data->rx_msg[0] & LUMP_MSG_TYPE_MASK;
-        uint8_t cmd = data->rx_msg[0] & LUMP_MSG_CMD_MASK;
-        if (msg_type != LUMP_MSG_TYPE_DATA && (msg_type != LUMP_MSG_TYPE_CMD ||
-                                               (cmd != LUMP_CMD_WRITE && cmd != LUMP_CMD_EXT_MODE))) {
-            DBG_ERR(data->last_err = "Bad msg type");
+        if (!ev3_uart_checksum_ok(data, data->rx_frame, data->rx_frame_size)) {
+            DBG_ERR(data->last_err = "Bad data message checksum");
+            pbio_uartdev_skip_frame(data, data->rx_frame, 1);
             continue;
         }
 
-        PBIO_PT_WAIT_READY(&data->data_pt,
-            err = pbdrv_uart_read_begin(data->uart, data->rx_msg + 1, data->rx_msg_size - 1, EV3_UART_IO_TIMEOUT));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(data->last_err = "UART Rx data begin error");
-            break;
-        }
-        PBIO_PT_WAIT_READY(&data->data_pt, err = pbdrv_uart_read_end(data->uart));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(data->last_err = "UART Rx data end error");
-            break;
-        }
+        // publish the complete message and keep any bytes after it
+        frame = data->rx_frame;
+        data->rx_frame = data->rx_msg;
+        data->rx_msg = frame;
+        pbio_uartdev_skip_frame(data, frame, data->rx_frame_size);
 
         // at this point, we have a full data->msg that can be parsed
         pbio_uartdev_parse_msg(data);
     }
-
-    PT_END(&data->data_pt);
 }
 
 static pbio_error_t ev3_uart_set_mode_begin(pbio_iodev_t *iodev, uint8_t mode) {
     uartdev_port_data_t *port_data = PBIO_CONTAINER_OF(iodev, uartdev_port_data_t, iodev);
     pbio_error_t err;
 
+    if (port_data->tx_busy || port_data->mode_change_tx_done) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // Data for combined modes is already here, so there is nothing to send.
+    // Setting mode_change_tx_done makes ev3_uart_set_mode_end() finish.
+    if (iodev->combo_modes & (1 << mode)) {
+        pbio_uartdev_get_combo_values(port_data, mode, iodev->bin_data);
+        iodev->mode = mode;
+        port_data->new_mode = mode;
+        port_data->mode_change_tx_done = true;
+        return PBIO_SUCCESS;
+    }
+
     err = ev3_uart_begin_tx_msg(port_data, LUMP_MSG_TYPE_CMD, LUMP_CMD_SELECT, &mode, 1);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
+    // Selecting a single mode ends the combination, so from now on only this
+    // mode can be kept in the history
+    iodev->combo_modes = 0;
+    port_data->combo_requested = 0;
+    pbio_iodev_set_history_mode(iodev, mode);
     port_data->new_mode = mode;
     port_data->mode_change_tx_done = false;
 
     return PBIO_SUCCESS;
 }
 
+// Adds every value of each of the given modes to the mode combo payload, as
+// long as they fit. Returns the modes that were added.
+static uint16_t ev3_uart_add_combo_modes(uartdev_port_data_t *port_data, uint16_t modes, uint8_t *num_values, uint8_t *data_size) {
+    uint16_t included = 0;
+
+    for (uint8_t mode = 0; mode < port_data->info->num_modes && mode < 16; mode++) {
+        if (!(modes & (1 << mode))) {
+            continue;
+        }
+        pbio_iodev_mode_t *mode_info = &port_data->info->mode_info[mode];
+        uint8_t size = mode_info->num_values * pbio_iodev_size_of(mode_info->data_type);
+        if (*num_values + mode_info->num_values > EV3_UART_MAX_COMBO_VALUES || *data_size + size > PBIO_IODEV_MAX_DATA_SIZE) {
+            continue;
+        }
+        for (uint8_t dataset = 0; dataset < mode_info->num_values; dataset++) {
+            port_data->mode_combo_payload[2 + (*num_values)++] = mode << 4 | dataset;
+        }
+        *data_size += size;
+        included |= 1 << mode;
+    }
+
+    return included;
+}
+
+static pbio_error_t ev3_uart_set_mode_combo_begin(pbio_iodev_t *iodev, uint16_t required, uint16_t optional) {
+    uartdev_port_data_t *port_data = PBIO_CONTAINER_OF(iodev, uartdev_port_data_t, iodev);
+    pbio_error_t err;
+
+    // Motors already use their mode combination for the tacho data
+    if (PBIO_IODEV_IS_FEEDBACK_MOTOR(iodev) || !(port_data->info_flags & EV3_UART_INFO_FLAG_INFO_MODE_COMBOS)) {
+        return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    // The payload below is also the layout of the data that is being
+    // received, so it may only change once we are sure to send it.
+    if (port_data->tx_busy || port_data->mode_change_tx_done) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // Request every value of the required modes first, so that optional
+    // modes can't take their place.
+    uint8_t num_values = 0;
+    uint8_t data_size = 0;
+    if ((required & port_data->info->mode_combos) != required ||
+        ev3_uart_add_combo_modes(port_data, required, &num_values, &data_size) != required) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    uint16_t included = required;
+    included |= ev3_uart_add_combo_modes(port_data, optional & ~required & port_data->info->mode_combos, &num_values, &data_size);
+    if (!included) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    iodev->combo_modes = 0;
+    port_data->mode_combo_size = num_values + 2;
+    port_data->mode_combo_payload[0] = 0x20 | num_values; // mode combo command, x values
+    port_data->mode_combo_payload[1] = 0; // combo index
+
+    err = ev3_uart_begin_tx_msg(port_data, LUMP_MSG_TYPE_CMD, LUMP_CMD_WRITE,
+        port_data->mode_combo_payload, port_data->mode_combo_size);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    port_data->combo_requested = included;
+    port_data->new_mode = iodev->mode;
+
+    // The history can only go on if its mode is part of the new combination.
+    // Otherwise it starts over with one of the modes that is.
+    #if PBIO_CONFIG_IODEV_HISTORY_SIZE
+    if (!(included & (1 << iodev->history_mode))) {
+        pbio_iodev_set_history_mode(iodev, __builtin_ctz(included));
+    }
+    #endif
+    port_data->mode_change_tx_done = false;
+
+    return PBIO_SUCCESS;
+}
+
 static pbio_error_t ev3_uart_set_mode_end(pbio_iodev_t *iodev) {
     uartdev_port_data_t *port_data = PBIO_CONTAINER_OF(iodev, uartdev_port_data_t, iodev);
     pbio_error_t err;
@@ -1136,7 +1381,14 @@ static pbio_error_t ev3_uart_set_mode_end(pbio_iodev_t *iodev) {
         return err;
     }
 
-    if (!port_data->data_rec || port_data->iodev.mode != port_data->new_mode) {
+    if (port_data->combo_requested) {
+        // Wait for the device to confirm the combination and send its data
+        if (!port_data->data_rec || port_data->iodev.combo_modes != port_data->combo_requested) {
+            return PBIO_ERROR_AGAIN;
+        }
+        port_data->combo_requested = 0;
+    } else if (port_data->iodev.mode != port_data->new_mode ||
+               (!port_data->data_rec && !(port_data->iodev.combo_modes & (1 << port_data->new_mode)))) {
         return PBIO_ERROR_AGAIN;
     }
 
@@ -1186,6 +1438,7 @@ static void ev3_uart_write_cancel(pbio_iodev_t *iodev) {
 
 static const pbio_iodev_ops_t pbio_uartdev_ops = {
     .set_mode_begin = ev3_uart_set_mode_begin,
+    .set_mode_combo_begin = ev3_uart_set_mode_combo_begin,
     .set_mode_end = ev3_uart_set_mode_end,
     .set_mode_cancel = ev3_uart_write_cancel,
     .set_data_begin = ev3_uart_set_data_begin,
@@ -1261,6 +1514,7 @@ static PT_THREAD(pbio_uartdev_init(struct pt *pt, uint8_t id)) {
     port_data->info = &infos[id].info;
     port_data->tx_msg = &bufs[id][BUF_TX_MSG][0];
     port_data->rx_msg = &bufs[id][BUF_RX_MSG][0];
+    port_data->rx_frame = &bufs[id][BUF_RX_FRAME][0];
 
     // It is not guaranteed that pbio_uartdev_counter_init() is called before pbio_uartdev_init()
     PT_WAIT_UNTIL(pt, counter_devs != NULL);
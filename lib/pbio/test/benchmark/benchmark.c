@@ -0,0 +1,413 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Host-side benchmark of the servo, drivebase, and servo group control loops.
+//
+// Each scenario starts a maneuver on the simulated motors from drv/sim and
+// then runs the motor poller once per PBIO_CONFIG_SERVO_PERIOD_MS of virtual
+// time. Only the call to the poller is measured, so the numbers reflect the
+// cost of one control tick. Where a scenario has a target angle, the final
+// error of the output shaft on port A is shown as well. Run with
+// ``-i <count>`` to fail if any scenario exceeds the given number of
+// instructions per tick on average.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include <contiki.h>
+
+#include <pbio/config.h>
+#include <pbio/drivebase.h>
+#include <pbio/main.h>
+#include <pbio/motorpoll.h>
+#include <pbio/servo.h>
+#include <pbio/servogroup.h>
+
+#include "drv/clock/clock_sim.h"
+#include "drv/sim/motor_sim.h"
+
+#define TICK_US (PBIO_CONFIG_SERVO_PERIOD_MS * US_PER_MS)
+
+typedef struct {
+    const char *name;
+    pbio_error_t (*start)(void);
+    uint32_t duration;
+    // Expected final angle of the output on port A, or NAN if not applicable
+    double target;
+} benchmark_scenario_t;
+
+typedef struct {
+    uint32_t ticks;
+    uint64_t ns_total;
+    uint64_t ns_max;
+    uint64_t instr_total;
+    uint64_t instr_max;
+    double angle;
+} benchmark_result_t;
+
+static int instr_fd = -1;
+static uint64_t instr_overhead;
+
+static uint64_t read_instructions(void) {
+    uint64_t count = 0;
+    if (instr_fd >= 0 && read(instr_fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+// Opens a hardware instruction counter for this thread, if available
+static void instructions_init(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    instr_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (instr_fd < 0) {
+        return;
+    }
+    ioctl(instr_fd, PERF_EVENT_IOC_ENABLE, 0);
+
+    // Calibrate the cost of reading the counter itself
+    instr_overhead = UINT64_MAX;
+    for (int i = 0; i < 100; i++) {
+        uint64_t start = read_instructions();
+        uint64_t overhead = read_instructions() - start;
+        if (overhead < instr_overhead) {
+            instr_overhead = overhead;
+        }
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Gets a servo and registers it with the poller, like the Motor class does
+static pbio_error_t get_servo(pbio_port_t port, pbio_servo_t **srv) {
+    pbio_error_t err = pbio_motorpoll_get_servo(port, srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_servo_setup(*srv, PBIO_DIRECTION_CLOCKWISE, F16C(1, 0));
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_motorpoll_set_servo_status(*srv, PBIO_ERROR_AGAIN);
+}
+
+static pbio_error_t start_servo_passive(void) {
+    pbio_servo_t *srv;
+    return get_servo(PBIO_PORT_A, &srv);
+}
+
+static pbio_error_t start_servo_angle(void) {
+    pbio_servo_t *srv;
+    pbio_error_t err = get_servo(PBIO_PORT_A, &srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_servo_run_angle(srv, 500, 720, PBIO_ACTUATION_HOLD);
+}
+
+static pbio_error_t start_servo_s_curve(void) {
+    pbio_servo_t *srv;
+    pbio_error_t err = get_servo(PBIO_PORT_A, &srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_control_settings_set_jerk(&srv->control.settings, 40000);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_servo_run_angle(srv, 500, 720, PBIO_ACTUATION_HOLD);
+}
+
+static pbio_error_t start_servo_timed(void) {
+    pbio_servo_t *srv;
+    pbio_error_t err = get_servo(PBIO_PORT_A, &srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_servo_run_time(srv, 500, 2000, PBIO_ACTUATION_COAST);
+}
+
+static pbio_error_t start_servo_hold(void) {
+    pbio_servo_t *srv;
+    pbio_error_t err = get_servo(PBIO_PORT_A, &srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_servo_track_target(srv, 45);
+}
+
+static pbio_error_t start_servo_stalled(void) {
+    pbio_servo_t *srv;
+    pbio_error_t err = get_servo(PBIO_PORT_A, &srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Block the output at 180 degrees
+    pbdrv_motor_sim_settings_t *settings;
+    err = pbdrv_motor_sim_get_settings(PBIO_PORT_A, &settings);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    settings->end_stops = true;
+    settings->min_angle = -INFINITY;
+    settings->max_angle = 180;
+
+    return pbio_servo_run_until_stalled(srv, 500, PBIO_ACTUATION_COAST);
+}
+
+static pbio_error_t start_drivebase_on(pbio_port_t port_left, pbio_port_t port_right, pbio_drivebase_t **db) {
+    pbio_servo_t *left, *right;
+    pbio_error_t err = get_servo(port_left, &left);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = get_servo(port_right, &right);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_motorpoll_get_drivebase(db);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_drivebase_setup(*db, left, right, F16C(56, 0), F16C(112, 0));
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_motorpoll_set_drivebase_status(*db, PBIO_ERROR_AGAIN);
+}
+
+static pbio_error_t start_drivebase(pbio_drivebase_t **db) {
+    return start_drivebase_on(PBIO_PORT_A, PBIO_PORT_B, db);
+}
+
+static pbio_error_t start_drivebase_straight(void) {
+    pbio_drivebase_t *db;
+    pbio_error_t err = start_drivebase(&db);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_drivebase_straight(db, 500, 300, 600);
+}
+
+static pbio_error_t start_drivebase_drive(void) {
+    pbio_drivebase_t *db;
+    pbio_error_t err = start_drivebase(&db);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_drivebase_drive(db, 200, 45);
+}
+
+static pbio_error_t start_drivebase_dual(void) {
+    pbio_drivebase_t *db1, *db2;
+    pbio_error_t err = start_drivebase_on(PBIO_PORT_A, PBIO_PORT_B, &db1);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = start_drivebase_on(PBIO_PORT_C, PBIO_PORT_D, &db2);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_drivebase_straight(db1, 500, 300, 600);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_drivebase_drive(db2, 200, 45);
+}
+
+static pbio_error_t start_drivebase_path(void) {
+    pbio_drivebase_t *db;
+    pbio_error_t err = start_drivebase(&db);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    // Around a corner and back along a diagonal
+    static const pbio_drivebase_waypoint_t waypoints[] = {
+        { 300, 0 },
+        { 300, 300 },
+        { 0, 0 },
+    };
+    return pbio_drivebase_follow_path(db, waypoints, 3, 200, 400, 80);
+}
+
+static pbio_error_t start_servogroup_target(void) {
+    pbio_servo_t *servos[2];
+    pbio_error_t err = get_servo(PBIO_PORT_A, &servos[0]);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = get_servo(PBIO_PORT_B, &servos[1]);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    pbio_servogroup_t *grp;
+    err = pbio_motorpoll_get_servogroup(&grp);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_servogroup_setup(grp, servos, 2, NULL);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_motorpoll_set_servogroup_status(grp, PBIO_ERROR_AGAIN);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    // The sum of both angles, so each motor turns half of it
+    return pbio_servogroup_run_target(grp, 0, 1000, 1440, PBIO_ACTUATION_HOLD);
+}
+
+static const benchmark_scenario_t scenarios[] = {
+    { "servo/passive", start_servo_passive, 1000, NAN },
+    { "servo/angle", start_servo_angle, 3000, 720 },
+    { "servo/s-curve", start_servo_s_curve, 3000, 720 },
+    { "servo/timed", start_servo_timed, 3000, NAN },
+    { "servo/hold", start_servo_hold, 2000, 45 },
+    { "servo/stalled", start_servo_stalled, 2000, 180 },
+    // 500 mm with 56 mm wheels
+    { "drivebase/straight", start_drivebase_straight, 4000, 500 * 360 / (56 * M_PI) },
+    { "drivebase/drive", start_drivebase_drive, 4000, NAN },
+    { "drivebase/path", start_drivebase_path, 8000, NAN },
+    { "drivebase/dual", start_drivebase_dual, 4000, 500 * 360 / (56 * M_PI) },
+    { "servogroup/target", start_servogroup_target, 3000, 720 },
+};
+
+// Puts all motors back in a known passive state, with polling disabled
+static void reset_all(void) {
+    _pbio_motorpoll_reset_all();
+
+    for (pbio_port_t port = PBDRV_CONFIG_FIRST_MOTOR_PORT; port <= PBDRV_CONFIG_LAST_MOTOR_PORT; port++) {
+        pbdrv_motor_sim_attach(port, PBIO_IODEV_TYPE_ID_SPIKE_M_MOTOR, 0);
+
+        pbio_servo_t *srv;
+        if (pbio_motorpoll_get_servo(port, &srv) == PBIO_SUCCESS) {
+            pbio_motorpoll_set_servo_status(srv, PBIO_SUCCESS);
+        }
+    }
+}
+
+static pbio_error_t run_scenario(const benchmark_scenario_t *scenario, benchmark_result_t *result) {
+    memset(result, 0, sizeof(*result));
+
+    reset_all();
+
+    pbio_error_t err = scenario->start();
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    for (uint32_t time = 0; time < scenario->duration * US_PER_MS; time += TICK_US) {
+        // Let the motors move for one period and then run one control tick.
+        // The simulation is brought up to date first so it is not measured.
+        pbdrv_clock_sim_advance(TICK_US);
+        pbdrv_motor_sim_update();
+
+        uint64_t instr_start = read_instructions();
+        uint64_t ns_start = now_ns();
+        _pbio_motorpoll_poll();
+        uint64_t ns = now_ns() - ns_start;
+        uint64_t instr = read_instructions() - instr_start - instr_overhead;
+
+        result->ticks++;
+        result->ns_total += ns;
+        result->ns_max = ns > result->ns_max ? ns : result->ns_max;
+        result->instr_total += instr;
+        result->instr_max = instr > result->instr_max ? instr : result->instr_max;
+
+        // Keep contiki timers and processes going like the real event loop
+        while (process_run()) {
+        }
+    }
+
+    return pbdrv_motor_sim_get_output_angle(PBIO_PORT_A, &result->angle);
+}
+
+int main(int argc, char **argv) {
+    uint64_t max_instructions = 0;
+    const char *filter = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:")) != -1) {
+        switch (opt) {
+            case 'i':
+                max_instructions = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-i max_instructions_per_tick] [scenario]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind < argc) {
+        filter = argv[optind];
+    }
+
+    pbio_init();
+    instructions_init();
+
+    printf("servo period: %d ms\n", PBIO_CONFIG_SERVO_PERIOD_MS);
+    printf("%-20s %8s %10s %10s %12s %12s %8s\n", "scenario", "ticks", "ns/tick", "worst ns", "instr/tick", "worst instr", "error");
+
+    int ret = 0;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        const benchmark_scenario_t *scenario = &scenarios[i];
+        benchmark_result_t result;
+
+        if (filter && !strstr(scenario->name, filter)) {
+            continue;
+        }
+
+        pbio_error_t err = run_scenario(scenario, &result);
+        if (err != PBIO_SUCCESS) {
+            printf("%-20s failed to start: %s\n", scenario->name, pbio_error_str(err));
+            ret = 1;
+            continue;
+        }
+
+        printf("%-20s %8" PRIu32 " %10" PRIu64 " %10" PRIu64, scenario->name,
+            result.ticks, result.ns_total / result.ticks, result.ns_max);
+
+        uint64_t instr_mean = result.instr_total / result.ticks;
+        if (instr_fd < 0) {
+            printf(" %12s %12s", "n/a", "n/a");
+        } else {
+            printf(" %12" PRIu64 " %12" PRIu64, instr_mean, result.instr_max);
+        }
+
+        if (isnan(scenario->target)) {
+            printf(" %8s\n", "-");
+        } else {
+            printf(" %8.1f\n", result.angle - scenario->target);
+        }
+
+        if (instr_fd >= 0 && max_instructions && instr_mean > max_instructions) {
+            printf("%-20s exceeds %" PRIu64 " instructions per tick\n", scenario->name, max_instructions);
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef _PBIO_CONF_H_
+#define _PBIO_CONF_H_
+
+#include <stdint.h>
+
+#define CCIF
+#define CLIF
+#define AUTOSTART_ENABLE 0
+
+typedef uint32_t clock_time_t;
+#define CLOCK_CONF_SECOND 1000
+
+#endif /* _PBIO_CONF_H_ */
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Configuration for the host-side servo benchmark. Four simulated motors on
+// ports A to D so that both single servos and a drivebase can be exercised.
+
+#define PBDRV_CONFIG_CLOCK_SIM                      (1)
+
+#define PBDRV_CONFIG_COUNTER                        (1)
+#define PBDRV_CONFIG_COUNTER_NUM_DEV                (4)
+#define PBDRV_CONFIG_COUNTER_SIM                    (1)
+#define PBDRV_CONFIG_COUNTER_SIM_NUM_DEV            (4)
+
+#define PBDRV_CONFIG_MOTOR                          (1)
+#define PBDRV_CONFIG_MOTOR_SIM                      (1)
+#define PBDRV_CONFIG_MOTOR_BATCH                    (1)
+
+#define PBDRV_CONFIG_HAS_PORT_A (1)
+#define PBDRV_CONFIG_HAS_PORT_B (1)
+#define PBDRV_CONFIG_HAS_PORT_C (1)
+#define PBDRV_CONFIG_HAS_PORT_D (1)
+
+#define PBDRV_CONFIG_FIRST_MOTOR_PORT       PBIO_PORT_A
+#define PBDRV_CONFIG_LAST_MOTOR_PORT        PBIO_PORT_D
+#define PBDRV_CONFIG_NUM_MOTOR_CONTROLLER   (4)
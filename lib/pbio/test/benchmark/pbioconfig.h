@@ -0,0 +1,5 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#define PBIO_CONFIG_DCMOTOR                 (1)
+#define PBIO_CONFIG_TACHO                   (1)
@@ -0,0 +1,4 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#define PBSYS_CONFIG_STATUS_LIGHT                   (0)
@@ -11,8 +11,13 @@
 
 #include <contiki.h>
 
+#include "test-pbio.h"
+
 #define TIMER_SIGNAL SIGRTMIN
 
+// Time added by tests that skip ahead, in microseconds
+static uint32_t clock_offset;
+
 static void handle_signal(int sig) {
     etimer_request_poll();
 }
@@ -52,13 +57,13 @@ void clock_init(void) {
 clock_time_t clock_time() {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000 + clock_offset / 1000;
 }
 
 unsigned long clock_usecs() {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L + clock_offset;
 }
 
 void clock_wait(clock_time_t t) {
@@ -81,3 +86,12 @@ void clock_delay_usec(uint16_t duration) {
     ts.tv_nsec = duration * 1000;
     clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
 }
+
+/**
+ * Moves the clock ahead without waiting, so that tests with simulated motors
+ * can run many control periods in no time.
+ * @param [in]  usecs   Time to skip, in microseconds
+ */
+void pbio_test_clock_advance(uint32_t usecs) {
+    clock_offset += usecs;
+}
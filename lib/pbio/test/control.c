@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pbio/control.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#define TEST_PERIOD (PBIO_CONFIG_SERVO_PERIOD_MS * US_PER_MS)
+
+static void test_control_setup(pbio_control_t *ctl) {
+    memset(ctl, 0, sizeof(*ctl));
+    ctl->settings = (pbio_control_settings_t) {
+        .counts_per_unit = F16C(1, 0),
+        .stall_rate_limit = 15,
+        .stall_time = 200 * US_PER_MS,
+        .max_rate = 1000,
+        .rate_tolerance = 50,
+        .count_tolerance = 5,
+        .abs_acceleration = 2000,
+        .pid_kp = 400,
+        .pid_ki = 600,
+        .pid_kd = 5,
+        .max_control = 10000,
+        .control_offset = 0,
+        .actuation_scale = 100,
+        .integral_range = 45,
+        .integral_rate = 5,
+    };
+    pbio_control_stop(ctl);
+}
+
+// Runs the controller with a motor that follows the reference perfectly, and
+// returns the lowest absolute reference speed seen between the given counts.
+static int32_t test_control_run(pbio_control_t *ctl, int32_t *time, int32_t *count, int32_t count_min, int32_t count_max) {
+    int32_t rate_min = INT32_MAX;
+    int32_t rate = 0;
+
+    for (int i = 0; i < 2000 && !pbio_control_is_done(ctl); i++) {
+        pbio_actuation_t actuation;
+        int32_t control;
+        control_update(ctl, *time, *count, rate, &actuation, &control);
+
+        *time += TEST_PERIOD;
+
+        // The motor is at the reference by the next sample, or coasts to a stop
+        if (ctl->type == PBIO_CONTROL_NONE) {
+            rate = 0;
+            continue;
+        }
+        int32_t count_ext, acceleration;
+        pbio_trajectory_get_reference(&ctl->trajectory, pbio_control_get_ref_time(ctl, *time - TEST_PERIOD), count, &count_ext, &rate, &acceleration);
+
+        if (*count >= count_min && *count <= count_max && abs(rate) < rate_min) {
+            rate_min = abs(rate);
+        }
+    }
+    return rate_min;
+}
+
+void test_control_queue(void *env) {
+    pbio_control_t ctl;
+    int32_t time = 0;
+    int32_t count = 0;
+
+    // Consecutive targets in the same direction are passed at full speed
+    test_control_setup(&ctl);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 360, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 720, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 1080, 0, 800, false, PBIO_ACTUATION_COAST), ==, PBIO_SUCCESS);
+    tt_want_int_op(ctl.after_stop, ==, PBIO_ACTUATION_HOLD);
+    tt_want_int_op(test_control_run(&ctl, &time, &count, 100, 900), >=, 500);
+    tt_want(pbio_control_is_done(&ctl));
+    tt_want_int_op(ctl.type, ==, PBIO_CONTROL_NONE);
+    tt_want_int_op(abs(count - 1080), <=, ctl.settings.count_tolerance);
+
+    // Requested stops and reversals stand still at the target in between
+    test_control_setup(&ctl);
+    count = 0;
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 360, 0, 500, true, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 720, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 100, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(test_control_run(&ctl, &time, &count, 340, 380), ==, 0);
+    tt_want(pbio_control_is_done(&ctl));
+    tt_want_int_op(ctl.type, ==, PBIO_CONTROL_ANGLE);
+    tt_want_int_op(abs(count - 100), <=, ctl.settings.count_tolerance);
+
+    // The queue has a fixed size
+    test_control_setup(&ctl);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 0, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    for (int i = 0; i < PBIO_CONFIG_CONTROL_QUEUE_SIZE; i++) {
+        tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, i * 10, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    }
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 1000, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_ERROR_AGAIN);
+
+    // Starting another maneuver discards the queue
+    tt_want_int_op(pbio_control_start_hold_control(&ctl, time, 0), ==, PBIO_SUCCESS);
+    tt_want_int_op(ctl.queue_size, ==, 0);
+
+    // Targets that can't be reached are rejected when they are queued
+    test_control_setup(&ctl);
+    count = 0;
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 360, 0, 500, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 720, 0, 0, false, PBIO_ACTUATION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 360 + 10 * DURATION_MAX_S, 0, 5, false, PBIO_ACTUATION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(ctl.queue_size, ==, 0);
+
+    // If the next maneuver still fails to start, the ongoing one completes
+    // as the last one and the queue reports why it ended early
+    tt_want_int_op(pbio_control_queue_angle_control(&ctl, time, count, 720, 0, 500, false, PBIO_ACTUATION_COAST), ==, PBIO_SUCCESS);
+    ctl.queue[ctl.queue_start].rate = 0;
+    test_control_run(&ctl, &time, &count, 0, 0);
+    tt_want(pbio_control_is_done(&ctl));
+    tt_want_int_op(ctl.queue_size, ==, 0);
+    tt_want_int_op(ctl.queue_err, ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(ctl.type, ==, PBIO_CONTROL_NONE);
+    tt_want_int_op(abs(count - 360), <=, ctl.settings.count_tolerance);
+}
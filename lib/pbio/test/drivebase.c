@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <pbio/drivebase.h>
+#include <pbio/main.h>
+#include <pbio/motorpoll.h>
+#include <pbio/odometry.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include "test-pbio.h"
+
+// Distance from the last waypoint within which a path counts as followed (mm)
+#define TEST_PATH_TOLERANCE (10)
+
+void test_drivebase_path(void *env) {
+    pbio_servo_t *left, *right;
+    pbio_drivebase_t *db;
+
+    pbio_init();
+    tt_want_int_op(pbio_test_motor_get_servo(PBIO_PORT_A, &left), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_test_motor_get_servo(PBIO_PORT_B, &right), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_motorpoll_get_drivebase(&db), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_drivebase_setup(db, left, right, F16C(56, 0), F16C(112, 0)), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_motorpoll_set_drivebase_status(db, PBIO_ERROR_AGAIN), ==, PBIO_SUCCESS);
+
+    // Turn left twice, then come to a stop
+    static const pbio_drivebase_waypoint_t waypoints[] = {
+        { 300, 0 },
+        { 300, 300 },
+        { 0, 300 },
+    };
+    tt_want_int_op(pbio_drivebase_follow_path(db, waypoints, 3, 200, 400, 80), ==, PBIO_SUCCESS);
+    tt_want_int_op(db->path.size, ==, 3);
+    uint32_t maneuver = db->maneuver;
+
+    pbio_test_motor_run(8000);
+
+    // The path ends with a straight maneuver that comes to a stop, which is
+    // still part of the same maneuver as far as the user is concerned.
+    tt_want_int_op(db->path.size, ==, 0);
+    tt_want_int_op(db->maneuver, ==, maneuver);
+    tt_want(pbio_control_is_done(&db->control_distance));
+    tt_want(pbio_control_is_done(&db->control_heading));
+
+    int32_t x, y, heading;
+    pbio_odometry_get_pose(&db->odometry, &x, &y, &heading);
+    tt_want_int_op(abs(x / 1000 - waypoints[2].x), <=, TEST_PATH_TOLERANCE);
+    tt_want_int_op(abs(y / 1000 - waypoints[2].y), <=, TEST_PATH_TOLERANCE);
+
+    // A new command replaces it
+    tt_want_int_op(pbio_drivebase_stop(db, PBIO_ACTUATION_COAST), ==, PBIO_SUCCESS);
+    tt_want_int_op(db->maneuver, !=, maneuver);
+
+    // Bad paths are rejected
+    tt_want_int_op(pbio_drivebase_follow_path(db, waypoints, 0, 200, 400, 80), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(pbio_drivebase_follow_path(db, waypoints, 3, 0, 400, 80), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(pbio_drivebase_follow_path(db, waypoints, 3, 200, 400, 0), ==, PBIO_ERROR_INVALID_ARG);
+}
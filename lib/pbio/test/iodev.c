@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/iodev.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+static struct {
+    pbio_iodev_info_t info;
+    pbio_iodev_mode_t modes[2];
+} test_info = {
+    .info = {
+        .type_id = PBIO_IODEV_TYPE_ID_LUMP_UART,
+        .num_modes = 2,
+    },
+    .modes = {
+        [0] = { .num_values = 1, .data_type = PBIO_IODEV_DATA_TYPE_INT16 },
+        [1] = { .num_values = 1, .data_type = PBIO_IODEV_DATA_TYPE_INT8 },
+    },
+};
+
+// Receives one sample of mode 0, like a device driver does
+static void test_iodev_receive(pbio_iodev_t *iodev, int16_t value) {
+    uint8_t data[PBIO_IODEV_MAX_DATA_SIZE];
+    memcpy(data, &value, sizeof(value));
+    pbio_iodev_history_push(iodev, 0, data);
+}
+
+// Treats negative samples as "out of range", at the end of the range
+static int32_t test_iodev_normalize(int32_t value) {
+    return value < 0 ? 1000 : value;
+}
+
+void test_iodev_history(void *env) {
+    static pbio_iodev_t iodev;
+    int32_t values[PBIO_CONFIG_IODEV_HISTORY_SIZE];
+    int32_t value;
+    uint8_t n;
+
+    iodev.info = &test_info.info;
+
+    // nothing received yet
+    n = 4;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_ERROR_AGAIN);
+    n = 0;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_ERROR_INVALID_ARG);
+    n = PBIO_CONFIG_IODEV_HISTORY_SIZE + 1;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_ERROR_INVALID_ARG);
+
+    // fewer samples than requested
+    test_iodev_receive(&iodev, 10);
+    test_iodev_receive(&iodev, -20);
+    n = 4;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_SUCCESS);
+    tt_want_int_op(n, ==, 2);
+    tt_want_int_op(values[0], ==, 10);
+    tt_want_int_op(values[1], ==, -20);
+
+    // ring wraps around and keeps the newest samples in order
+    for (int16_t i = 1; i <= PBIO_CONFIG_IODEV_HISTORY_SIZE + 3; i++) {
+        test_iodev_receive(&iodev, i * 100);
+    }
+    n = PBIO_CONFIG_IODEV_HISTORY_SIZE;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_SUCCESS);
+    tt_want_int_op(n, ==, PBIO_CONFIG_IODEV_HISTORY_SIZE);
+    tt_want_int_op(values[0], ==, 400);
+    tt_want_int_op(values[n - 1], ==, (PBIO_CONFIG_IODEV_HISTORY_SIZE + 3) * 100);
+
+    // filters over the last few samples
+    test_iodev_receive(&iodev, 100);
+    test_iodev_receive(&iodev, 5000); // outlier
+    test_iodev_receive(&iodev, 120);
+    test_iodev_receive(&iodev, 110);
+
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_AVERAGE, 4, 0, NULL, &value), ==, PBIO_SUCCESS);
+    tt_want_int_op(value, ==, (100 + 5000 + 120 + 110) / 4);
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_MEDIAN, 3, 0, NULL, &value), ==, PBIO_SUCCESS);
+    tt_want_int_op(value, ==, 120);
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_MEDIAN, 4, 0, NULL, &value), ==, PBIO_SUCCESS);
+    tt_want_int_op(value, ==, 115);
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_EXPONENTIAL, 2, 50, NULL, &value), ==, PBIO_SUCCESS);
+    tt_want_int_op(value, ==, 115);
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_EXPONENTIAL, 2, 0, NULL, &value), ==, PBIO_ERROR_INVALID_ARG);
+
+    // samples can be normalized before filtering, so that "out of range"
+    // readings don't pull the average down
+    test_iodev_receive(&iodev, -1);
+    test_iodev_receive(&iodev, 900);
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_AVERAGE, 2, 0, NULL, &value), ==, PBIO_SUCCESS);
+    tt_want_int_op(value, ==, (-1 + 900) / 2);
+    tt_want_int_op(pbio_iodev_get_filtered(&iodev, PBIO_IODEV_FILTER_AVERAGE, 2, 0, test_iodev_normalize, &value), ==, PBIO_SUCCESS);
+    tt_want_int_op(value, ==, (1000 + 900) / 2);
+    n = 1;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_SUCCESS);
+    tt_want_int_op(values[0], ==, 900);
+
+    // history starts over in another mode, with that mode's data type
+    pbio_iodev_set_history_mode(&iodev, 1);
+    n = 1;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_ERROR_AGAIN);
+    uint8_t data[PBIO_IODEV_MAX_DATA_SIZE] = { (uint8_t)-5 };
+    pbio_iodev_history_push(&iodev, 1, data);
+    n = 4;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_SUCCESS);
+    tt_want_int_op(n, ==, 1);
+    tt_want_int_op(values[0], ==, -5);
+}
+
+void test_iodev_history_combo(void *env) {
+    static pbio_iodev_t iodev;
+    int32_t values[PBIO_CONFIG_IODEV_HISTORY_SIZE];
+    uint8_t n;
+
+    iodev.info = &test_info.info;
+    pbio_iodev_set_history_mode(&iodev, 0);
+
+    // alternating between combined modes keeps the history of the tracked
+    // mode, which is received along with the other mode
+    for (int16_t i = 1; i <= 3; i++) {
+        iodev.mode = 1;
+        uint8_t data[PBIO_IODEV_MAX_DATA_SIZE] = { 7 };
+        pbio_iodev_history_push(&iodev, 1, data);
+        test_iodev_receive(&iodev, i * 10);
+        iodev.mode = 0;
+        test_iodev_receive(&iodev, i * 10 + 1);
+    }
+    n = PBIO_CONFIG_IODEV_HISTORY_SIZE;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_SUCCESS);
+    tt_want_int_op(n, ==, 6);
+    tt_want_int_op(values[0], ==, 10);
+    tt_want_int_op(values[1], ==, 11);
+    tt_want_int_op(values[4], ==, 30);
+    tt_want_int_op(values[5], ==, 31);
+
+    // tracking the same mode again does not start over
+    pbio_iodev_set_history_mode(&iodev, 0);
+    n = PBIO_CONFIG_IODEV_HISTORY_SIZE;
+    tt_want_int_op(pbio_iodev_get_history(&iodev, values, &n), ==, PBIO_SUCCESS);
+    tt_want_int_op(n, ==, 6);
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbdrv/pwm.h>
+#include <pbio/error.h>
+#include <pbio/lightgrid.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include "../drv/pwm/pwm.h"
+
+const pbdrv_lightgrid_platform_data_t pbdrv_lightgrid_platform_data = {
+    .id = 0,
+    .size = 5,
+    .channels = {
+        24, 23, 22, 21, 20,
+        19, 18, 17, 16, 15,
+        14, 13, 12, 11, 10,
+        9, 8, 7, 6, 5,
+        4, 3, 2, 1, 0,
+    },
+};
+
+static struct {
+    uint32_t count;
+    uint32_t channel;
+    uint32_t value;
+} test_duty;
+
+static pbio_error_t test_set_duty(pbdrv_pwm_dev_t *dev, uint32_t ch, uint32_t value) {
+    test_duty.count++;
+    test_duty.channel = ch;
+    test_duty.value = value;
+    return PBIO_SUCCESS;
+}
+
+static const pbdrv_pwm_driver_funcs_t test_funcs = {
+    .set_duty = test_set_duty,
+};
+
+void test_lightgrid_diff(void *env) {
+    pbdrv_pwm_dev_t *pwm;
+    pbio_lightgrid_t *grid;
+    uint8_t image[25];
+
+    // count the duty cycle updates sent to the PWM device
+    pbdrv_pwm_init();
+    tt_uint_op(pbdrv_pwm_get_dev(0, &pwm), ==, PBIO_SUCCESS);
+    pwm->funcs = &test_funcs;
+    tt_uint_op(pbio_lightgrid_get_dev(&grid), ==, PBIO_SUCCESS);
+
+    // the first image writes all pixels
+    memset(image, 0, sizeof(image));
+    tt_uint_op(pbio_lightgrid_set_image(grid, image), ==, PBIO_SUCCESS);
+    tt_uint_op(test_duty.count, ==, 25);
+
+    // the same image again writes nothing
+    test_duty.count = 0;
+    tt_uint_op(pbio_lightgrid_set_image(grid, image), ==, PBIO_SUCCESS);
+    tt_uint_op(test_duty.count, ==, 0);
+
+    // only the pixel that changed is written
+    image[1 * 5 + 3] = 50;
+    tt_uint_op(pbio_lightgrid_set_image(grid, image), ==, PBIO_SUCCESS);
+    tt_uint_op(test_duty.count, ==, 1);
+    tt_uint_op(test_duty.channel, ==, 16);
+    tt_uint_op(test_duty.value, ==, UINT16_MAX / 4);
+
+    // rows use the same pixel state
+    static const uint8_t rows[5] = { 0, 0b00010, 0, 0, 0b10000 };
+    test_duty.count = 0;
+    tt_uint_op(pbio_lightgrid_set_rows(grid, rows), ==, PBIO_SUCCESS);
+    tt_uint_op(test_duty.count, ==, 2);
+    tt_uint_op(test_duty.channel, ==, 4);
+    tt_uint_op(test_duty.value, ==, UINT16_MAX);
+
+    test_duty.count = 0;
+    tt_uint_op(pbio_lightgrid_set_pixel(grid, 4, 0, 100), ==, PBIO_SUCCESS);
+    tt_uint_op(test_duty.count, ==, 0);
+
+    // getting the device again writes all pixels the next time
+    tt_uint_op(pbio_lightgrid_get_dev(&grid), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_lightgrid_set_rows(grid, rows), ==, PBIO_SUCCESS);
+    tt_uint_op(test_duty.count, ==, 25);
+
+end:
+    ;
+}
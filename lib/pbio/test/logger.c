@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/logger.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#define TEST_LOG_ROWS (4)
+#define TEST_LOG_COLS (3)
+#define TEST_LOG_ROWS_PACKED (32)
+
+static void test_logger_write(pbio_log_t *log, int32_t value) {
+    int32_t buf[TEST_LOG_COLS - NUM_DEFAULT_LOG_VALUES] = { value, -value };
+    tt_want_int_op(pbio_logger_update(log, buf), ==, PBIO_SUCCESS);
+}
+
+void test_logger_ring(void *env) {
+    pbio_log_t log;
+    int32_t data[TEST_LOG_ROWS * TEST_LOG_COLS];
+    int32_t row[MAX_LOG_VALUES];
+
+    memset(&log, 0, sizeof(log));
+    log.num_values = TEST_LOG_COLS;
+
+    // A linear log stops when full
+    pbio_logger_start(&log, data, TEST_LOG_ROWS, 1);
+    for (int32_t i = 0; i < TEST_LOG_ROWS + 2; i++) {
+        test_logger_write(&log, i);
+    }
+    tt_want(!log.active);
+    tt_want_int_op(pbio_logger_rows(&log), ==, TEST_LOG_ROWS);
+    tt_want_int_op(pbio_logger_overruns(&log), ==, 0);
+
+    // A ring keeps going and counts samples it had to drop
+    pbio_logger_start_ring(&log, data, TEST_LOG_ROWS, 1);
+    tt_want_int_op(pbio_logger_pop(&log, row), ==, PBIO_ERROR_AGAIN);
+    for (int32_t i = 0; i < TEST_LOG_ROWS + 2; i++) {
+        test_logger_write(&log, i);
+    }
+    tt_want(log.active);
+    tt_want_int_op(pbio_logger_rows(&log), ==, TEST_LOG_ROWS);
+    tt_want_int_op(pbio_logger_overruns(&log), ==, 2);
+
+    // Rows come out oldest first, and make room for new ones across the end of the buffer
+    for (int32_t i = 0; i < 2; i++) {
+        tt_want_int_op(pbio_logger_pop(&log, row), ==, PBIO_SUCCESS);
+        tt_want_int_op(row[1], ==, i);
+    }
+    test_logger_write(&log, 10);
+    test_logger_write(&log, 11);
+    tt_want_int_op(pbio_logger_overruns(&log), ==, 2);
+    tt_want_int_op(pbio_logger_read(&log, -1, row), ==, PBIO_SUCCESS);
+    tt_want_int_op(row[1], ==, 11);
+    tt_want_int_op(pbio_logger_read(&log, 0, row), ==, PBIO_SUCCESS);
+    tt_want_int_op(row[1], ==, 2);
+
+    // Binary frames hold the header and the values in little endian order
+    uint8_t frame[PBIO_LOG_FRAME_SIZE_MAX];
+    size_t size;
+    tt_want_int_op(pbio_logger_pop_frame(&log, frame, &size), ==, PBIO_SUCCESS);
+    tt_want_int_op(size, ==, PBIO_LOG_FRAME_HEADER_SIZE + TEST_LOG_COLS * sizeof(int32_t));
+    tt_want_int_op(frame[0], ==, PBIO_LOG_FRAME_SYNC);
+    tt_want_int_op(frame[1], ==, TEST_LOG_COLS);
+    tt_want_int_op(frame[2] | frame[3] << 8, ==, 2);
+    tt_want_int_op(frame[8] | frame[9] << 8 | frame[10] << 16 | frame[11] << 24, ==, 2);
+    tt_want_int_op(frame[12] | frame[13] << 8 | frame[14] << 16 | (uint32_t)frame[15] << 24, ==, (uint32_t)-2);
+
+    // Drain the rest
+    int32_t rows = 0;
+    while (pbio_logger_pop_frame(&log, frame, &size) == PBIO_SUCCESS) {
+        rows++;
+    }
+    tt_want_int_op(rows, ==, 3);
+    tt_want_int_op(pbio_logger_rows(&log), ==, 0);
+
+    // The overrun count in the frame saturates instead of wrapping around
+    log.overruns = UINT16_MAX + 3;
+    test_logger_write(&log, 0);
+    tt_want_int_op(pbio_logger_pop_frame(&log, frame, &size), ==, PBIO_SUCCESS);
+    tt_want_int_op(frame[2] | frame[3] << 8, ==, UINT16_MAX);
+}
+
+void test_logger_packed(void *env) {
+    pbio_log_t log;
+    int32_t data[TEST_LOG_ROWS_PACKED * TEST_LOG_COLS];
+    int32_t row[MAX_LOG_VALUES];
+
+    memset(&log, 0, sizeof(log));
+    log.num_values = TEST_LOG_COLS;
+    log.delta_mask = 1 << 0 | 1 << 1;
+
+    // Slowly changing values take a byte or less, so more rows fit than unpacked
+    pbio_logger_start_packed(&log, data, TEST_LOG_ROWS_PACKED, 1);
+    int32_t rows = 0;
+    while (log.active) {
+        test_logger_write(&log, 1000 + rows);
+        rows++;
+    }
+    tt_want_int_op(pbio_logger_rows(&log), >=, TEST_LOG_ROWS_PACKED * 2);
+    tt_want_int_op(pbio_logger_pop(&log, row), ==, PBIO_ERROR_INVALID_OP);
+
+    // Rows read back the same, for both delta and absolute columns
+    for (int32_t i = 0; i < pbio_logger_rows(&log); i++) {
+        tt_want_int_op(pbio_logger_read(&log, i, row), ==, PBIO_SUCCESS);
+        tt_want_int_op(row[1], ==, 1000 + i);
+        tt_want_int_op(row[2], ==, -1000 - i);
+    }
+    tt_want_int_op(pbio_logger_read(&log, -1, row), ==, PBIO_SUCCESS);
+    tt_want_int_op(row[1], ==, 1000 + pbio_logger_rows(&log) - 1);
+
+    // Large jumps and wrap around are packed too
+    pbio_logger_start_packed(&log, data, TEST_LOG_ROWS_PACKED, 1);
+    test_logger_write(&log, INT32_MAX);
+    test_logger_write(&log, INT32_MIN);
+    test_logger_write(&log, 0);
+    tt_want_int_op(pbio_logger_read(&log, 0, row), ==, PBIO_SUCCESS);
+    tt_want_int_op(row[1], ==, INT32_MAX);
+    tt_want_int_op(row[2], ==, -INT32_MAX);
+    tt_want_int_op(pbio_logger_read(&log, 1, row), ==, PBIO_SUCCESS);
+    tt_want_int_op(row[1], ==, INT32_MIN);
+    tt_want_int_op(row[2], ==, INT32_MIN);
+    tt_want_int_op(pbio_logger_read(&log, 2, row), ==, PBIO_SUCCESS);
+    tt_want_int_op(row[1], ==, 0);
+
+    // The header describes the columns
+    uint8_t header[PBIO_LOG_PACKED_HEADER_SIZE];
+    const uint8_t *packed;
+    tt_want_int_op(pbio_logger_get_packed(&log, header, &packed), ==, log.size);
+    tt_want(memcmp(header, "PBLG", 4) == 0);
+    tt_want_int_op(header[4], ==, PBIO_LOG_PACKED_VERSION);
+    tt_want_int_op(header[5], ==, TEST_LOG_COLS);
+    tt_want_int_op(header[6], ==, log.delta_mask);
+}
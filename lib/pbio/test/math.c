@@ -64,3 +64,25 @@ void test_div_i32_fix16(void *env) {
     tt_want_int_op(pbio_math_div_i32_fix16(-INT32_MAX, F16(-1.0)), ==, INT32_MAX);
     tt_want_int_op(pbio_math_div_i32_fix16(INT32_MIN, F16(-1.0)), ==, INT32_MIN); // overflow!
 }
+
+void test_sin_cos(void *env) {
+    tt_want_int_op(pbio_math_sin(0), ==, 0);
+    tt_want_int_op(pbio_math_sin(90000), ==, PBIO_MATH_TRIG_ONE);
+    tt_want_int_op(pbio_math_sin(-90000), ==, -PBIO_MATH_TRIG_ONE);
+    tt_want_int_op(pbio_math_sin(180000), ==, 0);
+    tt_want_int_op(pbio_math_sin(30000), ==, PBIO_MATH_TRIG_ONE / 2);
+    tt_want_int_op(pbio_math_sin(390000), ==, PBIO_MATH_TRIG_ONE / 2);
+    tt_want_int_op(pbio_math_cos(0), ==, PBIO_MATH_TRIG_ONE);
+    tt_want_int_op(pbio_math_cos(60000), ==, PBIO_MATH_TRIG_ONE / 2);
+    tt_want_int_op(pbio_math_cos(-60000), ==, PBIO_MATH_TRIG_ONE / 2);
+    tt_want_int_op(pbio_math_cos(INT32_MAX), ==, pbio_math_cos(INT32_MAX % 360000));
+
+    // Interpolated values stay on the unit circle to within 1e-4
+    for (int32_t angle = -720000; angle <= 720000; angle += 777) {
+        int64_t s = pbio_math_sin(angle);
+        int64_t c = pbio_math_cos(angle);
+        int64_t norm = (s * s + c * c) >> 30;
+        tt_want_int_op(norm, >, PBIO_MATH_TRIG_ONE - PBIO_MATH_TRIG_ONE / 10000);
+        tt_want_int_op(norm, <=, PBIO_MATH_TRIG_ONE);
+    }
+}
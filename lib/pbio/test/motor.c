@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Simulated motors for tests of the controllers, using the drivers in drv/sim.
+
+#include <stdint.h>
+
+#include <contiki.h>
+
+#include <pbio/config.h>
+#include <pbio/iodev.h>
+#include <pbio/motorpoll.h>
+#include <pbio/servo.h>
+
+#include "drv/sim/motor_sim.h"
+
+#include "test-pbio.h"
+
+#define TEST_MOTOR_TICK (PBIO_CONFIG_SERVO_PERIOD_MIN_MS * US_PER_MS)
+
+/**
+ * Attaches a simulated SPIKE Medium Motor at angle 0 and gets a servo for it,
+ * registered with the poller like the Motor class does.
+ * @param [in]  port    Port of the motor
+ * @param [out] srv     The servo
+ */
+pbio_error_t pbio_test_motor_get_servo(pbio_port_t port, pbio_servo_t **srv) {
+    pbio_error_t err = pbdrv_motor_sim_attach(port, PBIO_IODEV_TYPE_ID_SPIKE_M_MOTOR, 0);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_motorpoll_get_servo(port, srv);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_servo_setup(*srv, PBIO_DIRECTION_CLOCKWISE, F16C(1, 0));
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_motorpoll_set_servo_status(*srv, PBIO_ERROR_AGAIN);
+}
+
+/**
+ * Lets the simulated motors move, with the poller running once per period.
+ * @param [in]  duration    Time to run (ms)
+ */
+void pbio_test_motor_run(uint32_t duration) {
+    for (uint32_t time = 0; time < duration * US_PER_MS; time += TEST_MOTOR_TICK) {
+        pbio_test_clock_advance(TEST_MOTOR_TICK);
+        pbdrv_motor_sim_update();
+        _pbio_motorpoll_poll();
+    }
+}
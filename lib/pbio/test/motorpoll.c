@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <pbio/main.h>
+#include <pbio/motorpoll.h>
+#include <pbio/servo.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include "test-pbio.h"
+
+// Runs the poller for a while and checks the time between control updates
+static void test_motorpoll_cadence(pbio_servo_t *srv, int32_t period) {
+    int32_t updates = 0;
+    int32_t time_prev = srv->control.time_prev;
+
+    for (int i = 0; i < 50; i++) {
+        pbio_test_motor_run(PBIO_CONFIG_SERVO_PERIOD_MIN_MS);
+        if (srv->control.time_prev == time_prev) {
+            continue;
+        }
+        // The first update may follow one that used the previous period
+        if (updates++ > 0) {
+            int32_t interval = srv->control.time_prev - time_prev;
+            tt_want_int_op(interval, >=, period * 1000 - PBIO_CONFIG_SERVO_PERIOD_MIN_MS * 500);
+            tt_want_int_op(interval, <, period * 1000 + PBIO_CONFIG_SERVO_PERIOD_MIN_MS * 1000);
+        }
+        time_prev = srv->control.time_prev;
+    }
+    tt_want_int_op(updates, >=, 50 * PBIO_CONFIG_SERVO_PERIOD_MIN_MS / (period + PBIO_CONFIG_SERVO_PERIOD_MIN_MS));
+}
+
+void test_motorpoll_period(void *env) {
+    pbio_servo_t *srv;
+    int32_t period;
+
+    pbio_init();
+    tt_want_int_op(pbio_test_motor_get_servo(PBIO_PORT_A, &srv), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_servo_run(srv, 500), ==, PBIO_SUCCESS);
+
+    // Servos start at the default period
+    tt_want_int_op(pbio_motorpoll_get_servo_period(srv, &period), ==, PBIO_SUCCESS);
+    tt_want_int_op(period, ==, PBIO_CONFIG_SERVO_PERIOD_MS);
+    test_motorpoll_cadence(srv, PBIO_CONFIG_SERVO_PERIOD_MS);
+
+    // Periods outside of what the poller can do are rejected
+    tt_want_int_op(pbio_motorpoll_set_servo_period(srv, PBIO_CONFIG_SERVO_PERIOD_MIN_MS - 1), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(pbio_motorpoll_set_servo_period(srv, PBIO_CONFIG_SERVO_PERIOD_IDLE_MS + 1), ==, PBIO_ERROR_INVALID_ARG);
+
+    // A longer period makes the servo update less often
+    tt_want_int_op(pbio_motorpoll_set_servo_period(srv, PBIO_CONFIG_SERVO_PERIOD_IDLE_MS), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_motorpoll_get_servo_period(srv, &period), ==, PBIO_SUCCESS);
+    tt_want_int_op(period, ==, PBIO_CONFIG_SERVO_PERIOD_IDLE_MS);
+    test_motorpoll_cadence(srv, PBIO_CONFIG_SERVO_PERIOD_IDLE_MS);
+
+    // And it is back to the default after a reset
+    pbio_init();
+    tt_want_int_op(pbio_motorpoll_get_servo_period(srv, &period), ==, PBIO_SUCCESS);
+    tt_want_int_op(period, ==, PBIO_CONFIG_SERVO_PERIOD_MS);
+}
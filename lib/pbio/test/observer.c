@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pbdrv/motor.h>
+#include <pbio/observer.h>
+#include <pbio/trajectory.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#define TEST_PERIOD (PBIO_CONFIG_SERVO_PERIOD_MS * US_PER_MS)
+
+#define TEST_RATE_MAX (1000)
+#define TEST_TIME_CONSTANT (40)
+
+// Runs a first order motor with the given duty cycle and extra load acceleration
+// for the given time, sampled with the given period. Gets the average absolute
+// rate error of the observer and of a finite difference of the quantized count,
+// over the last half.
+static void test_observer_run_period(pbio_observer_t *obs, int32_t *time, double *angle, double *speed,
+    int32_t duty, double load, int32_t duration, int32_t period, int32_t *err_observer, int32_t *err_difference) {
+
+    int32_t count_prev = (int32_t)*angle;
+    int32_t samples = 0;
+    *err_observer = 0;
+    *err_difference = 0;
+
+    for (int32_t t = 0; t < duration; t += period) {
+
+        // Integrate the motor in small steps between samples
+        for (int i = 0; i < 100; i++) {
+            double dt = period / 100 / 1e6;
+            double acceleration = ((double)duty * TEST_RATE_MAX / PBDRV_MAX_DUTY - *speed) * 1000 / TEST_TIME_CONSTANT + load;
+            *angle += *speed * dt;
+            *speed += acceleration * dt;
+        }
+        *time += period;
+
+        // Encoder sees whole counts only
+        int32_t count = (int32_t)*angle;
+        int32_t rate_difference = (count - count_prev) * US_PER_SECOND / period;
+        count_prev = count;
+
+        pbio_observer_update(obs, *time, count, rate_difference, duty);
+
+        if (t >= duration / 2) {
+            int32_t count_est, rate_est, acceleration_est;
+            pbio_observer_get_estimated_state(obs, &count_est, &rate_est, &acceleration_est);
+            *err_observer += abs(rate_est - (int32_t)*speed);
+            *err_difference += abs(rate_difference - (int32_t)*speed);
+            samples++;
+        }
+    }
+    *err_observer /= samples;
+    *err_difference /= samples;
+}
+
+static void test_observer_run(pbio_observer_t *obs, int32_t *time, double *angle, double *speed,
+    int32_t duty, double load, int32_t duration, int32_t *err_observer, int32_t *err_difference) {
+    test_observer_run_period(obs, time, angle, speed, duty, load, duration, TEST_PERIOD, err_observer, err_difference);
+}
+
+void test_observer(void *env) {
+    pbio_observer_t obs;
+    memset(&obs, 0, sizeof(obs));
+    pbio_observer_set_model(&obs, TEST_RATE_MAX, TEST_TIME_CONSTANT);
+
+    int32_t time = 0;
+    double angle = 0;
+    double speed = 0;
+    int32_t err_observer, err_difference;
+    int32_t count, rate, acceleration;
+
+    // Before the first update, the observer starts from the measured state
+    pbio_observer_update(&obs, time, 0, 0, 0);
+    pbio_observer_get_estimated_state(&obs, &count, &rate, &acceleration);
+    tt_want_int_op(rate, ==, 0);
+
+    // Steady state rate is tracked more smoothly than with a finite difference
+    test_observer_run(&obs, &time, &angle, &speed, 3500, 0, 1000 * US_PER_MS, &err_observer, &err_difference);
+    pbio_observer_get_estimated_state(&obs, &count, &rate, &acceleration);
+    tt_want_int_op(err_observer, <=, 5);
+    tt_want_int_op(err_observer, <, err_difference);
+    tt_want_int_op(abs(acceleration), <=, 200);
+
+    // A load the model does not know about is picked up as a disturbance
+    test_observer_run(&obs, &time, &angle, &speed, 3500, -2000, 1000 * US_PER_MS, &err_observer, &err_difference);
+    pbio_observer_get_estimated_state(&obs, &count, &rate, &acceleration);
+    tt_want_int_op(err_observer, <=, 5);
+    tt_want_int_op(err_observer, <, err_difference);
+    tt_want_int_op(abs(obs.disturbance / 1000 + 2000), <=, 200);
+
+    // Acceleration is estimated during a step in duty
+    test_observer_run(&obs, &time, &angle, &speed, 10000, -2000, 10 * TEST_PERIOD, &err_observer, &err_difference);
+    pbio_observer_get_estimated_state(&obs, &count, &rate, &acceleration);
+    int32_t acceleration_real = (int32_t)((TEST_RATE_MAX - speed) * 1000 / TEST_TIME_CONSTANT) - 2000;
+    tt_want_int_op(abs(acceleration - acceleration_real), <=, acceleration_real / 5);
+
+    // Without a model, the observer still tracks the rate
+    pbio_observer_set_model(&obs, 0, 0);
+    test_observer_run(&obs, &time, &angle, &speed, 10000, 0, 1000 * US_PER_MS, &err_observer, &err_difference);
+    pbio_observer_get_estimated_state(&obs, &count, &rate, &acceleration);
+    tt_want_int_op(err_observer, <=, 5);
+    tt_want_int_op(abs(count - (int32_t)angle), <=, 1);
+
+    // A stale estimate starts over from the measured state
+    time += 200 * US_PER_MS;
+    pbio_observer_update(&obs, time, 123, 45, 0);
+    pbio_observer_get_estimated_state(&obs, &count, &rate, &acceleration);
+    tt_want_int_op(count, ==, 123);
+    tt_want_int_op(rate, ==, 45);
+
+    // The gains are scaled to the update interval, so the estimate stays good
+    // for faster and slower updates
+    static const int32_t periods[] = { 2 * US_PER_MS, 20 * US_PER_MS };
+    for (size_t i = 0; i < sizeof(periods) / sizeof(periods[0]); i++) {
+        memset(&obs, 0, sizeof(obs));
+        pbio_observer_set_model(&obs, TEST_RATE_MAX, TEST_TIME_CONSTANT);
+        time = 0;
+        angle = 0;
+        speed = 0;
+        test_observer_run_period(&obs, &time, &angle, &speed, 3500, -2000, 2000 * US_PER_MS, periods[i], &err_observer, &err_difference);
+        tt_want_int_op(err_observer, <, err_difference);
+        tt_want_int_op(abs(obs.disturbance / 1000 + 2000), <=, 200);
+    }
+}
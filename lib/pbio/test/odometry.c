@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pbio/odometry.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+// 100 counts for every mm forward and 10 counts for every degree of rotation
+#define TEST_COUNTS_PER_MM F16C(100, 0)
+#define TEST_COUNTS_PER_DEGREE F16C(10, 0)
+
+// Drives along an arc in small steps, like the drivebase does on each update
+static void test_odometry_drive(pbio_odometry_t *odo, int32_t *sum, int32_t *dif, int32_t distance, int32_t angle, int32_t steps) {
+    int32_t sum_start = *sum;
+    int32_t dif_start = *dif;
+    for (int32_t i = 1; i <= steps; i++) {
+        *sum = sum_start + distance * 100 * i / steps;
+        *dif = dif_start + angle * 10 * i / steps;
+        pbio_odometry_update(odo, *sum, *dif);
+    }
+}
+
+void test_odometry(void *env) {
+    pbio_odometry_t odo;
+    memset(&odo, 0, sizeof(odo));
+    pbio_odometry_setup(&odo, TEST_COUNTS_PER_MM, TEST_COUNTS_PER_DEGREE);
+
+    int32_t sum = 12345;
+    int32_t dif = -678;
+    int32_t x, y, heading;
+
+    // The first update just sets the starting point
+    pbio_odometry_update(&odo, sum, dif);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(x, ==, 0);
+    tt_want_int_op(y, ==, 0);
+    tt_want_int_op(heading, ==, 0);
+
+    // Straight ahead
+    test_odometry_drive(&odo, &sum, &dif, 500, 0, 100);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(x, ==, 500000);
+    tt_want_int_op(y, ==, 0);
+
+    // Turn in place by 90 degrees clockwise, and drive to the right
+    test_odometry_drive(&odo, &sum, &dif, 0, 90, 50);
+    test_odometry_drive(&odo, &sum, &dif, 200, 0, 100);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(heading, ==, 90000);
+    tt_want_int_op(abs(x - 500000), <=, 10);
+    tt_want_int_op(abs(y - 200000), <=, 10);
+
+    // A full circle with a circumference of 1 m returns to the start
+    pbio_odometry_set_pose(&odo, 0, 0, 0);
+    test_odometry_drive(&odo, &sum, &dif, 1000, 360, 400);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(heading, ==, 360000);
+    tt_want_int_op(abs(x), <=, 100);
+    tt_want_int_op(abs(y), <=, 100);
+
+    // A quarter circle ends at one radius ahead and to the side
+    pbio_odometry_set_pose(&odo, 0, 0, 0);
+    test_odometry_drive(&odo, &sum, &dif, 250, 90, 100);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    int32_t radius = (int32_t)(1000000 / (2 * 3.14159265));
+    tt_want_int_op(abs(x - radius), <=, 100);
+    tt_want_int_op(abs(y - radius), <=, 100);
+
+    // A fused heading takes over, and later motion follows it
+    pbio_odometry_set_pose(&odo, 0, 0, 0);
+    pbio_odometry_fuse_heading(&odo, 10000, 50);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(heading, ==, 5000);
+    pbio_odometry_fuse_heading(&odo, -90000, 100);
+    test_odometry_drive(&odo, &sum, &dif, 100, 0, 10);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(heading, ==, -90000);
+    tt_want_int_op(abs(x), <=, 10);
+    tt_want_int_op(abs(y + 100000), <=, 10);
+
+    // Setting up again starts over
+    pbio_odometry_setup(&odo, TEST_COUNTS_PER_MM, TEST_COUNTS_PER_DEGREE);
+    pbio_odometry_update(&odo, sum, dif);
+    pbio_odometry_get_pose(&odo, &x, &y, &heading);
+    tt_want_int_op(heading, ==, 0);
+}
@@ -1,9 +1,21 @@
-
 #define PBDRV_CONFIG_COUNTER                        (1)
-#define PBDRV_CONFIG_COUNTER_NUM_DEV                (1)
+#define PBDRV_CONFIG_COUNTER_NUM_DEV                (3)
+#define PBDRV_CONFIG_COUNTER_SIM                    (1)
+#define PBDRV_CONFIG_COUNTER_SIM_NUM_DEV            (2)
+
+#define PBDRV_CONFIG_MOTOR                          (1)
+#define PBDRV_CONFIG_MOTOR_SIM                      (1)
 
 #define PBDRV_CONFIG_PWM                            (1)
 #define PBDRV_CONFIG_PWM_NUM_DEV                    (1)
 #define PBDRV_CONFIG_PWM_TEST                       (1)
 
 #define PBDRV_CONFIG_UART                           (1)
+
+// Two simulated motors, for tests of the controllers that use more than one
+#define PBDRV_CONFIG_HAS_PORT_A (1)
+#define PBDRV_CONFIG_HAS_PORT_B (1)
+
+#define PBDRV_CONFIG_FIRST_MOTOR_PORT       PBIO_PORT_A
+#define PBDRV_CONFIG_LAST_MOTOR_PORT        PBIO_PORT_B
+#define PBDRV_CONFIG_NUM_MOTOR_CONTROLLER   (2)
@@ -1,5 +1,8 @@
-
+#define PBIO_CONFIG_DCMOTOR                 (1)
+#define PBIO_CONFIG_IODEV_HISTORY_SIZE      (8)
 #define PBIO_CONFIG_LIGHT                   (1)
+#define PBIO_CONFIG_LIGHTGRID               (1)
+#define PBIO_CONFIG_TACHO                   (1)
 
 #define PBIO_CONFIG_UARTDEV                 (1)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (1)
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <pbio/main.h>
+#include <pbio/servo.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include "test-pbio.h"
+
+void test_servo_queue_maneuver(void *env) {
+    pbio_servo_t *srv;
+
+    pbio_init();
+    tt_want_int_op(pbio_test_motor_get_servo(PBIO_PORT_A, &srv), ==, PBIO_SUCCESS);
+
+    // Queueing after a maneuver that is not angle based starts a new one
+    tt_want_int_op(pbio_servo_run_time(srv, 500, 1000, PBIO_ACTUATION_COAST), ==, PBIO_SUCCESS);
+    uint32_t maneuver = srv->maneuver;
+    tt_want_int_op(pbio_servo_queue_target(srv, 500, 90, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(srv->maneuver, !=, maneuver);
+
+    // Targets queued while it runs are part of that same maneuver
+    maneuver = srv->maneuver;
+    tt_want_int_op(pbio_servo_queue_target(srv, 500, 180, true, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(srv->maneuver, ==, maneuver);
+    pbio_test_motor_run(2000);
+    tt_want(pbio_control_is_done(&srv->control));
+    tt_want_int_op(srv->maneuver, ==, maneuver);
+
+    // Once on target with nothing left in the queue, it starts a new one again
+    tt_want_int_op(pbio_servo_queue_target(srv, 500, 0, false, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_int_op(srv->maneuver, !=, maneuver);
+
+    // A target that can't be queued doesn't replace anything
+    maneuver = srv->maneuver;
+    pbio_test_motor_run(2000);
+    tt_want_int_op(pbio_servo_queue_target(srv, 0, 90, false, PBIO_ACTUATION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(srv->maneuver, ==, maneuver);
+}
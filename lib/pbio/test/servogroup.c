@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <pbio/logger.h>
+#include <pbio/main.h>
+#include <pbio/motorpoll.h>
+#include <pbio/servogroup.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include "test-pbio.h"
+
+#define TEST_LOG_ROWS (16)
+
+// Gets a group of the motors on ports A and B
+static pbio_servogroup_t *test_servogroup_get(pbio_servo_t **servos, const int8_t *mix) {
+    pbio_servogroup_t *grp;
+
+    pbio_init();
+    tt_want_int_op(pbio_test_motor_get_servo(PBIO_PORT_A, &servos[0]), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_test_motor_get_servo(PBIO_PORT_B, &servos[1]), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_motorpoll_get_servogroup(&grp), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_servogroup_setup(grp, servos, 2, mix), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_motorpoll_set_servogroup_status(grp, PBIO_ERROR_AGAIN), ==, PBIO_SUCCESS);
+    return grp;
+}
+
+void test_servogroup_mix(void *env) {
+    pbio_servo_t *servos[2];
+    int32_t angle, speed;
+
+    pbio_servogroup_t *grp = test_servogroup_get(servos, NULL);
+
+    // A mix must be invertible, or the axes can't be controlled independently
+    static const int8_t mix_dependent[] = { 1, 1, 2, 2 };
+    static const int8_t mix_zero[] = { 0, 0, 1, 1 };
+    tt_want_int_op(pbio_servogroup_setup(grp, servos, 2, mix_dependent), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(pbio_servogroup_setup(grp, servos, 2, mix_zero), ==, PBIO_ERROR_INVALID_ARG);
+
+    // So must the servos be distinct
+    pbio_servo_t *same[] = { servos[0], servos[0] };
+    tt_want_int_op(pbio_servogroup_setup(grp, same, 2, NULL), ==, PBIO_ERROR_INVALID_ARG);
+
+    // The default axes are the sum and the difference of the motor angles
+    tt_want_int_op(pbio_servogroup_setup(grp, servos, 2, NULL), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_servo_reset_angle(servos[0], 30, false), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_servo_reset_angle(servos[1], 10, false), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_servogroup_get_state(grp, 0, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_int_op(angle, ==, 40);
+    tt_want_int_op(pbio_servogroup_get_state(grp, 1, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_int_op(angle, ==, 20);
+    tt_want_int_op(pbio_servogroup_get_state(grp, 2, &angle, &speed), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Moving the difference axis turns the motors in opposite directions,
+    // while the sum axis holds still.
+    tt_want_int_op(pbio_servogroup_run_target(grp, 1, 500, 200, PBIO_ACTUATION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_motor_run(3000);
+    tt_want(pbio_servogroup_is_done(grp));
+    tt_want_int_op(pbio_servogroup_get_state(grp, 1, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_int_op(abs(angle - 200), <=, 5);
+    tt_want_int_op(pbio_servogroup_get_state(grp, 0, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_int_op(abs(angle - 40), <=, 5);
+}
+
+void test_servogroup_settings(void *env) {
+    pbio_servo_t *servos[2];
+
+    // One motor counts twice in the first axis
+    static const int8_t mix[] = { 2, 1, 1, -1 };
+    pbio_servogroup_t *grp = test_servogroup_get(servos, mix);
+
+    pbio_control_settings_t *s_srv = &servos[0]->control.settings;
+    pbio_control_settings_t *s_sum = &grp->control[0].settings;
+    pbio_control_settings_t *s_diff = &grp->control[1].settings;
+
+    // Rates add up with the weights
+    tt_want_int_op(s_sum->max_rate, ==, 3 * s_srv->max_rate);
+    tt_want_int_op(s_diff->max_rate, ==, 2 * s_srv->max_rate);
+
+    // The gains are the weighted average over the sum of squared weights,
+    // rounded to the nearest integer: 3 * kp / (3 * 5) and 2 * kp / (2 * 2).
+    tt_want_int_op(s_sum->pid_kp, ==, lround(s_srv->pid_kp / 5.0));
+    tt_want_int_op(s_sum->pid_kd, ==, lround(s_srv->pid_kd / 5.0));
+    tt_want_int_op(s_diff->pid_kp, ==, lround(s_srv->pid_kp / 2.0));
+    tt_want_int_op(s_diff->pid_kd, ==, lround(s_srv->pid_kd / 2.0));
+}
+
+void test_servogroup_log(void *env) {
+    pbio_servo_t *servos[2];
+    int32_t data[TEST_LOG_ROWS * MAX_LOG_VALUES];
+    int32_t row[MAX_LOG_VALUES];
+
+    pbio_servogroup_t *grp = test_servogroup_get(servos, NULL);
+
+    // Log a few periods, well after the clock started
+    pbio_test_motor_run(1000);
+    pbio_logger_start(&grp->log, data, TEST_LOG_ROWS, 1);
+    tt_want_int_op(pbio_servogroup_run(grp, 0, 500), ==, PBIO_SUCCESS);
+    pbio_test_motor_run(100);
+    tt_want_int_op(pbio_logger_rows(&grp->log), >, 1);
+
+    // The time of the control update counts from the start of the log,
+    // just like the time written by the logger itself.
+    for (int32_t i = 0; i < pbio_logger_rows(&grp->log); i++) {
+        tt_want_int_op(pbio_logger_read(&grp->log, i, row), ==, PBIO_SUCCESS);
+        tt_want_int_op(row[1], >=, 0);
+        tt_want_int_op(abs(row[1] - row[0]), <=, PBIO_CONFIG_SERVO_PERIOD_MS);
+    }
+}
@@ -72,6 +72,13 @@ static struct testcase_t pbdrv_pwm_tests[] = {
 
 // PBIO
 
+PBIO_TEST_FUNC(test_control_queue);
+
+static struct testcase_t pbio_control_tests[] = {
+    PBIO_TEST(test_control_queue),
+    END_OF_TESTCASES
+};
+
 PBIO_TEST_FUNC(test_rgb_to_hsv);
 PBIO_TEST_FUNC(test_hsv_to_rgb);
 PBIO_TEST_FUNC(test_color_to_hsv);
@@ -94,14 +101,96 @@ static struct testcase_t pbio_light_tests[] = {
     END_OF_TESTCASES
 };
 
+PBIO_TEST_FUNC(test_lightgrid_diff);
+
+static struct testcase_t pbio_lightgrid_tests[] = {
+    PBIO_TEST(test_lightgrid_diff),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_drivebase_path);
+
+static struct testcase_t pbio_drivebase_tests[] = {
+    PBIO_TEST(test_drivebase_path),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_iodev_history);
+PBIO_TEST_FUNC(test_iodev_history_combo);
+
+static struct testcase_t pbio_iodev_tests[] = {
+    PBIO_TEST(test_iodev_history),
+    PBIO_TEST(test_iodev_history_combo),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_logger_packed);
+PBIO_TEST_FUNC(test_logger_ring);
+
+static struct testcase_t pbio_logger_tests[] = {
+    PBIO_TEST(test_logger_packed),
+    PBIO_TEST(test_logger_ring),
+    END_OF_TESTCASES
+};
+
 PBIO_TEST_FUNC(test_sqrt);
 PBIO_TEST_FUNC(test_mul_i32_fix16);
 PBIO_TEST_FUNC(test_div_i32_fix16);
+PBIO_TEST_FUNC(test_sin_cos);
 
 static struct testcase_t pbio_math_tests[] = {
     PBIO_TEST(test_sqrt),
     PBIO_TEST(test_mul_i32_fix16),
     PBIO_TEST(test_div_i32_fix16),
+    PBIO_TEST(test_sin_cos),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_motorpoll_period);
+
+static struct testcase_t pbio_motorpoll_tests[] = {
+    PBIO_TEST(test_motorpoll_period),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_observer);
+
+static struct testcase_t pbio_observer_tests[] = {
+    PBIO_TEST(test_observer),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_odometry);
+
+static struct testcase_t pbio_odometry_tests[] = {
+    PBIO_TEST(test_odometry),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_servo_queue_maneuver);
+
+static struct testcase_t pbio_servo_tests[] = {
+    PBIO_TEST(test_servo_queue_maneuver),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_servogroup_mix);
+PBIO_TEST_FUNC(test_servogroup_settings);
+PBIO_TEST_FUNC(test_servogroup_log);
+
+static struct testcase_t pbio_servogroup_tests[] = {
+    PBIO_TEST(test_servogroup_mix),
+    PBIO_TEST(test_servogroup_settings),
+    PBIO_TEST(test_servogroup_log),
+    END_OF_TESTCASES
+};
+
+PBIO_TEST_FUNC(test_trajectory_reference);
+PBIO_TEST_FUNC(test_trajectory_s_curve);
+
+static struct testcase_t pbio_trajectory_tests[] = {
+    PBIO_TEST(test_trajectory_reference),
+    PBIO_TEST(test_trajectory_s_curve),
     END_OF_TESTCASES
 };
 
@@ -130,8 +219,19 @@ static struct testcase_t pbsys_status_tests[] = {
 static struct testgroup_t test_groups[] = {
     { "drv/pwm/", pbdrv_pwm_tests },
     { "src/color/", pbio_color_tests },
+    { "src/control/", pbio_control_tests },
+    { "src/drivebase/", pbio_drivebase_tests },
+    { "src/iodev/", pbio_iodev_tests },
     { "src/light/", pbio_light_tests },
+    { "src/lightgrid/", pbio_lightgrid_tests },
+    { "src/logger/", pbio_logger_tests },
     { "src/math/", pbio_math_tests },
+    { "src/motorpoll/", pbio_motorpoll_tests },
+    { "src/observer/", pbio_observer_tests },
+    { "src/odometry/", pbio_odometry_tests },
+    { "src/servo/", pbio_servo_tests },
+    { "src/servogroup/", pbio_servogroup_tests },
+    { "src/trajectory/", pbio_trajectory_tests },
     { "src/uartdev/", pbio_uartdev_tests, },
     { "sys/status/", pbsys_status_tests, },
     END_OF_GROUPS
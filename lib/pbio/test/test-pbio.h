@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+// Helpers shared by tests
+
+#ifndef _PBIO_TEST_PBIO_H_
+#define _PBIO_TEST_PBIO_H_
+
+#include <stdint.h>
+
+#include <pbio/error.h>
+#include <pbio/port.h>
+#include <pbio/servo.h>
+
+void pbio_test_clock_advance(uint32_t usecs);
+
+pbio_error_t pbio_test_motor_get_servo(pbio_port_t port, pbio_servo_t **srv);
+void pbio_test_motor_run(uint32_t duration);
+
+#endif // _PBIO_TEST_PBIO_H_
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <pbio/trajectory.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+// Makes a copy of the trajectory that has not been evaluated yet
+static void make_fresh(pbio_trajectory_t *fresh, const pbio_trajectory_t *traject) {
+    *fresh = *traject;
+    fresh->cache_phase = PBIO_TRAJECTORY_PHASE_NONE;
+}
+
+// Evaluates the trajectory at increasing times, like the control loop does,
+// and compares it to evaluating a fresh copy at the same time.
+static void check_trajectory(pbio_trajectory_t *traject) {
+    int32_t count, count_ext, rate, acceleration;
+    int32_t fresh_count, fresh_count_ext, fresh_rate, fresh_acceleration;
+    pbio_trajectory_t fresh;
+
+    // Irregular steps, including zero steps, steps back in time, and steps too large to take incrementally
+    static const int32_t steps[] = { 6000, 5999, 0, 6001, 1, 997, -3000, 12345, 150000, 6000, 7 };
+
+    int32_t time = traject->t0 - 10000;
+    for (int i = 0; time - traject->t3 < 1000000; i++) {
+        time += steps[i % (sizeof(steps) / sizeof(steps[0]))];
+
+        pbio_trajectory_get_reference(traject, time, &count, &count_ext, &rate, &acceleration);
+
+        make_fresh(&fresh, traject);
+        pbio_trajectory_get_reference(&fresh, time, &fresh_count, &fresh_count_ext, &fresh_rate, &fresh_acceleration);
+
+        tt_want_int_op(count, ==, fresh_count);
+        tt_want_int_op(count_ext, ==, fresh_count_ext);
+        tt_want_int_op(rate, ==, fresh_rate);
+        tt_want_int_op(acceleration, ==, fresh_acceleration);
+    }
+}
+
+void test_trajectory_reference(void *env) {
+    pbio_trajectory_t traject;
+    pbio_trajectory_set_type(&traject, PBIO_TRAJECTORY_TYPE_TRAPEZOID, 0);
+
+    // Forward and backward angle based maneuvers
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, 1000, 10, 730, 0, 500, 1000, 2000, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, -5000, 1234, -3456, 100, 777, 1000, 1500, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+
+    // Time based maneuvers with millicount starting points, in both directions
+    tt_want_int_op(pbio_trajectory_make_time_based(&traject, 0, 2000000, 5, 999, 0, 333, 1000, 2000, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+    tt_want_int_op(pbio_trajectory_make_time_based(&traject, 0, 2000000, -5, -999, 0, -333, 1000, 2000, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+
+    // Maneuver that crosses zero during the constant speed phase
+    tt_want_int_op(pbio_trajectory_make_time_based(&traject, 0, 3000000, 700, 1, 0, -701, 1000, 4000, 4000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+
+    // Forever maneuver, evaluated well into the constant speed phase
+    tt_want_int_op(pbio_trajectory_make_time_based(&traject, 0, DURATION_FOREVER, 0, 0, 0, -999, 1000, 2000, 2000), ==, PBIO_SUCCESS);
+    traject.t3 = traject.t0 + 10000000;
+    check_trajectory(&traject);
+
+    // Evaluating a new trajectory must not return results of the previous one
+    int32_t count, count_ext, rate, acceleration;
+    pbio_trajectory_make_stationary(&traject, 0, 0);
+    pbio_trajectory_get_reference(&traject, 1000, &count, &count_ext, &rate, &acceleration);
+    pbio_trajectory_make_stationary(&traject, 0, 42);
+    pbio_trajectory_get_reference(&traject, 1000, &count, &count_ext, &rate, &acceleration);
+    tt_want_int_op(count, ==, 42);
+
+    // S-curves, including ones without a constant speed phase
+    pbio_trajectory_set_type(&traject, PBIO_TRAJECTORY_TYPE_S_CURVE, 40000);
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, 1000, 10, 730, 0, 500, 1000, 2000, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, -5000, 1234, 1200, 100, 777, 1000, 1500, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+    tt_want_int_op(pbio_trajectory_make_time_based(&traject, 0, 2000000, -5, -999, 0, -333, 1000, 2000, 2000), ==, PBIO_SUCCESS);
+    check_trajectory(&traject);
+}
+
+// Evaluates the trajectory every millisecond and checks that the acceleration
+// changes gradually. Returns the final count.
+static int32_t check_s_curve(pbio_trajectory_t *traject, int32_t acceleration_max, int32_t jerk_max) {
+    int32_t count, count_ext, rate, acceleration;
+    int32_t count_prev, count_ext_prev, rate_prev, acceleration_prev;
+
+    int32_t time = traject->t0;
+    pbio_trajectory_get_reference(traject, time, &count_prev, &count_ext_prev, &rate_prev, &acceleration_prev);
+
+    for (time += US_PER_MS; time - traject->t3 - traject->tj < 10 * US_PER_MS; time += US_PER_MS) {
+        pbio_trajectory_get_reference(traject, time, &count, &count_ext, &rate, &acceleration);
+
+        // Acceleration is bounded and changes no faster than the jerk
+        tt_want_int_op(abs(acceleration), <=, acceleration_max);
+        tt_want_int_op(abs(acceleration - acceleration_prev), <=, jerk_max / MS_PER_SECOND + 2);
+
+        // The rate and position are consistent with it, up to the rounding of
+        // the trapezoid corner points to whole counts
+        tt_want_int_op(abs(rate - rate_prev - (acceleration + acceleration_prev) / 2 / MS_PER_SECOND), <=, 5);
+        int32_t mcount_delta = (count - count_prev) * 1000 + count_ext - count_ext_prev;
+        tt_want_int_op(abs(mcount_delta - (rate + rate_prev) / 2), <=, 5);
+
+        count_prev = count;
+        count_ext_prev = count_ext;
+        rate_prev = rate;
+        acceleration_prev = acceleration;
+    }
+
+    // It ends at standstill
+    tt_want_int_op(rate, ==, 0);
+    tt_want_int_op(acceleration, ==, 0);
+    return count;
+}
+
+void test_trajectory_s_curve(void *env) {
+    pbio_trajectory_t traject;
+    int32_t count, count_ext, rate, acceleration;
+
+    pbio_trajectory_set_type(&traject, PBIO_TRAJECTORY_TYPE_S_CURVE, 40000);
+
+    // Angle based maneuver, which ends exactly at the target
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, 0, 0, 720, 0, 800, 1000, 4000, 4000), ==, PBIO_SUCCESS);
+    tt_want_int_op(traject.tj, ==, 100 * US_PER_MS);
+    tt_want_int_op(check_s_curve(&traject, 4000, 40000), ==, 720);
+
+    // Backward, starting from a speed in the other direction
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, 0, 0, -360, 300, 800, 1000, 4000, 4000), ==, PBIO_SUCCESS);
+    pbio_trajectory_get_reference(&traject, 0, &count, &count_ext, &rate, &acceleration);
+    tt_want_int_op(abs(count), <=, 1);
+    tt_want_int_op(abs(rate - 300), <=, 5);
+    tt_want_int_op(check_s_curve(&traject, 4000, 40000), ==, -360);
+
+    // Short maneuver that does not reach full speed
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, 0, 0, 30, 0, 800, 1000, 4000, 4000), ==, PBIO_SUCCESS);
+    tt_want_int_op(check_s_curve(&traject, 4000, 40000), ==, 30);
+
+    // Time based maneuver, which still takes the given duration
+    tt_want_int_op(pbio_trajectory_make_time_based(&traject, 0, 2000000, 0, 0, 0, 500, 1000, 4000, 4000), ==, PBIO_SUCCESS);
+    tt_want_int_op(traject.t3 + traject.tj, ==, 2000000);
+    check_s_curve(&traject, 4000, 40000);
+
+    // A jerk limit of zero gives trapezoids
+    pbio_trajectory_set_type(&traject, PBIO_TRAJECTORY_TYPE_S_CURVE, 0);
+    tt_want_int_op(pbio_trajectory_make_angle_based(&traject, 0, 0, 720, 0, 800, 1000, 4000, 4000), ==, PBIO_SUCCESS);
+    tt_want_int_op(traject.tj, ==, 0);
+}
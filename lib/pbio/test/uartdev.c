@@ -31,6 +31,9 @@ static struct {
     uint8_t *rx_msg;
     uint8_t rx_msg_length;
     pbio_error_t rx_msg_result;
+    uint8_t rx_stream[32];
+    uint8_t rx_stream_length;
+    bool rx_streaming;
     uint8_t *tx_msg;
     struct etimer tx_timer;
     uint8_t tx_msg_length;
@@ -40,8 +43,20 @@ static struct {
 PT_THREAD(simulate_rx_msg(struct pt *pt, const uint8_t *msg, uint8_t length, bool *ok)) {
     PT_BEGIN(pt);
 
-    // First uartdev reads one byte header
-    PT_WAIT_UNTIL(pt, test_uart_dev.rx_msg_result == PBIO_ERROR_AGAIN);
+    PT_WAIT_UNTIL(pt, test_uart_dev.rx_msg_result == PBIO_ERROR_AGAIN || test_uart_dev.rx_streaming);
+
+    // When receiving data, uartdev takes whatever bytes are available
+    if (test_uart_dev.rx_streaming) {
+        tt_uint_op(test_uart_dev.rx_stream_length + length, <=, sizeof(test_uart_dev.rx_stream));
+        memcpy(&test_uart_dev.rx_stream[test_uart_dev.rx_stream_length], msg, length);
+        test_uart_dev.rx_stream_length += length;
+        process_poll(&pbio_uartdev_process);
+        PT_WAIT_UNTIL(pt, test_uart_dev.rx_stream_length == 0);
+        *ok = true;
+        PT_EXIT(pt);
+    }
+
+    // Otherwise, uartdev first reads one byte header
     tt_uint_op(test_uart_dev.rx_msg_length, ==, 1);
     memcpy(test_uart_dev.rx_msg, msg, 1);
     test_uart_dev.rx_msg_result = PBIO_SUCCESS;
@@ -197,11 +212,18 @@ PT_THREAD(test_boost_color_distance_sensor(struct pt *pt)) {
 
     static const uint8_t msg87[] = { 0x43, 0x01, 0xBD }; // set mode 1
     static const uint8_t msg88[] = { 0xC1, 0x00, 0x3E }; // mode 1 data
+    static const uint8_t msg88a[] = { 0xC0, 0x00, 0x3F }; // mode 0 data
 
     static const uint8_t msg89[] = { 0x43, 0x08, 0xB4 }; // set mode 8
     static const uint8_t msg90[] = { 0x46, 0x08, 0xB1 }; // extened mode info
     static const uint8_t msg91[] = { 0xD0, 0x00, 0x00, 0x00, 0x00, 0x2F }; // mode 8 data
 
+    static const uint8_t msg92[] = { 0x5C, 0x23, 0x00, 0x00, 0x10, 0x30, 0x00, 0x00, 0x00, 0xA0 }; // WRITE mode combo 0, 1, 3
+    static const uint8_t msg93[] = { 0xD0, 0x05, 0x07, 0x2A, 0x00, 0x07 }; // DATA combo
+    // noise, bad checksum, then mode 8 data that starts inside bad mode 8 data
+    static const uint8_t msg94[] = { 0x00, 0xD0, 0x01, 0x00, 0x00, 0x00, 0x00, 0xD0, 0xD0, 0x03, 0x00, 0x00, 0x00, 0x2C };
+    static const uint8_t msg95[] = { 0xC7, 0x00, 0x38 }; // data for mode 15, which does not exist
+
     // used in SIMULATE_RX/TX_MSG macros
     static struct pt child;
     static bool ok;
@@ -311,7 +333,7 @@ PT_THREAD(test_boost_color_distance_sensor(struct pt *pt)) {
     PT_YIELD(pt);
 
     pbdrv_counter_dev_t *counter;
-    tt_want_uint_op(pbdrv_counter_get_dev(0, &counter), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbdrv_counter_get_dev(2, &counter), ==, PBIO_SUCCESS);
     int32_t count;
     tt_want_uint_op(pbdrv_counter_get_count(counter, &count), ==, PBIO_ERROR_NO_DEV);
     tt_want_uint_op(pbdrv_counter_get_abs_count(counter, &count), ==, PBIO_ERROR_NO_DEV);
@@ -565,6 +587,13 @@ PT_THREAD(test_boost_color_distance_sensor(struct pt *pt)) {
     tt_uint_op(pbio_iodev_set_mode_end(iodev), ==, PBIO_ERROR_AGAIN);
     tt_uint_op(iodev->mode, !=, 1);
 
+    // data that still has the old mode is dropped, so it is not a new sample
+    static uint32_t old_sample_count, old_sample_time;
+    tt_uint_op(pbio_iodev_get_sample(iodev, &old_sample_count, &old_sample_time), ==, PBIO_SUCCESS);
+    SIMULATE_RX_MSG(msg88a);
+    tt_uint_op(pbio_iodev_wait_sample(iodev, old_sample_count), ==, PBIO_ERROR_AGAIN);
+    tt_uint_op(pbio_iodev_set_mode_end(iodev), ==, PBIO_ERROR_AGAIN);
+
     // data message with new mode
     SIMULATE_RX_MSG(msg88);
 
@@ -593,6 +622,102 @@ PT_THREAD(test_boost_color_distance_sensor(struct pt *pt)) {
     tt_uint_op(err, ==, PBIO_SUCCESS);
     tt_uint_op(iodev->mode, ==, 8);
 
+
+    // modes that can't be combined are refused if they are required
+
+    tt_uint_op(pbio_iodev_set_mode_combo_begin(iodev, 1 << 7 | 1 << 1, 0), ==, PBIO_ERROR_INVALID_ARG);
+
+    // combine modes, including an optional one that is not supported
+
+    PT_WAIT_WHILE(pt, (err = pbio_iodev_set_mode_combo_begin(iodev, 1 << 1 | 1 << 0, 1 << 7 | 1 << 3)) == PBIO_ERROR_AGAIN);
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+
+    SIMULATE_TX_MSG(msg92);
+
+    // should be blocked until the device confirms
+    tt_uint_op(pbio_iodev_set_mode_end(iodev), ==, PBIO_ERROR_AGAIN);
+    tt_uint_op(iodev->combo_modes, ==, 0);
+
+    // same message is received in response along with data message
+    SIMULATE_RX_MSG(msg92);
+    SIMULATE_RX_MSG(msg93);
+
+    PT_WAIT_WHILE(pt, (err = pbio_iodev_set_mode_end(iodev)) == PBIO_ERROR_AGAIN);
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+    tt_uint_op(iodev->combo_modes, ==, 1 << 3 | 1 << 1 | 1 << 0);
+
+    // changing between combined modes does not need any messages
+    tt_uint_op(pbio_iodev_set_mode_begin(iodev, 3), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_iodev_set_mode_end(iodev), ==, PBIO_SUCCESS);
+    tt_uint_op(iodev->mode, ==, 3);
+    tt_uint_op(iodev->bin_data[0], ==, 42);
+
+    tt_uint_op(pbio_iodev_set_mode_begin(iodev, 1), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_iodev_set_mode_end(iodev), ==, PBIO_SUCCESS);
+    tt_uint_op(iodev->mode, ==, 1);
+    tt_uint_op(iodev->bin_data[0], ==, 7);
+
+    // combined data keeps adding to the history of a mode while alternating
+    // between other modes
+    static int32_t combo_history[3];
+    static uint8_t combo_history_len;
+    tt_uint_op(iodev->history_mode, ==, 0);
+    SIMULATE_RX_MSG(msg93);
+    combo_history_len = 3;
+    tt_uint_op(pbio_iodev_get_history(iodev, combo_history, &combo_history_len), ==, PBIO_SUCCESS);
+    tt_uint_op(combo_history_len, ==, 2);
+    tt_int_op(combo_history[0], ==, 5);
+    tt_int_op(combo_history[1], ==, 5);
+
+    // selecting any other mode ends the combination
+    PT_WAIT_WHILE(pt, (err = pbio_iodev_set_mode_begin(iodev, 8)) == PBIO_ERROR_AGAIN);
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+    tt_uint_op(iodev->combo_modes, ==, 0);
+
+    SIMULATE_TX_MSG(msg89);
+    tt_uint_op(pbio_iodev_set_mode_end(iodev), ==, PBIO_ERROR_AGAIN);
+    SIMULATE_RX_MSG(msg90);
+    SIMULATE_RX_MSG(msg91);
+
+    PT_WAIT_WHILE(pt, (err = pbio_iodev_set_mode_end(iodev)) == PBIO_ERROR_AGAIN);
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+    tt_uint_op(iodev->mode, ==, 8);
+
+    // receiver should get back in sync after bad data, and only the good
+    // data message counts as a new sample
+
+    static uint32_t sample_count, sample_time;
+    tt_uint_op(pbio_iodev_get_sample(iodev, &sample_count, &sample_time), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_iodev_wait_sample(iodev, sample_count), ==, PBIO_ERROR_AGAIN);
+
+    SIMULATE_RX_MSG(msg94);
+    tt_uint_op(iodev->bin_data[0], ==, 3);
+    tt_uint_op(pbio_iodev_wait_sample(iodev, sample_count), ==, PBIO_SUCCESS);
+    tt_uint_op(iodev->sample_count, ==, sample_count + 1);
+
+    // the new sample is also in the history
+    static int32_t history[2];
+    static uint8_t history_len;
+    history_len = 2;
+    tt_uint_op(pbio_iodev_get_history(iodev, history, &history_len), ==, PBIO_SUCCESS);
+    tt_uint_op(history_len, ==, 2);
+    tt_int_op(history[1], ==, 3);
+
+    // a bad message makes the device sync again
+
+    test_uart_dev.baud = 0;
+    SIMULATE_RX_MSG(msg95);
+    SIMULATE_TX_MSG(msg84);
+
+    // this device did not answer the SPEED command last time, so it is not
+    // sent again and syncing starts at 2400 baud right away
+    PT_WAIT_UNTIL(pt, test_uart_dev.baud != 0);
+    tt_uint_op(test_uart_dev.baud, ==, 2400);
+    tt_uint_op(test_uart_dev.tx_msg_result, !=, PBIO_ERROR_AGAIN);
+    SIMULATE_RX_MSG(msg0);
+    SIMULATE_RX_MSG(msg1);
+    tt_uint_op(iodev->info->type_id, ==, PBIO_IODEV_TYPE_ID_NONE);
+
     PT_YIELD(pt);
 
 end:
@@ -713,7 +838,7 @@ PT_THREAD(test_boost_interactive_motor(struct pt *pt)) {
     PT_YIELD(pt);
 
     pbdrv_counter_dev_t *counter;
-    tt_want_uint_op(pbdrv_counter_get_dev(0, &counter), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbdrv_counter_get_dev(2, &counter), ==, PBIO_SUCCESS);
     int32_t count;
     tt_want_uint_op(pbdrv_counter_get_count(counter, &count), ==, PBIO_SUCCESS);
     tt_want_int_op(count, ==, -1);
@@ -980,7 +1105,7 @@ PT_THREAD(test_technic_large_motor(struct pt *pt)) {
     PT_YIELD(pt);
 
     pbdrv_counter_dev_t *counter;
-    tt_want_uint_op(pbdrv_counter_get_dev(0, &counter), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbdrv_counter_get_dev(2, &counter), ==, PBIO_SUCCESS);
     int32_t count;
     tt_want_uint_op(pbdrv_counter_get_count(counter, &count), ==, PBIO_SUCCESS);
     tt_want_int_op(count, ==, -1);
@@ -1300,7 +1425,7 @@ PT_THREAD(test_technic_xl_motor(struct pt *pt)) {
     PT_YIELD(pt);
 
     pbdrv_counter_dev_t *counter;
-    tt_want_uint_op(pbdrv_counter_get_dev(0, &counter), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbdrv_counter_get_dev(2, &counter), ==, PBIO_SUCCESS);
     int32_t count;
     tt_want_uint_op(pbdrv_counter_get_count(counter, &count), ==, PBIO_SUCCESS);
     tt_want_int_op(count, ==, -1);
@@ -1473,7 +1598,7 @@ end:
 const pbio_uartdev_platform_data_t pbio_uartdev_platform_data[] = {
     [0] = {
         .uart_id = 0,
-        .counter_id = 0,
+        .counter_id = 2,
     },
 };
 
@@ -1494,6 +1619,7 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t
 
     test_uart_dev.rx_msg = msg;
     test_uart_dev.rx_msg_length = length;
+    test_uart_dev.rx_streaming = false;
     test_uart_dev.rx_msg_result = PBIO_ERROR_AGAIN;
     etimer_set(&test_uart_dev.rx_timer, clock_from_msec(timeout));
 
@@ -1518,6 +1644,19 @@ void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart) {
 
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart, uint8_t *buf, uint8_t size, uint8_t *length) {
+    assert(!test_uart_dev.rx_msg);
+
+    test_uart_dev.rx_streaming = true;
+
+    *length = size < test_uart_dev.rx_stream_length ? size : test_uart_dev.rx_stream_length;
+    memcpy(buf, test_uart_dev.rx_stream, *length);
+    test_uart_dev.rx_stream_length -= *length;
+    memmove(test_uart_dev.rx_stream, &test_uart_dev.rx_stream[*length], test_uart_dev.rx_stream_length);
+
+    return PBIO_SUCCESS;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout) {
     if (test_uart_dev.tx_msg) {
         return PBIO_ERROR_AGAIN;
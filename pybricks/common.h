@@ -38,8 +38,21 @@ const mp_obj_module_t pb_module_battery;
 #if PYBRICKS_PY_COMMON_MOTORS
 
 #include <pbio/control.h>
+#include <pbio/motorpoll.h>
 #include <pbio/servo.h>
 
+#include <pybricks/util_pb/pb_error.h>
+
+// Motors may be polled by a separate control thread. Like pb_assert, but
+// holds the motor poll lock during the call and releases it before raising.
+#define PB_ASSERT_LOCKED(call) \
+    do { \
+        pbio_motorpoll_lock(); \
+        pbio_error_t _err = (call); \
+        pbio_motorpoll_unlock(); \
+        pb_assert(_err); \
+    } while (0)
+
 // pybricks._common.Control()
 const mp_obj_type_t pb_type_Control;
 mp_obj_t common_Control_obj_make_new(pbio_control_t *control);
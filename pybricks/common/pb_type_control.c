@@ -75,12 +75,34 @@ STATIC mp_obj_t common_Control_limits(size_t n_args, const mp_obj_t *pos_args, m
     acceleration = pb_obj_get_default_int(acceleration_in, acceleration);
     actuation = pb_obj_get_default_int(actuation_in, actuation);
 
-    pb_assert(pbio_control_settings_set_limits(&self->control->settings, speed, acceleration, actuation));
+    PB_ASSERT_LOCKED(pbio_control_settings_set_limits(&self->control->settings, speed, acceleration, actuation));
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Control_limits_obj, 1, common_Control_limits);
 
+// pybricks._common.Control.jerk
+STATIC mp_obj_t common_Control_jerk(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        common_Control_obj_t, self,
+        PB_ARG_DEFAULT_NONE(jerk));
+
+    // If no value is given, return current value
+    if (jerk_in == mp_const_none) {
+        return mp_obj_new_int(pbio_control_settings_get_jerk(&self->control->settings));
+    }
+
+    // Assert control is not active
+    raise_if_control_busy(self->control);
+
+    // Set user setting. Zero selects trapezoidal maneuvers.
+    PB_ASSERT_LOCKED(pbio_control_settings_set_jerk(&self->control->settings, mp_obj_get_int(jerk_in)));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Control_jerk_obj, 1, common_Control_jerk);
+
 // pybricks._common.Control.pid
 STATIC mp_obj_t common_Control_pid(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
@@ -122,7 +144,7 @@ STATIC mp_obj_t common_Control_pid(size_t n_args, const mp_obj_t *pos_args, mp_m
     integral_rate = pb_obj_get_default_int(integral_rate_in, integral_rate);
     feed_forward = pb_obj_get_default_int(feed_forward_in, feed_forward);
 
-    pb_assert(pbio_control_settings_set_pid(&self->control->settings, kp, ki, kd, integral_range, integral_rate, feed_forward));
+    PB_ASSERT_LOCKED(pbio_control_settings_set_pid(&self->control->settings, kp, ki, kd, integral_range, integral_rate, feed_forward));
 
     return mp_const_none;
 }
@@ -155,7 +177,7 @@ STATIC mp_obj_t common_Control_target_tolerances(size_t n_args, const mp_obj_t *
     speed = pb_obj_get_default_int(speed_in, speed);
     position = pb_obj_get_default_int(position_in, position);
 
-    pb_assert(pbio_control_settings_set_target_tolerances(&self->control->settings, speed, position));
+    PB_ASSERT_LOCKED(pbio_control_settings_set_target_tolerances(&self->control->settings, speed, position));
 
     return mp_const_none;
 }
@@ -188,7 +210,7 @@ STATIC mp_obj_t common_Control_stall_tolerances(size_t n_args, const mp_obj_t *p
     speed = pb_obj_get_default_int(speed_in, speed);
     time = pb_obj_get_default_int(time_in, time);
 
-    pb_assert(pbio_control_settings_set_stall_tolerances(&self->control->settings, speed, time));
+    PB_ASSERT_LOCKED(pbio_control_settings_set_stall_tolerances(&self->control->settings, speed, time));
 
     return mp_const_none;
 }
@@ -201,9 +223,12 @@ STATIC mp_obj_t common_Control_trajectory(mp_obj_t self_in) {
 
     mp_obj_t parms[12];
 
+    pbio_motorpoll_lock();
     trajectory = self->control->trajectory;
+    bool active = self->control->type != PBIO_CONTROL_NONE;
+    pbio_motorpoll_unlock();
 
-    if (self->control->type != PBIO_CONTROL_NONE) {
+    if (active) {
         parms[0] = mp_obj_new_int((trajectory.t0 - trajectory.t0) / 1000);
         parms[1] = mp_obj_new_int((trajectory.t1 - trajectory.t0) / 1000);
         parms[2] = mp_obj_new_int((trajectory.t2 - trajectory.t0) / 1000);
@@ -225,20 +250,27 @@ MP_DEFINE_CONST_FUN_OBJ_1(common_Control_trajectory_obj, common_Control_trajecto
 // pybricks._common.Control.done
 STATIC mp_obj_t common_Control_done(mp_obj_t self_in) {
     common_Control_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    return mp_obj_new_bool(pbio_control_is_done(self->control));
+    pbio_motorpoll_lock();
+    bool done = pbio_control_is_done(self->control);
+    pbio_motorpoll_unlock();
+    return mp_obj_new_bool(done);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(common_Control_done_obj, common_Control_done);
 
 // pybricks._common.Control.stalled
 STATIC mp_obj_t common_Control_stalled(mp_obj_t self_in) {
     common_Control_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    return mp_obj_new_bool(pbio_control_is_stalled(self->control));
+    pbio_motorpoll_lock();
+    bool stalled = pbio_control_is_stalled(self->control);
+    pbio_motorpoll_unlock();
+    return mp_obj_new_bool(stalled);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(common_Control_stalled_obj, common_Control_stalled);
 
 // dir(pybricks.common.Control)
 STATIC const mp_rom_map_elem_t common_Control_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_limits), MP_ROM_PTR(&common_Control_limits_obj) },
+    { MP_ROM_QSTR(MP_QSTR_jerk), MP_ROM_PTR(&common_Control_jerk_obj) },
     { MP_ROM_QSTR(MP_QSTR_pid), MP_ROM_PTR(&common_Control_pid_obj) },
     { MP_ROM_QSTR(MP_QSTR_target_tolerances), MP_ROM_PTR(&common_Control_target_tolerances_obj) },
     { MP_ROM_QSTR(MP_QSTR_stall_tolerances), MP_ROM_PTR(&common_Control_stall_tolerances_obj) },
@@ -27,7 +27,13 @@ STATIC mp_obj_t common_DCMotor_make_new(const mp_obj_type_t *type, size_t n_args
     // Get and initialize DC Motor
     pbio_dcmotor_t *dc;
     pbio_error_t err;
-    while ((err = pbio_dcmotor_get(port, &dc, direction, false)) == PBIO_ERROR_AGAIN) {
+    while (true) {
+        pbio_motorpoll_lock();
+        err = pbio_dcmotor_get(port, &dc, direction, false);
+        pbio_motorpoll_unlock();
+        if (err != PBIO_ERROR_AGAIN) {
+            break;
+        }
         mp_hal_delay_ms(1000);
     }
     pb_assert(err);
@@ -71,10 +77,10 @@ STATIC mp_obj_t common_DCMotor_duty(size_t n_args, const mp_obj_t *pos_args, mp_
 
     if (is_servo) {
         common_Motor_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
-        pb_assert(pbio_servo_set_duty_cycle(self->srv, duty));
+        PB_ASSERT_LOCKED(pbio_servo_set_duty_cycle(self->srv, duty));
     } else {
         common_DCMotor_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
-        pb_assert(pbio_dcmotor_set_duty_cycle_usr(self->dcmotor, duty));
+        PB_ASSERT_LOCKED(pbio_dcmotor_set_duty_cycle_usr(self->dcmotor, duty));
     }
 
     return mp_const_none;
@@ -90,10 +96,10 @@ STATIC mp_obj_t common_DCMotor_stop(mp_obj_t self_in) {
 
     if (is_servo) {
         common_Motor_obj_t *self = MP_OBJ_TO_PTR(self_in);
-        pb_assert(pbio_servo_stop(self->srv, PBIO_ACTUATION_COAST));
+        PB_ASSERT_LOCKED(pbio_servo_stop(self->srv, PBIO_ACTUATION_COAST));
     } else {
         common_DCMotor_obj_t *self = MP_OBJ_TO_PTR(self_in);
-        pb_assert(pbio_dcmotor_coast(self->dcmotor));
+        PB_ASSERT_LOCKED(pbio_dcmotor_coast(self->dcmotor));
     }
     return mp_const_none;
 }
@@ -108,15 +114,15 @@ STATIC mp_obj_t common_DCMotor_brake(mp_obj_t self_in) {
 
     if (is_servo) {
         common_Motor_obj_t *self = MP_OBJ_TO_PTR(self_in);
-        pb_assert(pbio_servo_stop(self->srv, PBIO_ACTUATION_BRAKE));
+        PB_ASSERT_LOCKED(pbio_servo_stop(self->srv, PBIO_ACTUATION_BRAKE));
     } else {
         common_DCMotor_obj_t *self = MP_OBJ_TO_PTR(self_in);
         #if PYBRICKS_PY_EV3DEVICES
         // Workaround for ev3dev dc-motor not coasting on first try
-        pb_assert(pbio_dcmotor_set_duty_cycle_usr(self->dcmotor, 1));
+        PB_ASSERT_LOCKED(pbio_dcmotor_set_duty_cycle_usr(self->dcmotor, 1));
         mp_hal_delay_ms(1);
         #endif
-        pb_assert(pbio_dcmotor_brake(self->dcmotor));
+        PB_ASSERT_LOCKED(pbio_dcmotor_brake(self->dcmotor));
     }
     return mp_const_none;
 }
@@ -11,12 +11,15 @@
 
 #include <pbio/config.h>
 #include <pbio/logger.h>
+#include <pbio/motorpoll.h>
 #include <pbio/servo.h>
 
 #include "py/obj.h"
 #include "py/runtime.h"
 #include "py/mpconfig.h"
 
+#include <pybricks/common.h>
+
 #include <pybricks/util_pb/pb_error.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
 #include <pybricks/util_mp/pb_kwarg_helper.h>
@@ -33,16 +36,32 @@ STATIC mp_obj_t tools_Logger_start(size_t n_args, const mp_obj_t *pos_args, mp_m
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         tools_Logger_obj_t, self,
         PB_ARG_REQUIRED(duration),
-        PB_ARG_DEFAULT_INT(divisor, 1));
+        PB_ARG_DEFAULT_INT(divisor, 1),
+        PB_ARG_DEFAULT_FALSE(stream),
+        PB_ARG_DEFAULT_FALSE(packed));
 
     mp_int_t divisor = pb_obj_get_int(divisor_in);
     divisor = max(divisor, 1);
-    mp_int_t rows = pb_obj_get_int(duration_in) / PBIO_CONFIG_SERVO_PERIOD_MS / divisor;
+    mp_int_t rows = pb_obj_get_int(duration_in) / PBIO_CONFIG_SERVO_PERIOD_MIN_MS / divisor;
     mp_int_t size = rows * pbio_logger_cols(self->log);
     self->buf = m_renew(int32_t, self->buf, self->size, size);
     self->size = size;
 
-    pbio_logger_start(self->log, self->buf, rows, divisor);
+    // In stream mode, the duration only sets how much can be buffered between
+    // calls to drain(). Logging continues until stopped.
+    if (mp_obj_is_true(stream_in) && mp_obj_is_true(packed_in)) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    pbio_motorpoll_lock();
+    if (mp_obj_is_true(stream_in)) {
+        pbio_logger_start_ring(self->log, self->buf, rows, divisor);
+    } else if (mp_obj_is_true(packed_in)) {
+        // Packed rows are smaller, so this logs for longer than duration
+        pbio_logger_start_packed(self->log, self->buf, rows, divisor);
+    } else {
+        pbio_logger_start(self->log, self->buf, rows, divisor);
+    }
+    pbio_motorpoll_unlock();
 
     return mp_const_none;
 }
@@ -60,7 +79,7 @@ STATIC mp_obj_t tools_Logger_get(size_t n_args, const mp_obj_t *pos_args, mp_map
     int32_t data[MAX_LOG_VALUES];
 
     // Get data for this sample
-    pb_assert(pbio_logger_read(self->log, index, data));
+    PB_ASSERT_LOCKED(pbio_logger_read(self->log, index, data));
     uint8_t num_values = pbio_logger_cols(self->log);
 
     // Convert data to user objects
@@ -74,12 +93,82 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_Logger_get_obj, 1, tools_Logger_get);
 STATIC mp_obj_t tools_Logger_stop(mp_obj_t self_in) {
     tools_Logger_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
+    pbio_motorpoll_lock();
     pbio_logger_stop(self->log);
+    pbio_motorpoll_unlock();
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(tools_Logger_stop_obj, tools_Logger_stop);
 
+STATIC mp_obj_t tools_Logger_drain(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        tools_Logger_obj_t, self,
+        PB_ARG_DEFAULT_NONE(path));
+
+    #if PYBRICKS_HUB_EV3BRICK
+    const char *path = path_in == mp_const_none ? "log.bin" : mp_obj_str_get_str(path_in);
+
+    // Append to file, so it grows with each call while logging
+    FILE *log_file = fopen(path, "ab");
+    if (log_file == NULL) {
+        pb_assert(PBIO_ERROR_IO);
+    }
+    #endif // PYBRICKS_HUB_EV3BRICK
+
+    // Write only the rows that are available now, so a fast producer cannot keep us here
+    pbio_motorpoll_lock();
+    int32_t rows = pbio_logger_rows(self->log);
+    pbio_motorpoll_unlock();
+    uint8_t frame[PBIO_LOG_FRAME_SIZE_MAX];
+    size_t size;
+    pbio_error_t err = PBIO_SUCCESS;
+    int32_t i;
+
+    for (i = 0; i < rows; i++) {
+        pbio_motorpoll_lock();
+        err = pbio_logger_pop_frame(self->log, frame, &size);
+        pbio_motorpoll_unlock();
+        if (err != PBIO_SUCCESS) {
+            break;
+        }
+
+        #if PYBRICKS_HUB_EV3BRICK
+        if (fwrite(frame, 1, size, log_file) != size) {
+            err = PBIO_ERROR_IO;
+            break;
+        }
+        #else
+        // Send each frame as a line of hex, like packed logs, so that binary
+        // data cannot be mistaken for terminal control characters
+        for (size_t j = 0; j < size; j++) {
+            mp_printf(&mp_plat_print, "%02x", frame[j]);
+        }
+        mp_print_str(&mp_plat_print, "\n");
+        #endif // PYBRICKS_HUB_EV3BRICK
+    }
+
+    #if PYBRICKS_HUB_EV3BRICK
+    if (fclose(log_file) != 0) {
+        err = PBIO_ERROR_IO;
+    }
+    #endif // PYBRICKS_HUB_EV3BRICK
+
+    pb_assert(err);
+    return mp_obj_new_int(i);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_Logger_drain_obj, 1, tools_Logger_drain);
+
+STATIC mp_obj_t tools_Logger_overruns(mp_obj_t self_in) {
+    tools_Logger_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pbio_motorpoll_lock();
+    uint32_t overruns = pbio_logger_overruns(self->log);
+    pbio_motorpoll_unlock();
+    return mp_obj_new_int_from_uint(overruns);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(tools_Logger_overruns_obj, tools_Logger_overruns);
+
 static const size_t max_val_strln = sizeof("−2147483648,");
 
 // Make a comma separated list of values
@@ -103,11 +192,58 @@ static void make_data_row_str(char *row, int32_t *data, uint8_t n) {
     }
 }
 
+// Saves a packed log as is, to be decoded by tools/logdecode.py
+STATIC void tools_Logger_save_packed(tools_Logger_obj_t *self, const char *path) {
+
+    // Once stopped, the control loop no longer writes to the log
+    pbio_motorpoll_lock();
+    pbio_logger_stop(self->log);
+    pbio_motorpoll_unlock();
+
+    uint8_t header[PBIO_LOG_PACKED_HEADER_SIZE];
+    const uint8_t *data;
+    size_t size = pbio_logger_get_packed(self->log, header, &data);
+
+    #if PYBRICKS_HUB_EV3BRICK
+    FILE *log_file = fopen(path, "wb");
+    if (log_file == NULL) {
+        pb_assert(PBIO_ERROR_IO);
+    }
+    pbio_error_t err = PBIO_SUCCESS;
+    if (fwrite(header, 1, sizeof(header), log_file) != sizeof(header) || fwrite(data, 1, size, log_file) != size) {
+        err = PBIO_ERROR_IO;
+    }
+    if (fclose(log_file) != 0) {
+        err = PBIO_ERROR_IO;
+    }
+    pb_assert(err);
+    #else
+    // Send as lines of hex, so the data cannot be mistaken for the end of file marker
+    mp_printf(&mp_plat_print, "PB_OF:%s\n", path);
+    for (size_t i = 0; i < sizeof(header); i++) {
+        mp_printf(&mp_plat_print, "%02x", header[i]);
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (i % 32 == 0) {
+            mp_print_str(&mp_plat_print, "\n");
+        }
+        mp_printf(&mp_plat_print, "%02x", data[i]);
+    }
+    mp_print_str(&mp_plat_print, "\nPB_EOF\n");
+    #endif // PYBRICKS_HUB_EV3BRICK
+}
+
 STATIC mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         tools_Logger_obj_t, self,
         PB_ARG_DEFAULT_NONE(path));
+
+    if (self->log->packed) {
+        tools_Logger_save_packed(self, path_in == mp_const_none ? "log.bin" : mp_obj_str_get_str(path_in));
+        return mp_const_none;
+    }
+
     const char *path = path_in == mp_const_none ? "log.txt" : mp_obj_str_get_str(path_in);
 
     #if PYBRICKS_HUB_EV3BRICK
@@ -126,7 +262,9 @@ STATIC mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_ma
     // Read log size information
     int32_t data[MAX_LOG_VALUES];
 
+    pbio_motorpoll_lock();
     pbio_logger_stop(self->log);
+    pbio_motorpoll_unlock();
 
     uint8_t num_values = pbio_logger_cols(self->log);
     int32_t sampled = pbio_logger_rows(self->log);
@@ -176,8 +314,12 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_Logger_save_obj, 1, tools_Logger_save);
 STATIC mp_obj_t tools_Logger_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     tools_Logger_obj_t *self = MP_OBJ_TO_PTR(self_in);
     switch (op) {
-        case MP_UNARY_OP_LEN:
-            return MP_OBJ_NEW_SMALL_INT(pbio_logger_rows(self->log));
+        case MP_UNARY_OP_LEN: {
+            pbio_motorpoll_lock();
+            int32_t rows = pbio_logger_rows(self->log);
+            pbio_motorpoll_unlock();
+            return MP_OBJ_NEW_SMALL_INT(rows);
+        }
         default:
             return MP_OBJ_NULL;
     }
@@ -189,6 +331,8 @@ STATIC const mp_rom_map_elem_t tools_Logger_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&tools_Logger_get_obj) },
     { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&tools_Logger_stop_obj) },
     { MP_ROM_QSTR(MP_QSTR_save), MP_ROM_PTR(&tools_Logger_save_obj) },
+    { MP_ROM_QSTR(MP_QSTR_drain), MP_ROM_PTR(&tools_Logger_drain_obj) },
+    { MP_ROM_QSTR(MP_QSTR_overruns), MP_ROM_PTR(&tools_Logger_overruns_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(tools_Logger_locals_dict, tools_Logger_locals_dict_table);
 
@@ -17,17 +17,32 @@
 #include <pybricks/util_pb/pb_error.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
 #include <pybricks/util_mp/pb_kwarg_helper.h>
+#include <pybricks/util_mp/pb_type_awaitable.h>
 
-/* Wait for servo maneuver to complete */
+/* Check whether the servo maneuver is complete, and raise if it failed. A
+ * maneuver that was replaced by another command is complete as well, as
+ * cancelled, so that awaiting it does not follow the new maneuver. */
 
-STATIC void wait_for_completion(pbio_servo_t *srv) {
-    pbio_error_t err;
-    while ((err = pbio_motorpoll_get_servo_status(srv)) == PBIO_ERROR_AGAIN && !pbio_control_is_done(&srv->control)) {
-        mp_hal_delay_ms(5);
-    }
+STATIC bool common_Motor_test_completion(mp_obj_t self_in, mp_uint_t maneuver) {
+    common_Motor_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pbio_motorpoll_lock();
+    pbio_error_t err = pbio_motorpoll_get_servo_status(self->srv);
+    bool replaced = self->srv->maneuver != maneuver;
+    bool done = pbio_control_is_done(&self->srv->control);
+    pbio_error_t queue_err = self->srv->control.queue_err;
+    pbio_motorpoll_unlock();
     if (err != PBIO_ERROR_AGAIN) {
         pb_assert(err);
+        return true;
+    }
+    if (replaced) {
+        return true;
     }
+    // Raise if queued maneuvers were dropped because they could not be started
+    if (done) {
+        pb_assert(queue_err);
+    }
+    return done;
 }
 
 // pybricks._common.Motor.__init__
@@ -80,12 +95,18 @@ STATIC mp_obj_t common_Motor_make_new(const mp_obj_type_t *type, size_t n_args,
     }
 
     // Get servo device, set it up, and tell the poller if we succeeded.
-    pb_assert(pbio_motorpoll_get_servo(port, &srv));
-    while ((err = pbio_servo_setup(srv, positive_direction, gear_ratio)) == PBIO_ERROR_AGAIN) {
+    PB_ASSERT_LOCKED(pbio_motorpoll_get_servo(port, &srv));
+    while (true) {
+        pbio_motorpoll_lock();
+        err = pbio_servo_setup(srv, positive_direction, gear_ratio);
+        pbio_motorpoll_unlock();
+        if (err != PBIO_ERROR_AGAIN) {
+            break;
+        }
         mp_hal_delay_ms(1000);
     }
     pb_assert(err);
-    pb_assert(pbio_motorpoll_set_servo_status(srv, PBIO_ERROR_AGAIN));
+    PB_ASSERT_LOCKED(pbio_motorpoll_set_servo_status(srv, PBIO_ERROR_AGAIN));
 
     // On success, proceed to create and return the MicroPython object
     common_Motor_obj_t *self = m_new_obj(common_Motor_obj_t);
@@ -106,7 +127,7 @@ STATIC mp_obj_t common_Motor_angle(mp_obj_t self_in) {
     common_Motor_obj_t *self = MP_OBJ_TO_PTR(self_in);
     int32_t angle;
 
-    pb_assert(pbio_tacho_get_angle(self->srv->tacho, &angle));
+    PB_ASSERT_LOCKED(pbio_tacho_get_angle(self->srv->tacho, &angle));
 
     return mp_obj_new_int(angle);
 }
@@ -125,7 +146,7 @@ STATIC mp_obj_t common_Motor_reset_angle(size_t n_args, const mp_obj_t *pos_args
     mp_int_t reset_angle = reset_to_abs ? 0 : pb_obj_get_int(angle_in);
 
     // Set the new angle
-    pb_assert(pbio_servo_reset_angle(self->srv, reset_angle, reset_to_abs));
+    PB_ASSERT_LOCKED(pbio_servo_reset_angle(self->srv, reset_angle, reset_to_abs));
 
     return mp_const_none;
 }
@@ -136,7 +157,7 @@ STATIC mp_obj_t common_Motor_speed(mp_obj_t self_in) {
     common_Motor_obj_t *self = MP_OBJ_TO_PTR(self_in);
     int32_t speed;
 
-    pb_assert(pbio_tacho_get_angular_rate(self->srv->tacho, &speed));
+    PB_ASSERT_LOCKED(pbio_tacho_get_angular_rate(self->srv->tacho, &speed));
 
     return mp_obj_new_int(speed);
 }
@@ -149,7 +170,7 @@ STATIC mp_obj_t common_Motor_run(size_t n_args, const mp_obj_t *pos_args, mp_map
         PB_ARG_REQUIRED(speed));
 
     mp_int_t speed = pb_obj_get_int(speed_in);
-    pb_assert(pbio_servo_run(self->srv, speed));
+    PB_ASSERT_LOCKED(pbio_servo_run(self->srv, speed));
 
     return mp_const_none;
 }
@@ -158,7 +179,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Motor_run_obj, 1, common_Motor_run);
 // pybricks._common.Motor.hold
 STATIC mp_obj_t common_Motor_hold(mp_obj_t self_in) {
     common_Motor_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    pb_assert(pbio_servo_stop(self->srv, PBIO_ACTUATION_HOLD));
+    PB_ASSERT_LOCKED(pbio_servo_stop(self->srv, PBIO_ACTUATION_HOLD));
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(common_Motor_hold_obj, common_Motor_hold);
@@ -182,11 +203,13 @@ STATIC mp_obj_t common_Motor_run_time(size_t n_args, const mp_obj_t *pos_args, m
     pbio_actuation_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
 
     // Call pbio with parsed user/default arguments
-    pb_assert(pbio_servo_run_time(self->srv, speed, time, then));
+    PB_ASSERT_LOCKED(pbio_servo_run_time(self->srv, speed, time, then));
 
-    if (mp_obj_is_true(wait_in)) {
-        wait_for_completion(self->srv);
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
     }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
 
     return mp_const_none;
 }
@@ -218,18 +241,18 @@ STATIC mp_obj_t common_Motor_run_until_stalled(size_t n_args, const mp_obj_t *po
         duty_limit = duty_limit > 100 ? 100 : duty_limit;
 
         // Apply the user limit
-        pb_assert(pbio_control_settings_set_limits(&self->srv->control.settings, orig_speed, acceleration, duty_limit));
+        PB_ASSERT_LOCKED(pbio_control_settings_set_limits(&self->srv->control.settings, orig_speed, acceleration, duty_limit));
     }
 
     mp_obj_t ex = MP_OBJ_NULL;
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
         // Call pbio with parsed user/default arguments
-        pb_assert(pbio_servo_run_until_stalled(self->srv, speed, then));
+        PB_ASSERT_LOCKED(pbio_servo_run_until_stalled(self->srv, speed, then));
 
         // In this command we always wait for completion, so we can return the
         // final angle below.
-        wait_for_completion(self->srv);
+        pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
 
         nlr_pop();
     } else {
@@ -238,7 +261,7 @@ STATIC mp_obj_t common_Motor_run_until_stalled(size_t n_args, const mp_obj_t *po
 
     // Restore original settings
     if (override_duty_limit) {
-        pb_assert(pbio_control_settings_set_limits(&self->srv->control.settings, orig_speed, acceleration, actuation));
+        PB_ASSERT_LOCKED(pbio_control_settings_set_limits(&self->srv->control.settings, orig_speed, acceleration, actuation));
     }
 
     if (ex != MP_OBJ_NULL) {
@@ -247,7 +270,7 @@ STATIC mp_obj_t common_Motor_run_until_stalled(size_t n_args, const mp_obj_t *po
 
     // Read the angle upon completion of the stall maneuver
     int32_t stall_point;
-    pb_assert(pbio_tacho_get_angle(self->srv->tacho, &stall_point));
+    PB_ASSERT_LOCKED(pbio_tacho_get_angle(self->srv->tacho, &stall_point));
 
     // Return angle at which the motor stalled
     return mp_obj_new_int(stall_point);
@@ -268,11 +291,13 @@ STATIC mp_obj_t common_Motor_run_angle(size_t n_args, const mp_obj_t *pos_args,
     pbio_actuation_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
 
     // Call pbio with parsed user/default arguments
-    pb_assert(pbio_servo_run_angle(self->srv, speed, angle, then));
+    PB_ASSERT_LOCKED(pbio_servo_run_angle(self->srv, speed, angle, then));
 
-    if (mp_obj_is_true(wait_in)) {
-        wait_for_completion(self->srv);
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
     }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
 
     return mp_const_none;
 }
@@ -292,16 +317,50 @@ STATIC mp_obj_t common_Motor_run_target(size_t n_args, const mp_obj_t *pos_args,
     pbio_actuation_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
 
     // Call pbio with parsed user/default arguments
-    pb_assert(pbio_servo_run_target(self->srv, speed, target_angle, then));
+    PB_ASSERT_LOCKED(pbio_servo_run_target(self->srv, speed, target_angle, then));
 
-    if (mp_obj_is_true(wait_in)) {
-        wait_for_completion(self->srv);
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
     }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->srv->maneuver, common_Motor_test_completion);
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Motor_run_target_obj, 1, common_Motor_run_target);
 
+// pybricks._common.Motor.queue_target
+STATIC mp_obj_t common_Motor_queue_target(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        common_Motor_obj_t, self,
+        PB_ARG_REQUIRED(speed),
+        PB_ARG_REQUIRED(target_angle),
+        PB_ARG_DEFAULT_FALSE(stop),
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_HOLD_obj));
+
+    mp_int_t speed = pb_obj_get_int(speed_in);
+    mp_int_t target_angle = pb_obj_get_int(target_angle_in);
+    bool stop = mp_obj_is_true(stop_in);
+    pbio_actuation_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+
+    // Call pbio with parsed user/default arguments. If the queue is full,
+    // wait for the ongoing maneuver to make room.
+    pbio_error_t err;
+    while (true) {
+        pbio_motorpoll_lock();
+        err = pbio_servo_queue_target(self->srv, speed, target_angle, stop, then);
+        pbio_motorpoll_unlock();
+        if (err != PBIO_ERROR_AGAIN) {
+            break;
+        }
+        mp_hal_delay_ms(5);
+    }
+    pb_assert(err);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Motor_queue_target_obj, 1, common_Motor_queue_target);
+
 // pybricks._common.Motor.track_target
 STATIC mp_obj_t common_Motor_track_target(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
@@ -309,12 +368,33 @@ STATIC mp_obj_t common_Motor_track_target(size_t n_args, const mp_obj_t *pos_arg
         PB_ARG_REQUIRED(target_angle));
 
     mp_int_t target_angle = pb_obj_get_int(target_angle_in);
-    pb_assert(pbio_servo_track_target(self->srv, target_angle));
+    PB_ASSERT_LOCKED(pbio_servo_track_target(self->srv, target_angle));
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Motor_track_target_obj, 1, common_Motor_track_target);
 
+// pybricks._common.Motor.control_period
+STATIC mp_obj_t common_Motor_control_period(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        common_Motor_obj_t, self,
+        PB_ARG_DEFAULT_NONE(period));
+
+    // If no value is given, return current value
+    if (period_in == mp_const_none) {
+        int32_t period;
+        PB_ASSERT_LOCKED(pbio_motorpoll_get_servo_period(self->srv, &period));
+        return mp_obj_new_int(period);
+    }
+
+    // Set the update period (ms) used during maneuvers
+    PB_ASSERT_LOCKED(pbio_motorpoll_set_servo_period(self->srv, pb_obj_get_int(period_in)));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_Motor_control_period_obj, 1, common_Motor_control_period);
+
 // dir(pybricks.builtins.Motor)
 STATIC const mp_rom_map_elem_t common_Motor_locals_dict_table[] = {
     //
@@ -335,7 +415,9 @@ STATIC const mp_rom_map_elem_t common_Motor_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_run_until_stalled), MP_ROM_PTR(&common_Motor_run_until_stalled_obj) },
     { MP_ROM_QSTR(MP_QSTR_run_angle), MP_ROM_PTR(&common_Motor_run_angle_obj) },
     { MP_ROM_QSTR(MP_QSTR_run_target), MP_ROM_PTR(&common_Motor_run_target_obj) },
+    { MP_ROM_QSTR(MP_QSTR_queue_target), MP_ROM_PTR(&common_Motor_queue_target_obj) },
     { MP_ROM_QSTR(MP_QSTR_track_target), MP_ROM_PTR(&common_Motor_track_target_obj) },
+    { MP_ROM_QSTR(MP_QSTR_control_period), MP_ROM_PTR(&common_Motor_control_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_log), MP_ROM_ATTRIBUTE_OFFSET(common_Motor_obj_t, logger) },
     { MP_ROM_QSTR(MP_QSTR_control), MP_ROM_ATTRIBUTE_OFFSET(common_Motor_obj_t, control) },
 };
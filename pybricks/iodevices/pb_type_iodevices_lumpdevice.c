@@ -22,6 +22,7 @@ typedef struct _iodevices_LUMPDevice_obj_t {
     mp_obj_base_t base;
     pb_device_t *pbdev;
     mp_obj_t id;
+    uint32_t sample_count;
 } iodevices_LUMPDevice_obj_t;
 
 // pybricks.iodevices.LUMPDevice.__init__
@@ -42,6 +43,7 @@ STATIC mp_obj_t iodevices_LUMPDevice_make_new(const mp_obj_type_t *type, size_t
     uint8_t num_values;
     pb_device_get_info(self->pbdev, &_port, &id, &curr_mode, &num_values);
     self->id = mp_obj_new_int(id);
+    self->sample_count = 0;
 
     #if PYBRICKS_PY_PUPDEVICES
     // FIXME: Read sensor capability flag to see which sensor uses power. As
@@ -57,13 +59,26 @@ STATIC mp_obj_t iodevices_LUMPDevice_make_new(const mp_obj_type_t *type, size_t
 STATIC mp_obj_t iodevices_LUMPDevice_read(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         iodevices_LUMPDevice_obj_t, self,
-        PB_ARG_REQUIRED(mode));
+        PB_ARG_REQUIRED(mode),
+        PB_ARG_DEFAULT_FALSE(wait));
+
+    // Optionally wait for data that was not read before, so that a loop
+    // runs exactly as fast as the sensor sends data
+    if (mp_obj_is_true(wait_in)) {
+        pb_device_wait_sample(self->pbdev, self->sample_count);
+    }
 
     // Get data already in correct data format
     int32_t data[PBIO_IODEV_MAX_DATA_SIZE];
     mp_obj_t objs[PBIO_IODEV_MAX_DATA_SIZE];
     pb_device_get_values(self->pbdev, mp_obj_get_int(mode_in), data);
 
+    // Keep track of which sample this was for the next wait
+    if (mp_obj_is_true(wait_in)) {
+        uint32_t time;
+        pb_device_get_sample(self->pbdev, &self->sample_count, &time);
+    }
+
     // Get info about the sensor and its mode
     pbio_port_t port;
     pbio_iodev_type_id_t id;
@@ -108,10 +123,27 @@ STATIC mp_obj_t iodevices_LUMPDevice_write(size_t n_args, const mp_obj_t *pos_ar
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(iodevices_LUMPDevice_write_obj, 1, iodevices_LUMPDevice_write);
 
+// pybricks.iodevices.LUMPDevice.sample
+STATIC mp_obj_t iodevices_LUMPDevice_sample(mp_obj_t self_in) {
+    iodevices_LUMPDevice_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // Sequence number and time (us) of the most recent data
+    uint32_t count;
+    uint32_t time;
+    pb_device_get_sample(self->pbdev, &count, &time);
+
+    mp_obj_t ret[2];
+    ret[0] = mp_obj_new_int_from_uint(count);
+    ret[1] = mp_obj_new_int_from_uint(time);
+    return mp_obj_new_tuple(2, ret);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(iodevices_LUMPDevice_sample_obj, iodevices_LUMPDevice_sample);
+
 // dir(pybricks.iodevices.LUMPDevice)
 STATIC const mp_rom_map_elem_t iodevices_LUMPDevice_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read),       MP_ROM_PTR(&iodevices_LUMPDevice_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_write),      MP_ROM_PTR(&iodevices_LUMPDevice_write_obj)},
+    { MP_ROM_QSTR(MP_QSTR_sample),     MP_ROM_PTR(&iodevices_LUMPDevice_sample_obj)},
     { MP_ROM_QSTR(MP_QSTR_ID),         MP_ROM_ATTRIBUTE_OFFSET(iodevices_LUMPDevice_obj_t, id) },
 };
 STATIC MP_DEFINE_CONST_DICT(iodevices_LUMPDevice_locals_dict, iodevices_LUMPDevice_locals_dict_table);
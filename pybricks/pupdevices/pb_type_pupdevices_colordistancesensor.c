@@ -96,6 +96,36 @@ STATIC mp_obj_t pupdevices_ColorDistanceSensor_distance(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(pupdevices_ColorDistanceSensor_distance_obj, pupdevices_ColorDistanceSensor_distance);
 
+#if PBIO_CONFIG_IODEV_HISTORY_SIZE
+
+// Scales a proximity sample to mm
+STATIC mp_obj_t pupdevices_ColorDistanceSensor_scale_distance(int32_t distance) {
+    return mp_obj_new_int(distance * 10);
+}
+
+// pybricks.pupdevices.ColorDistanceSensor.samples
+STATIC mp_obj_t pupdevices_ColorDistanceSensor_samples(mp_obj_t self_in, mp_obj_t n_in) {
+    pupdevices_ColorDistanceSensor_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return pb_device_get_samples(self->pbdev, PBIO_IODEV_MODE_PUP_COLOR_DISTANCE_SENSOR__PROX,
+        n_in, pupdevices_ColorDistanceSensor_scale_distance);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pupdevices_ColorDistanceSensor_samples_obj, pupdevices_ColorDistanceSensor_samples);
+
+// pybricks.pupdevices.ColorDistanceSensor.filtered
+STATIC mp_obj_t pupdevices_ColorDistanceSensor_filtered(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pupdevices_ColorDistanceSensor_obj_t, self,
+        PB_ARG_DEFAULT_INT(n, 5),
+        PB_ARG_DEFAULT_QSTR(filter, average),
+        PB_ARG_DEFAULT_INT(weight, 25));
+
+    return pb_device_get_filtered(self->pbdev, PBIO_IODEV_MODE_PUP_COLOR_DISTANCE_SENSOR__PROX,
+        n_in, filter_in, weight_in, NULL, pupdevices_ColorDistanceSensor_scale_distance);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pupdevices_ColorDistanceSensor_filtered_obj, 1, pupdevices_ColorDistanceSensor_filtered);
+
+#endif // PBIO_CONFIG_IODEV_HISTORY_SIZE
+
 // pybricks.pupdevices.ColorDistanceSensor.reflection
 STATIC mp_obj_t pupdevices_ColorDistanceSensor_reflection(mp_obj_t self_in) {
     pupdevices_ColorDistanceSensor_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -136,6 +166,10 @@ STATIC const mp_rom_map_elem_t pupdevices_ColorDistanceSensor_locals_dict_table[
     { MP_ROM_QSTR(MP_QSTR_ambient),     MP_ROM_PTR(&pupdevices_ColorDistanceSensor_ambient_obj)              },
     { MP_ROM_QSTR(MP_QSTR_distance),    MP_ROM_PTR(&pupdevices_ColorDistanceSensor_distance_obj)             },
     { MP_ROM_QSTR(MP_QSTR_hsv),         MP_ROM_PTR(&pupdevices_ColorDistanceSensor_hsv_obj)                  },
+    #if PBIO_CONFIG_IODEV_HISTORY_SIZE
+    { MP_ROM_QSTR(MP_QSTR_samples),     MP_ROM_PTR(&pupdevices_ColorDistanceSensor_samples_obj)              },
+    { MP_ROM_QSTR(MP_QSTR_filtered),    MP_ROM_PTR(&pupdevices_ColorDistanceSensor_filtered_obj)             },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_color_map),   MP_ROM_PTR(&pb_ColorSensor_color_map_obj)                            },
     { MP_ROM_QSTR(MP_QSTR_light),       MP_ROM_ATTRIBUTE_OFFSET(pupdevices_ColorDistanceSensor_obj_t, light) },
 };
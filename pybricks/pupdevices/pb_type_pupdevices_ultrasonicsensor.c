@@ -12,6 +12,7 @@
 #include <pybricks/util_mp/pb_kwarg_helper.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
 #include <pybricks/util_pb/pb_device.h>
+#include <pybricks/util_pb/pb_error.h>
 
 // Class structure for UltrasonicSensor
 typedef struct _pupdevices_UltrasonicSensor_obj_t {
@@ -42,15 +43,51 @@ STATIC mp_obj_t pupdevices_UltrasonicSensor_make_new(const mp_obj_type_t *type,
     return MP_OBJ_FROM_PTR(self);
 }
 
+// Reports distances out of range (-1 if there is no object) as 2000 mm
+STATIC int32_t pupdevices_UltrasonicSensor_normalize_distance(int32_t distance) {
+    return distance < 0 || distance >= 2000 ? 2000 : distance;
+}
+
 // pybricks.pupdevices.UltrasonicSensor.distance
 STATIC mp_obj_t pupdevices_UltrasonicSensor_distance(mp_obj_t self_in) {
     pupdevices_UltrasonicSensor_obj_t *self = MP_OBJ_TO_PTR(self_in);
     int32_t distance;
     pb_device_get_values(self->pbdev, PBIO_IODEV_MODE_PUP_ULTRASONIC_SENSOR__DISTL, &distance);
-    return mp_obj_new_int(distance < 0 || distance >= 2000 ? 2000 : distance);
+    return mp_obj_new_int(pupdevices_UltrasonicSensor_normalize_distance(distance));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pupdevices_UltrasonicSensor_distance_obj, pupdevices_UltrasonicSensor_distance);
 
+#if PBIO_CONFIG_IODEV_HISTORY_SIZE
+
+// Reports distances out of range as 2000 mm, like distance() does
+STATIC mp_obj_t pupdevices_UltrasonicSensor_scale_distance(int32_t distance) {
+    return mp_obj_new_int(pupdevices_UltrasonicSensor_normalize_distance(distance));
+}
+
+// pybricks.pupdevices.UltrasonicSensor.samples
+STATIC mp_obj_t pupdevices_UltrasonicSensor_samples(mp_obj_t self_in, mp_obj_t n_in) {
+    pupdevices_UltrasonicSensor_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return pb_device_get_samples(self->pbdev, PBIO_IODEV_MODE_PUP_ULTRASONIC_SENSOR__DISTL,
+        n_in, pupdevices_UltrasonicSensor_scale_distance);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pupdevices_UltrasonicSensor_samples_obj, pupdevices_UltrasonicSensor_samples);
+
+// pybricks.pupdevices.UltrasonicSensor.filtered
+STATIC mp_obj_t pupdevices_UltrasonicSensor_filtered(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pupdevices_UltrasonicSensor_obj_t, self,
+        PB_ARG_DEFAULT_INT(n, 5),
+        PB_ARG_DEFAULT_QSTR(filter, average),
+        PB_ARG_DEFAULT_INT(weight, 25));
+
+    return pb_device_get_filtered(self->pbdev, PBIO_IODEV_MODE_PUP_ULTRASONIC_SENSOR__DISTL,
+        n_in, filter_in, weight_in,
+        pupdevices_UltrasonicSensor_normalize_distance, pupdevices_UltrasonicSensor_scale_distance);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pupdevices_UltrasonicSensor_filtered_obj, 1, pupdevices_UltrasonicSensor_filtered);
+
+#endif // PBIO_CONFIG_IODEV_HISTORY_SIZE
+
 // pybricks.pupdevices.UltrasonicSensor.presence
 STATIC mp_obj_t pupdevices_UltrasonicSensor_presence(mp_obj_t self_in) {
     pupdevices_UltrasonicSensor_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -64,6 +101,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(pupdevices_UltrasonicSensor_presence_obj, pupde
 STATIC const mp_rom_map_elem_t pupdevices_UltrasonicSensor_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_distance),     MP_ROM_PTR(&pupdevices_UltrasonicSensor_distance_obj)              },
     { MP_ROM_QSTR(MP_QSTR_presence),     MP_ROM_PTR(&pupdevices_UltrasonicSensor_presence_obj)              },
+    #if PBIO_CONFIG_IODEV_HISTORY_SIZE
+    { MP_ROM_QSTR(MP_QSTR_samples),      MP_ROM_PTR(&pupdevices_UltrasonicSensor_samples_obj)               },
+    { MP_ROM_QSTR(MP_QSTR_filtered),     MP_ROM_PTR(&pupdevices_UltrasonicSensor_filtered_obj)              },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_lights),       MP_ROM_ATTRIBUTE_OFFSET(pupdevices_UltrasonicSensor_obj_t, lights) },
 };
 STATIC MP_DEFINE_CONST_DICT(pupdevices_UltrasonicSensor_locals_dict, pupdevices_UltrasonicSensor_locals_dict_table);
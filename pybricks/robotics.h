@@ -23,6 +23,7 @@ const mp_obj_fun_builtin_var_t pb_func_UnitVector;
 #endif // MICROPY_PY_BUILTINS_FLOAT
 
 const mp_obj_type_t pb_type_drivebase;
+const mp_obj_type_t pb_type_servogroup;
 
 const mp_obj_module_t pb_module_robotics;
 
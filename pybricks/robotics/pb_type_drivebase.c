@@ -18,6 +18,7 @@
 
 #include <pybricks/util_mp/pb_kwarg_helper.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
+#include <pybricks/util_mp/pb_type_awaitable.h>
 #include <pybricks/util_pb/pb_error.h>
 
 // pybricks.robotics.DriveBase class object
@@ -60,9 +61,11 @@ STATIC mp_obj_t robotics_DriveBase_make_new(const mp_obj_type_t *type, size_t n_
     }
 
     // Create drivebase
-    pb_assert(pbio_motorpoll_get_drivebase(&self->db));
-    pb_assert(pbio_drivebase_setup(self->db, srv_left, srv_right, pb_obj_get_fix16(wheel_diameter_in), pb_obj_get_fix16(axle_track_in)));
-    pb_assert(pbio_motorpoll_set_drivebase_status(self->db, PBIO_ERROR_AGAIN));
+    fix16_t wheel_diameter = pb_obj_get_fix16(wheel_diameter_in);
+    fix16_t axle_track = pb_obj_get_fix16(axle_track_in);
+    PB_ASSERT_LOCKED(pbio_motorpoll_get_drivebase(&self->db));
+    PB_ASSERT_LOCKED(pbio_drivebase_setup(self->db, srv_left, srv_right, wheel_diameter, axle_track));
+    PB_ASSERT_LOCKED(pbio_motorpoll_set_drivebase_status(self->db, PBIO_ERROR_AGAIN));
 
     // Create an instance of the Logger class
     self->logger = logger_obj_make_new(&self->db->log);
@@ -84,26 +87,37 @@ STATIC mp_obj_t robotics_DriveBase_make_new(const mp_obj_type_t *type, size_t n_
     return MP_OBJ_FROM_PTR(self);
 }
 
-STATIC void wait_for_completion_drivebase(pbio_drivebase_t *db) {
-    pbio_error_t err;
-    while ((err = pbio_motorpoll_get_drivebase_status(db)) == PBIO_ERROR_AGAIN && (!pbio_control_is_done(&db->control_distance) || !pbio_control_is_done(&db->control_heading))) {
-        mp_hal_delay_ms(5);
-    }
+// Check whether the drivebase maneuver is complete, and raise if it failed.
+// A maneuver that was replaced by another command completes as cancelled.
+STATIC bool robotics_DriveBase_test_completion(mp_obj_t self_in, mp_uint_t maneuver) {
+    robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pbio_motorpoll_lock();
+    pbio_error_t err = pbio_motorpoll_get_drivebase_status(self->db);
+    bool replaced = self->db->maneuver != maneuver;
+    bool done = pbio_control_is_done(&self->db->control_distance) && pbio_control_is_done(&self->db->control_heading);
+    pbio_motorpoll_unlock();
     if (err != PBIO_ERROR_AGAIN) {
         pb_assert(err);
+        return true;
     }
+    return replaced || done;
 }
 
 // pybricks.robotics.DriveBase.straight
 STATIC mp_obj_t robotics_DriveBase_straight(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         robotics_DriveBase_obj_t, self,
-        PB_ARG_REQUIRED(distance));
+        PB_ARG_REQUIRED(distance),
+        PB_ARG_DEFAULT_TRUE(wait));
 
     mp_int_t distance = pb_obj_get_int(distance_in);
-    pb_assert(pbio_drivebase_straight(self->db, distance, self->straight_speed, self->straight_acceleration));
+    PB_ASSERT_LOCKED(pbio_drivebase_straight(self->db, distance, self->straight_speed, self->straight_acceleration));
 
-    wait_for_completion_drivebase(self->db);
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->db->maneuver, robotics_DriveBase_test_completion);
+    }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->db->maneuver, robotics_DriveBase_test_completion);
 
     return mp_const_none;
 }
@@ -113,17 +127,60 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_straight_obj, 1, robotics_D
 STATIC mp_obj_t robotics_DriveBase_turn(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         robotics_DriveBase_obj_t, self,
-        PB_ARG_REQUIRED(angle));
+        PB_ARG_REQUIRED(angle),
+        PB_ARG_DEFAULT_TRUE(wait));
 
     mp_int_t angle_val = pb_obj_get_int(angle_in);
-    pb_assert(pbio_drivebase_turn(self->db, angle_val, self->turn_rate, self->turn_acceleration));
+    PB_ASSERT_LOCKED(pbio_drivebase_turn(self->db, angle_val, self->turn_rate, self->turn_acceleration));
 
-    wait_for_completion_drivebase(self->db);
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->db->maneuver, robotics_DriveBase_test_completion);
+    }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->db->maneuver, robotics_DriveBase_test_completion);
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_turn_obj, 1, robotics_DriveBase_turn);
 
+// pybricks.robotics.DriveBase.follow_path
+STATIC mp_obj_t robotics_DriveBase_follow_path(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(waypoints),
+        PB_ARG_DEFAULT_NONE(speed),
+        PB_ARG_DEFAULT_INT(lookahead, 100),
+        PB_ARG_DEFAULT_TRUE(wait));
+
+    // Get the waypoints as (x, y) pairs in mm
+    size_t size;
+    mp_obj_t *points;
+    mp_obj_get_array(waypoints_in, &size, &points);
+    if (size == 0 || size > PBIO_CONFIG_DRIVEBASE_PATH_SIZE) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    pbio_drivebase_waypoint_t waypoints[PBIO_CONFIG_DRIVEBASE_PATH_SIZE];
+    for (size_t i = 0; i < size; i++) {
+        mp_obj_t *xy;
+        mp_obj_get_array_fixed_n(points[i], 2, &xy);
+        waypoints[i].x = pb_obj_get_int(xy[0]);
+        waypoints[i].y = pb_obj_get_int(xy[1]);
+    }
+
+    mp_int_t speed = pb_obj_get_default_int(speed_in, self->straight_speed);
+    mp_int_t lookahead = pb_obj_get_int(lookahead_in);
+    PB_ASSERT_LOCKED(pbio_drivebase_follow_path(self->db, waypoints, size, speed, self->straight_acceleration, lookahead));
+
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->db->maneuver, robotics_DriveBase_test_completion);
+    }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->db->maneuver, robotics_DriveBase_test_completion);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_follow_path_obj, 1, robotics_DriveBase_follow_path);
+
 // pybricks.robotics.DriveBase.drive
 STATIC mp_obj_t robotics_DriveBase_drive(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
@@ -135,7 +192,7 @@ STATIC mp_obj_t robotics_DriveBase_drive(size_t n_args, const mp_obj_t *pos_args
     mp_int_t speed = pb_obj_get_int(speed_in);
     mp_int_t turn_rate = pb_obj_get_int(turn_rate_in);
 
-    pb_assert(pbio_drivebase_drive(self->db, speed, turn_rate));
+    PB_ASSERT_LOCKED(pbio_drivebase_drive(self->db, speed, turn_rate));
 
     return mp_const_none;
 }
@@ -144,7 +201,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_drive_obj, 1, robotics_Driv
 // pybricks._common.DriveBase.stop
 STATIC mp_obj_t robotics_DriveBase_stop(mp_obj_t self_in) {
     robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    pb_assert(pbio_drivebase_stop(self->db, PBIO_ACTUATION_COAST));
+    PB_ASSERT_LOCKED(pbio_drivebase_stop(self->db, PBIO_ACTUATION_COAST));
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(robotics_DriveBase_stop_obj, robotics_DriveBase_stop);
@@ -154,7 +211,7 @@ STATIC mp_obj_t robotics_DriveBase_distance(mp_obj_t self_in) {
     robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
     int32_t distance, drive_speed, angle, turn_rate;
-    pb_assert(pbio_drivebase_get_state(self->db, &distance, &drive_speed, &angle, &turn_rate));
+    PB_ASSERT_LOCKED(pbio_drivebase_get_state(self->db, &distance, &drive_speed, &angle, &turn_rate));
 
     return mp_obj_new_int(distance);
 }
@@ -165,7 +222,7 @@ STATIC mp_obj_t robotics_DriveBase_angle(mp_obj_t self_in) {
     robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
     int32_t distance, drive_speed, angle, turn_rate;
-    pb_assert(pbio_drivebase_get_state(self->db, &distance, &drive_speed, &angle, &turn_rate));
+    PB_ASSERT_LOCKED(pbio_drivebase_get_state(self->db, &distance, &drive_speed, &angle, &turn_rate));
 
     return mp_obj_new_int(angle);
 }
@@ -176,7 +233,7 @@ STATIC mp_obj_t robotics_DriveBase_state(mp_obj_t self_in) {
     robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
     int32_t distance, drive_speed, angle, turn_rate;
-    pb_assert(pbio_drivebase_get_state(self->db, &distance, &drive_speed, &angle, &turn_rate));
+    PB_ASSERT_LOCKED(pbio_drivebase_get_state(self->db, &distance, &drive_speed, &angle, &turn_rate));
 
     mp_obj_t ret[4];
     ret[0] = mp_obj_new_int(distance);
@@ -188,12 +245,52 @@ STATIC mp_obj_t robotics_DriveBase_state(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(robotics_DriveBase_state_obj, robotics_DriveBase_state);
 
+// pybricks._common.DriveBase.pose
+STATIC mp_obj_t robotics_DriveBase_pose(mp_obj_t self_in) {
+    robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // The pose is integrated on every control update, so just read it
+    int32_t x, y, heading;
+    pbio_motorpoll_lock();
+    pbio_odometry_get_pose(&self->db->odometry, &x, &y, &heading);
+    pbio_motorpoll_unlock();
+
+    mp_obj_t ret[3];
+    ret[0] = mp_obj_new_int(x / 1000);
+    ret[1] = mp_obj_new_int(y / 1000);
+    ret[2] = mp_obj_new_int(heading / 1000);
+
+    return mp_obj_new_tuple(3, ret);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(robotics_DriveBase_pose_obj, robotics_DriveBase_pose);
+
+// pybricks._common.DriveBase.fuse_heading
+STATIC mp_obj_t robotics_DriveBase_fuse_heading(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(angle),
+        PB_ARG_DEFAULT_INT(weight, 100));
+
+    mp_int_t angle = pb_obj_get_int(angle_in);
+    mp_int_t weight = pb_obj_get_int(weight_in);
+    if (weight < 0 || weight > 100) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+
+    pbio_motorpoll_lock();
+    pbio_odometry_fuse_heading(&self->db->odometry, angle * 1000, weight);
+    pbio_motorpoll_unlock();
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_fuse_heading_obj, 1, robotics_DriveBase_fuse_heading);
+
 
 // pybricks._common.DriveBase.reset
 STATIC mp_obj_t robotics_DriveBase_reset(mp_obj_t self_in) {
     robotics_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
-    pb_assert(pbio_drivebase_reset_state(self->db));
+    PB_ASSERT_LOCKED(pbio_drivebase_reset_state(self->db));
 
     return mp_const_none;
 }
@@ -241,17 +338,42 @@ STATIC mp_obj_t robotics_DriveBase_settings(size_t n_args, const mp_obj_t *pos_a
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_settings_obj, 1, robotics_DriveBase_settings);
 
+// pybricks.robotics.DriveBase.control_period
+STATIC mp_obj_t robotics_DriveBase_control_period(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_DriveBase_obj_t, self,
+        PB_ARG_DEFAULT_NONE(period));
+
+    // If no value is given, return current value
+    if (period_in == mp_const_none) {
+        int32_t period;
+        PB_ASSERT_LOCKED(pbio_motorpoll_get_drivebase_period(self->db, &period));
+        return mp_obj_new_int(period);
+    }
+
+    // Set the update period (ms) used during maneuvers
+    PB_ASSERT_LOCKED(pbio_motorpoll_set_drivebase_period(self->db, pb_obj_get_int(period_in)));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_DriveBase_control_period_obj, 1, robotics_DriveBase_control_period);
+
 // dir(pybricks.robotics.DriveBase)
 STATIC const mp_rom_map_elem_t robotics_DriveBase_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_straight),         MP_ROM_PTR(&robotics_DriveBase_straight_obj) },
     { MP_ROM_QSTR(MP_QSTR_turn),             MP_ROM_PTR(&robotics_DriveBase_turn_obj)     },
     { MP_ROM_QSTR(MP_QSTR_drive),            MP_ROM_PTR(&robotics_DriveBase_drive_obj)    },
+    { MP_ROM_QSTR(MP_QSTR_follow_path),      MP_ROM_PTR(&robotics_DriveBase_follow_path_obj) },
     { MP_ROM_QSTR(MP_QSTR_stop),             MP_ROM_PTR(&robotics_DriveBase_stop_obj)     },
     { MP_ROM_QSTR(MP_QSTR_distance),         MP_ROM_PTR(&robotics_DriveBase_distance_obj) },
     { MP_ROM_QSTR(MP_QSTR_angle),            MP_ROM_PTR(&robotics_DriveBase_angle_obj)    },
     { MP_ROM_QSTR(MP_QSTR_state),            MP_ROM_PTR(&robotics_DriveBase_state_obj)    },
+    { MP_ROM_QSTR(MP_QSTR_pose),             MP_ROM_PTR(&robotics_DriveBase_pose_obj)     },
+    { MP_ROM_QSTR(MP_QSTR_fuse_heading),     MP_ROM_PTR(&robotics_DriveBase_fuse_heading_obj) },
     { MP_ROM_QSTR(MP_QSTR_reset),            MP_ROM_PTR(&robotics_DriveBase_reset_obj)    },
     { MP_ROM_QSTR(MP_QSTR_settings),         MP_ROM_PTR(&robotics_DriveBase_settings_obj) },
+    { MP_ROM_QSTR(MP_QSTR_control_period),   MP_ROM_PTR(&robotics_DriveBase_control_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_left),             MP_ROM_ATTRIBUTE_OFFSET(robotics_DriveBase_obj_t, left)            },
     { MP_ROM_QSTR(MP_QSTR_right),            MP_ROM_ATTRIBUTE_OFFSET(robotics_DriveBase_obj_t, right)           },
     { MP_ROM_QSTR(MP_QSTR_log),              MP_ROM_ATTRIBUTE_OFFSET(robotics_DriveBase_obj_t, logger)          },
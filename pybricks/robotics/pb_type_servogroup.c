@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include "py/mpconfig.h"
+
+#if PYBRICKS_PY_ROBOTICS && PYBRICKS_PY_COMMON_MOTORS
+
+#include <pbio/motorpoll.h>
+#include <pbio/servogroup.h>
+
+#include "py/obj.h"
+
+#include <pybricks/common.h>
+#include <pybricks/parameters.h>
+
+#include <pybricks/util_mp/pb_kwarg_helper.h>
+#include <pybricks/util_mp/pb_obj_helper.h>
+#include <pybricks/util_mp/pb_type_awaitable.h>
+#include <pybricks/util_pb/pb_error.h>
+
+// pybricks.robotics.ServoGroup class object
+typedef struct _robotics_ServoGroup_obj_t {
+    mp_obj_base_t base;
+    pbio_servogroup_t *grp;
+    mp_obj_t motors;
+    mp_obj_t logger;
+} robotics_ServoGroup_obj_t;
+
+// pybricks.robotics.ServoGroup.__init__
+STATIC mp_obj_t robotics_ServoGroup_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+
+    PB_PARSE_ARGS_CLASS(n_args, n_kw, args,
+        PB_ARG_REQUIRED(motors),
+        PB_ARG_DEFAULT_NONE(mix));
+
+    robotics_ServoGroup_obj_t *self = m_new_obj(robotics_ServoGroup_obj_t);
+    self->base.type = (mp_obj_type_t *)type;
+
+    // Pointers to servos
+    size_t size;
+    mp_obj_t *motors;
+    mp_obj_get_array(motors_in, &size, &motors);
+    if (size == 0 || size > PBIO_CONFIG_SERVOGROUP_SIZE) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    pbio_servo_t *servos[PBIO_CONFIG_SERVOGROUP_SIZE];
+    for (size_t j = 0; j < size; j++) {
+        servos[j] = ((common_Motor_obj_t *)pb_obj_get_base_class_obj(motors[j], &pb_type_Motor))->srv;
+    }
+    self->motors = mp_obj_new_tuple(size, motors);
+
+    // Mixing matrix, given as one row of weights per axis
+    int8_t mix[PBIO_CONFIG_SERVOGROUP_SIZE * PBIO_CONFIG_SERVOGROUP_SIZE];
+    if (mix_in != mp_const_none) {
+        size_t n_rows;
+        mp_obj_t *rows;
+        mp_obj_get_array(mix_in, &n_rows, &rows);
+        if (n_rows != size) {
+            pb_assert(PBIO_ERROR_INVALID_ARG);
+        }
+        for (size_t i = 0; i < size; i++) {
+            mp_obj_t *weights;
+            mp_obj_get_array_fixed_n(rows[i], size, &weights);
+            for (size_t j = 0; j < size; j++) {
+                mp_int_t weight = pb_obj_get_int(weights[j]);
+                if (weight < INT8_MIN || weight > INT8_MAX) {
+                    pb_assert(PBIO_ERROR_INVALID_ARG);
+                }
+                mix[i * size + j] = weight;
+            }
+        }
+    }
+
+    // Create servo group
+    PB_ASSERT_LOCKED(pbio_motorpoll_get_servogroup(&self->grp));
+    PB_ASSERT_LOCKED(pbio_servogroup_setup(self->grp, servos, size, mix_in == mp_const_none ? NULL : mix));
+    PB_ASSERT_LOCKED(pbio_motorpoll_set_servogroup_status(self->grp, PBIO_ERROR_AGAIN));
+
+    // Create an instance of the Logger class
+    self->logger = logger_obj_make_new(&self->grp->log);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Check whether the servo group maneuver is complete, and raise if it failed.
+// A maneuver that was replaced by another command completes as cancelled.
+STATIC bool robotics_ServoGroup_test_completion(mp_obj_t self_in, mp_uint_t maneuver) {
+    robotics_ServoGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pbio_motorpoll_lock();
+    pbio_error_t err = pbio_motorpoll_get_servogroup_status(self->grp);
+    bool replaced = self->grp->maneuver != maneuver;
+    bool done = pbio_servogroup_is_done(self->grp);
+    pbio_motorpoll_unlock();
+    if (err != PBIO_ERROR_AGAIN) {
+        pb_assert(err);
+        return true;
+    }
+    return replaced || done;
+}
+
+// pybricks.robotics.ServoGroup.run
+STATIC mp_obj_t robotics_ServoGroup_run(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_ServoGroup_obj_t, self,
+        PB_ARG_REQUIRED(axis),
+        PB_ARG_REQUIRED(speed));
+
+    mp_int_t axis = pb_obj_get_int(axis_in);
+    mp_int_t speed = pb_obj_get_int(speed_in);
+    PB_ASSERT_LOCKED(pbio_servogroup_run(self->grp, axis, speed));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_ServoGroup_run_obj, 1, robotics_ServoGroup_run);
+
+// pybricks.robotics.ServoGroup.run_target
+STATIC mp_obj_t robotics_ServoGroup_run_target(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_ServoGroup_obj_t, self,
+        PB_ARG_REQUIRED(axis),
+        PB_ARG_REQUIRED(speed),
+        PB_ARG_REQUIRED(target_angle),
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_HOLD_obj),
+        PB_ARG_DEFAULT_TRUE(wait));
+
+    mp_int_t axis = pb_obj_get_int(axis_in);
+    mp_int_t speed = pb_obj_get_int(speed_in);
+    mp_int_t target_angle = pb_obj_get_int(target_angle_in);
+    pbio_actuation_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+
+    PB_ASSERT_LOCKED(pbio_servogroup_run_target(self->grp, axis, speed, target_angle, then));
+
+    // Wait for completion, or return an awaitable to the caller
+    if (!mp_obj_is_true(wait_in)) {
+        return pb_type_awaitable_new(MP_OBJ_FROM_PTR(self), self->grp->maneuver, robotics_ServoGroup_test_completion);
+    }
+    pb_type_awaitable_wait(MP_OBJ_FROM_PTR(self), self->grp->maneuver, robotics_ServoGroup_test_completion);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_ServoGroup_run_target_obj, 1, robotics_ServoGroup_run_target);
+
+// pybricks.robotics.ServoGroup.stop
+STATIC mp_obj_t robotics_ServoGroup_stop(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_ServoGroup_obj_t, self,
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_COAST_obj));
+
+    pbio_actuation_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+    PB_ASSERT_LOCKED(pbio_servogroup_stop(self->grp, then));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_ServoGroup_stop_obj, 1, robotics_ServoGroup_stop);
+
+// pybricks.robotics.ServoGroup.angle
+STATIC mp_obj_t robotics_ServoGroup_angle(mp_obj_t self_in, mp_obj_t axis_in) {
+    robotics_ServoGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_int_t axis = pb_obj_get_int(axis_in);
+    int32_t angle, speed;
+    PB_ASSERT_LOCKED(pbio_servogroup_get_state(self->grp, axis, &angle, &speed));
+
+    return mp_obj_new_int(angle);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(robotics_ServoGroup_angle_obj, robotics_ServoGroup_angle);
+
+// pybricks.robotics.ServoGroup.speed
+STATIC mp_obj_t robotics_ServoGroup_speed(mp_obj_t self_in, mp_obj_t axis_in) {
+    robotics_ServoGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_int_t axis = pb_obj_get_int(axis_in);
+    int32_t angle, speed;
+    PB_ASSERT_LOCKED(pbio_servogroup_get_state(self->grp, axis, &angle, &speed));
+
+    return mp_obj_new_int(speed);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(robotics_ServoGroup_speed_obj, robotics_ServoGroup_speed);
+
+// pybricks.robotics.ServoGroup.done
+STATIC mp_obj_t robotics_ServoGroup_done(mp_obj_t self_in) {
+    robotics_ServoGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pbio_motorpoll_lock();
+    bool done = pbio_servogroup_is_done(self->grp);
+    pbio_motorpoll_unlock();
+    return mp_obj_new_bool(done);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(robotics_ServoGroup_done_obj, robotics_ServoGroup_done);
+
+// pybricks.robotics.ServoGroup.control_period
+STATIC mp_obj_t robotics_ServoGroup_control_period(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        robotics_ServoGroup_obj_t, self,
+        PB_ARG_DEFAULT_NONE(period));
+
+    // If no value is given, return current value
+    if (period_in == mp_const_none) {
+        int32_t period;
+        PB_ASSERT_LOCKED(pbio_motorpoll_get_servogroup_period(self->grp, &period));
+        return mp_obj_new_int(period);
+    }
+
+    // Set the update period (ms) used during maneuvers
+    PB_ASSERT_LOCKED(pbio_motorpoll_set_servogroup_period(self->grp, pb_obj_get_int(period_in)));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(robotics_ServoGroup_control_period_obj, 1, robotics_ServoGroup_control_period);
+
+// dir(pybricks.robotics.ServoGroup)
+STATIC const mp_rom_map_elem_t robotics_ServoGroup_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_run),        MP_ROM_PTR(&robotics_ServoGroup_run_obj)        },
+    { MP_ROM_QSTR(MP_QSTR_run_target), MP_ROM_PTR(&robotics_ServoGroup_run_target_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop),       MP_ROM_PTR(&robotics_ServoGroup_stop_obj)       },
+    { MP_ROM_QSTR(MP_QSTR_angle),      MP_ROM_PTR(&robotics_ServoGroup_angle_obj)      },
+    { MP_ROM_QSTR(MP_QSTR_speed),      MP_ROM_PTR(&robotics_ServoGroup_speed_obj)      },
+    { MP_ROM_QSTR(MP_QSTR_done),       MP_ROM_PTR(&robotics_ServoGroup_done_obj)       },
+    { MP_ROM_QSTR(MP_QSTR_control_period), MP_ROM_PTR(&robotics_ServoGroup_control_period_obj) },
+    { MP_ROM_QSTR(MP_QSTR_motors),     MP_ROM_ATTRIBUTE_OFFSET(robotics_ServoGroup_obj_t, motors) },
+    { MP_ROM_QSTR(MP_QSTR_log),        MP_ROM_ATTRIBUTE_OFFSET(robotics_ServoGroup_obj_t, logger) },
+};
+STATIC MP_DEFINE_CONST_DICT(robotics_ServoGroup_locals_dict, robotics_ServoGroup_locals_dict_table);
+
+// type(pybricks.robotics.ServoGroup)
+const mp_obj_type_t pb_type_servogroup = {
+    { &mp_type_type },
+    .name = MP_QSTR_ServoGroup,
+    .make_new = robotics_ServoGroup_make_new,
+    .locals_dict = (mp_obj_dict_t *)&robotics_ServoGroup_locals_dict,
+};
+
+#endif // PYBRICKS_PY_ROBOTICS && PYBRICKS_PY_COMMON_MOTORS
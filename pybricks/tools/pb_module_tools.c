@@ -7,11 +7,13 @@
 
 #include "py/mphal.h"
 #include "py/runtime.h"
+#include "py/smallint.h"
 
 #include <pybricks/tools.h>
 
 #include <pybricks/util_mp/pb_kwarg_helper.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
+#include <pybricks/util_mp/pb_type_awaitable.h>
 #include <pybricks/util_pb/pb_error.h>
 
 STATIC mp_obj_t tools_wait(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -26,9 +28,79 @@ STATIC mp_obj_t tools_wait(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_wait_obj, 0, tools_wait);
 
+// Time between runs of the tasks, when all of them are waiting
+#define TOOLS_MULTITASK_POLL_MS (5)
+
+// Deadlines wrap around like utime.ticks_ms
+#define TOOLS_TICKS_MASK (MP_SMALL_INT_POSITIVE_MASK)
+
+STATIC bool tools_sleep_test_completion(mp_obj_t unused, mp_uint_t deadline) {
+    mp_uint_t remaining = (deadline - mp_hal_ticks_ms()) & TOOLS_TICKS_MASK;
+    return remaining == 0 || remaining > TOOLS_TICKS_MASK / 2;
+}
+
+STATIC mp_obj_t tools_sleep(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
+        PB_ARG_REQUIRED(time));
+
+    mp_int_t time = pb_obj_get_int(time_in);
+    if (time < 0 || time > (mp_int_t)(TOOLS_TICKS_MASK / 2)) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+
+    mp_uint_t deadline = (mp_hal_ticks_ms() + time) & TOOLS_TICKS_MASK;
+    return pb_type_awaitable_new(mp_const_none, deadline, tools_sleep_test_completion);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_sleep_obj, 0, tools_sleep);
+
+// Runs generators or awaitables side by side until all of them are done. Each
+// task runs until it yields, and the next one gets a turn. This returns the
+// list of the values returned by the tasks.
+STATIC mp_obj_t tools_multitask(size_t n_args, const mp_obj_t *args) {
+
+    mp_obj_t *tasks = m_new(mp_obj_t, n_args);
+    mp_obj_t *results = m_new(mp_obj_t, n_args);
+    for (size_t i = 0; i < n_args; i++) {
+        tasks[i] = mp_getiter(args[i], NULL);
+        results[i] = mp_const_none;
+    }
+
+    size_t remaining = n_args;
+    while (true) {
+        for (size_t i = 0; i < n_args; i++) {
+            if (tasks[i] == MP_OBJ_NULL) {
+                continue;
+            }
+            mp_obj_t ret;
+            mp_vm_return_kind_t kind = mp_resume(tasks[i], mp_const_none, MP_OBJ_NULL, &ret);
+            if (kind == MP_VM_RETURN_EXCEPTION) {
+                nlr_raise(ret);
+            }
+            if (kind == MP_VM_RETURN_NORMAL) {
+                results[i] = ret == MP_OBJ_STOP_ITERATION ? mp_const_none : ret;
+                tasks[i] = MP_OBJ_NULL;
+                remaining--;
+            }
+        }
+        if (remaining == 0) {
+            break;
+        }
+        // Give the motors and other processes time to run
+        mp_hal_delay_ms(TOOLS_MULTITASK_POLL_MS);
+    }
+
+    mp_obj_t list = mp_obj_new_list(n_args, results);
+    m_del(mp_obj_t, tasks, n_args);
+    m_del(mp_obj_t, results, n_args);
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(tools_multitask_obj, 0, tools_multitask);
+
 STATIC const mp_rom_map_elem_t tools_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__),    MP_ROM_QSTR(MP_QSTR_tools)      },
     { MP_ROM_QSTR(MP_QSTR_wait),        MP_ROM_PTR(&tools_wait_obj)     },
+    { MP_ROM_QSTR(MP_QSTR_sleep),       MP_ROM_PTR(&tools_sleep_obj)    },
+    { MP_ROM_QSTR(MP_QSTR_multitask),   MP_ROM_PTR(&tools_multitask_obj) },
     { MP_ROM_QSTR(MP_QSTR_StopWatch),   MP_ROM_PTR(&pb_type_StopWatch)  },
 };
 STATIC MP_DEFINE_CONST_DICT(pb_module_tools_globals, tools_globals_table);
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#include "py/mphal.h"
+#include "py/obj.h"
+#include "py/runtime.h"
+
+#include <pybricks/util_mp/pb_type_awaitable.h>
+
+// Time between completion checks while blocking
+#define AWAITABLE_POLL_MS (5)
+
+typedef struct _pb_type_awaitable_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t obj;
+    mp_uint_t tag;
+    pb_awaitable_test_completion_t test_completion;
+} pb_type_awaitable_obj_t;
+
+// Yields None until done, then stops the iteration
+STATIC mp_obj_t pb_type_awaitable_iternext(mp_obj_t self_in) {
+    pb_type_awaitable_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->test_completion(self->obj, self->tag)) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    return mp_const_none;
+}
+
+// Awaitable.done
+STATIC mp_obj_t pb_type_awaitable_done(mp_obj_t self_in) {
+    pb_type_awaitable_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(self->test_completion(self->obj, self->tag));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pb_type_awaitable_done_obj, pb_type_awaitable_done);
+
+// Awaitable.wait
+STATIC mp_obj_t pb_type_awaitable_wait_obj_method(mp_obj_t self_in) {
+    pb_type_awaitable_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pb_type_awaitable_wait(self->obj, self->tag, self->test_completion);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pb_type_awaitable_wait_obj, pb_type_awaitable_wait_obj_method);
+
+STATIC const mp_rom_map_elem_t pb_type_awaitable_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_done), MP_ROM_PTR(&pb_type_awaitable_done_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&pb_type_awaitable_wait_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(pb_type_awaitable_locals_dict, pb_type_awaitable_locals_dict_table);
+
+STATIC const mp_obj_type_t pb_type_awaitable = {
+    { &mp_type_type },
+    .name = MP_QSTR_Awaitable,
+    .getiter = mp_identity_getiter,
+    .iternext = pb_type_awaitable_iternext,
+    .locals_dict = (mp_obj_dict_t *)&pb_type_awaitable_locals_dict,
+};
+
+mp_obj_t pb_type_awaitable_new(mp_obj_t obj, mp_uint_t tag, pb_awaitable_test_completion_t test_completion) {
+    pb_type_awaitable_obj_t *self = m_new_obj(pb_type_awaitable_obj_t);
+    self->base.type = &pb_type_awaitable;
+    self->obj = obj;
+    self->tag = tag;
+    self->test_completion = test_completion;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+void pb_type_awaitable_wait(mp_obj_t obj, mp_uint_t tag, pb_awaitable_test_completion_t test_completion) {
+    while (!test_completion(obj, tag)) {
+        mp_hal_delay_ms(AWAITABLE_POLL_MS);
+    }
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2020 The Pybricks Authors
+
+#ifndef PYBRICKS_INCLUDED_PY_PB_TYPE_AWAITABLE_H
+#define PYBRICKS_INCLUDED_PY_PB_TYPE_AWAITABLE_H
+
+#include "py/obj.h"
+
+// Returns true if the operation on obj is complete. Raises if it failed. The
+// tag is the value given when the awaitable was made, such as the number of
+// the maneuver that it waits for.
+typedef bool (*pb_awaitable_test_completion_t)(mp_obj_t obj, mp_uint_t tag);
+
+// Object that is done when the test function says so. It can be used with
+// "yield from" or "await", and keeps yielding until the operation completes.
+mp_obj_t pb_type_awaitable_new(mp_obj_t obj, mp_uint_t tag, pb_awaitable_test_completion_t test_completion);
+
+// Blocks until the test function says the operation on obj is complete.
+void pb_type_awaitable_wait(mp_obj_t obj, mp_uint_t tag, pb_awaitable_test_completion_t test_completion);
+
+#endif // PYBRICKS_INCLUDED_PY_PB_TYPE_AWAITABLE_H
@@ -10,12 +10,25 @@
 #include <pbio/error.h>
 #include <pbio/iodev.h>
 
+#include "py/obj.h"
+
 typedef struct _pb_device_t pb_device_t;
 
+// Converts a raw sample to the value that is returned to the user
+typedef mp_obj_t (*pb_device_scale_t)(int32_t value);
+
 pb_device_t *pb_device_get_device(pbio_port_t port, pbio_iodev_type_id_t valid_id);
 
 void pb_device_get_values(pb_device_t *pbdev, uint8_t mode, int32_t *values);
 
+void pb_device_get_sample(pb_device_t *pbdev, uint32_t *count, uint32_t *time);
+
+void pb_device_wait_sample(pb_device_t *pbdev, uint32_t count);
+
+mp_obj_t pb_device_get_samples(pb_device_t *pbdev, uint8_t mode, mp_obj_t n_in, pb_device_scale_t scale);
+
+mp_obj_t pb_device_get_filtered(pb_device_t *pbdev, uint8_t mode, mp_obj_t n_in, mp_obj_t filter_in, mp_obj_t weight_in, pbio_iodev_normalize_t normalize, pb_device_scale_t scale);
+
 void pb_device_set_values(pb_device_t *pbdev, uint8_t mode, int32_t *values, uint8_t num_values);
 
 void pb_device_set_power_supply(pb_device_t *pbdev, int32_t duty);
@@ -48,6 +48,20 @@ struct _pb_device_t {
 
 pb_device_t iodevices[4];
 
+// Get how often a sensor is read in the background (ms)
+static uint32_t get_sample_period(pbio_iodev_type_id_t id) {
+    switch (id) {
+        case PBIO_IODEV_TYPE_ID_EV3_GYRO_SENSOR:
+            return 2;
+        case PBIO_IODEV_TYPE_ID_EV3_ULTRASONIC_SENSOR:
+        case PBIO_IODEV_TYPE_ID_EV3_IR_SENSOR:
+            return 10;
+        // Default period for other sensors:
+        default:
+            return 5;
+    }
+}
+
 // Get an ev3dev sensor
 static pbio_error_t get_device(pb_device_t **pbdev, pbio_iodev_type_id_t valid_id, pbio_port_t port) {
     if (port < PBIO_PORT_1 || port > PBIO_PORT_4) {
@@ -66,6 +80,7 @@ static pbio_error_t get_device(pb_device_t **pbdev, pbio_iodev_type_id_t valid_i
         return err;
     }
     _pbdev->type_id = valid_id;
+    lego_sensor_set_sample_period(_pbdev->sensor, get_sample_period(valid_id));
 
     // For special sensor classes we are done. No need to read mode.
     if (valid_id == PBIO_IODEV_TYPE_ID_CUSTOM_I2C ||
@@ -214,6 +229,24 @@ void pb_device_get_values(pb_device_t *pbdev, uint8_t mode, int32_t *values) {
     pb_assert(err);
 }
 
+void pb_device_get_sample(pb_device_t *pbdev, uint32_t *count, uint32_t *time) {
+    pb_assert(PBIO_ERROR_NOT_SUPPORTED);
+}
+
+void pb_device_wait_sample(pb_device_t *pbdev, uint32_t count) {
+    pb_assert(PBIO_ERROR_NOT_SUPPORTED);
+}
+
+mp_obj_t pb_device_get_samples(pb_device_t *pbdev, uint8_t mode, mp_obj_t n_in, pb_device_scale_t scale) {
+    pb_assert(PBIO_ERROR_NOT_SUPPORTED);
+    return mp_const_none;
+}
+
+mp_obj_t pb_device_get_filtered(pb_device_t *pbdev, uint8_t mode, mp_obj_t n_in, mp_obj_t filter_in, mp_obj_t weight_in, pbio_iodev_normalize_t normalize, pb_device_scale_t scale) {
+    pb_assert(PBIO_ERROR_NOT_SUPPORTED);
+    return mp_const_none;
+}
+
 void pb_device_set_values(pb_device_t *pbdev, uint8_t mode, int32_t *values, uint8_t num_values) {
     pb_assert(PBIO_ERROR_NOT_SUPPORTED);
 }
@@ -6,6 +6,7 @@
 #include <pbdrv/ioport.h>
 #include <pbdrv/motor.h>
 #include <pbio/color.h>
+#include <pbio/config.h>
 #include <pbio/iodev.h>
 
 #include "py/mphal.h"
@@ -13,6 +14,7 @@
 #include "py/obj.h"
 #include "py/runtime.h"
 
+#include <pybricks/util_mp/pb_obj_helper.h>
 #include <pybricks/util_pb/pb_device.h>
 #include <pybricks/util_pb/pb_error.h>
 
@@ -62,6 +64,25 @@ static void set_mode(pbio_iodev_t *iodev, uint8_t new_mode) {
         return;
     }
 
+    // Data for combined modes is always up to date, so no need to wait
+    bool wait_for_data = !(iodev->combo_modes & (1 << new_mode));
+
+    // When alternating between modes that can be combined, get the data for
+    // both of them at once, so that later mode changes are instant. Other
+    // modes are added if there is room left, but never in place of these.
+    uint16_t combos = iodev->info->mode_combos;
+    uint16_t pair = 1 << iodev->mode | 1 << new_mode;
+    if (wait_for_data && (combos & pair) == pair) {
+        while ((err = pbio_iodev_set_mode_combo_begin(iodev, pair, combos)) == PBIO_ERROR_AGAIN) {
+            ;
+        }
+        if (err == PBIO_SUCCESS) {
+            wait(pbio_iodev_set_mode_end, pbio_iodev_set_mode_cancel, iodev);
+        } else if (err != PBIO_ERROR_NOT_SUPPORTED && err != PBIO_ERROR_INVALID_ARG) {
+            pb_assert(err);
+        }
+    }
+
     while ((err = pbio_iodev_set_mode_begin(iodev, new_mode)) == PBIO_ERROR_AGAIN) {
         ;
     }
@@ -70,7 +91,7 @@ static void set_mode(pbio_iodev_t *iodev, uint8_t new_mode) {
 
     // Give some time for the mode to take effect and discard stale data
     uint32_t delay = get_mode_switch_delay(iodev->info->type_id, new_mode);
-    if (delay > 0) {
+    if (wait_for_data && delay > 0) {
         mp_hal_delay_ms(delay);
     }
 }
@@ -135,6 +156,97 @@ void pb_device_get_values(pb_device_t *pbdev, uint8_t mode, int32_t *values) {
     }
 }
 
+// Gets the sequence number and time (us) of the most recent data
+void pb_device_get_sample(pb_device_t *pbdev, uint32_t *count, uint32_t *time) {
+    pb_assert(pbio_iodev_get_sample(&pbdev->iodev, count, time));
+}
+
+// Waits for data that is newer than the sample with the given sequence number
+void pb_device_wait_sample(pb_device_t *pbdev, uint32_t count) {
+    pbio_error_t err;
+    while ((err = pbio_iodev_wait_sample(&pbdev->iodev, count)) == PBIO_ERROR_AGAIN) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    pb_assert(err);
+}
+
+#if PBIO_CONFIG_IODEV_HISTORY_SIZE
+
+// Gets the number of samples requested by the user
+static uint8_t get_num_samples(mp_obj_t n_in) {
+    mp_int_t n = pb_obj_get_int(n_in);
+    if (n < 1 || n > PBIO_CONFIG_IODEV_HISTORY_SIZE) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    return n;
+}
+
+// Gets the filter type from its name
+static pbio_iodev_filter_t get_filter(mp_obj_t filter_in) {
+    switch (mp_obj_str_get_qstr(filter_in)) {
+        case MP_QSTR_average:
+            return PBIO_IODEV_FILTER_AVERAGE;
+        case MP_QSTR_median:
+            return PBIO_IODEV_FILTER_MEDIAN;
+        case MP_QSTR_exponential:
+            return PBIO_IODEV_FILTER_EXPONENTIAL;
+        default:
+            pb_assert(PBIO_ERROR_INVALID_ARG);
+            return PBIO_IODEV_FILTER_AVERAGE;
+    }
+}
+
+// Gets up to n of the most recent samples of the first value of the given mode
+mp_obj_t pb_device_get_samples(pb_device_t *pbdev, uint8_t mode, mp_obj_t n_in, pb_device_scale_t scale) {
+    pbio_iodev_t *iodev = &pbdev->iodev;
+    pbio_error_t err;
+
+    int32_t values[PBIO_CONFIG_IODEV_HISTORY_SIZE];
+    uint8_t n = get_num_samples(n_in);
+
+    set_mode(iodev, mode);
+    pbio_iodev_set_history_mode(iodev, mode);
+
+    // The history starts over if it was kept for another mode, so wait for
+    // the first sample
+    while ((err = pbio_iodev_get_history(iodev, values, &n)) == PBIO_ERROR_AGAIN) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    pb_assert(err);
+
+    mp_obj_t ret[PBIO_CONFIG_IODEV_HISTORY_SIZE];
+    for (uint8_t i = 0; i < n; i++) {
+        ret[i] = scale(values[i]);
+    }
+    return mp_obj_new_tuple(n, ret);
+}
+
+// Filters up to n of the most recent samples of the first value of the given
+// mode. This is done on the raw values, so that scaling does not add rounding
+// errors. Samples are normalized first, so that readings such as "out of
+// range" count as the end of the range.
+mp_obj_t pb_device_get_filtered(pb_device_t *pbdev, uint8_t mode, mp_obj_t n_in, mp_obj_t filter_in, mp_obj_t weight_in, pbio_iodev_normalize_t normalize, pb_device_scale_t scale) {
+    pbio_iodev_t *iodev = &pbdev->iodev;
+    pbio_error_t err;
+    int32_t value;
+
+    uint8_t n = get_num_samples(n_in);
+    pbio_iodev_filter_t filter = get_filter(filter_in);
+    int32_t weight = pb_obj_get_int(weight_in);
+
+    set_mode(iodev, mode);
+    pbio_iodev_set_history_mode(iodev, mode);
+
+    while ((err = pbio_iodev_get_filtered(iodev, filter, n, weight, normalize, &value)) == PBIO_ERROR_AGAIN) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    pb_assert(err);
+
+    return scale(value);
+}
+
+#endif // PBIO_CONFIG_IODEV_HISTORY_SIZE
+
 void pb_device_set_values(pb_device_t *pbdev, uint8_t mode, int32_t *values, uint8_t num_values) {
 
     pbio_iodev_t *iodev = &pbdev->iodev;
@@ -0,0 +1,30 @@
+# Cost of the sysfs reads and writes behind each motor call. The servo loop
+# does the same reads for every motor on every update, so this is a lower
+# bound on the time each update spends on I/O. Run with the motors attached.
+
+left = Motor(Port.A)
+watch = StopWatch()
+N = 5000
+
+watch.reset()
+for i in range(N):
+    left.angle()
+print("usec/angle:", watch.time() * 1000 // N)
+
+watch.reset()
+for i in range(N):
+    left.speed()
+print("usec/speed:", watch.time() * 1000 // N)
+
+watch.reset()
+for i in range(N):
+    left.dc(i % 2)
+print("usec/dc:", watch.time() * 1000 // N)
+
+left.stop()
+
+# Loop overhead without any I/O, to subtract from the numbers above
+watch.reset()
+for i in range(N):
+    pass
+print("usec/empty:", watch.time() * 1000 // N)
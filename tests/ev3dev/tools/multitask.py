@@ -0,0 +1,38 @@
+from pybricks.tools import multitask, sleep
+
+
+def count(name, n):
+    for i in range(n):
+        print(name, i)
+        yield
+    return name
+
+
+# tasks take turns until they yield
+
+print(multitask(count("a", 2), count("b", 3)))
+
+
+# awaitables can be run directly or from a generator
+
+
+def nap():
+    yield from sleep(20)
+    return "rested"
+
+
+print(multitask(nap(), sleep(10)))
+
+
+# errors in a task are raised by multitask
+
+
+def fail():
+    yield
+    raise ValueError("oops")
+
+
+try:
+    multitask(count("c", 3), fail())
+except ValueError as ex:
+    print(ex)
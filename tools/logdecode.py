@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+
+# SPDX-License-Identifier: MIT
+# Copyright (c) 2020 The Pybricks Authors
+
+"""Decode logs saved with Logger.start(..., packed=True) to comma separated
+values, like the ones saved by an unpacked log."""
+
+import argparse
+import binascii
+import struct
+import sys
+
+HEADER_FORMAT = "<4sBBI"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+MAGIC = b"PBLG"
+VERSION = 1
+
+# Number of bytes for each 2-bit width code
+WIDTH_BYTES = (0, 1, 2, 4)
+
+
+def read_log(path):
+    """Reads a packed log as saved on the brick (binary) or printed by a hub
+    (lines of hex, possibly still enclosed in PB_OF/PB_EOF markers).
+
+    Parameters
+    ----------
+    path : str
+        Path to the log file.
+
+    Returns
+    -------
+    bytes
+        The packed log, starting with the header.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data.startswith(MAGIC):
+        return data
+
+    lines = data.decode("ascii").splitlines()
+    return binascii.unhexlify("".join(line.strip() for line in lines if not line.startswith("PB_")))
+
+
+def zigzag_decode(value):
+    """Converts an unsigned zigzag encoded value back to a signed value."""
+    return (value >> 1) ^ -(value & 1)
+
+
+def to_int32(value):
+    """Wraps a value to the int32 range, like the counters it comes from."""
+    return (value + 2 ** 31) % 2 ** 32 - 2 ** 31
+
+
+def decode(data):
+    """Decodes a packed log.
+
+    Parameters
+    ----------
+    data : bytes
+        The packed log, starting with the header.
+
+    Returns
+    -------
+    list of list of int
+        The logged rows.
+    """
+    magic, version, num_values, delta_mask = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != MAGIC:
+        raise ValueError("not a packed log")
+    if version != VERSION:
+        raise ValueError("unsupported log version {}".format(version))
+
+    width_size = (num_values + 3) // 4
+    row = [0] * num_values
+    rows = []
+    pos = HEADER_SIZE
+
+    while pos + width_size <= len(data):
+        widths = data[pos : pos + width_size]
+        pos += width_size
+
+        for i in range(num_values):
+            size = WIDTH_BYTES[(widths[i // 4] >> (i % 4 * 2)) & 3]
+            value = zigzag_decode(int.from_bytes(data[pos : pos + size], "little"))
+            pos += size
+            row[i] = to_int32(row[i] + value) if delta_mask & (1 << i) else value
+
+        rows.append(list(row))
+
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a packed Pybricks log to CSV.")
+    parser.add_argument("log", help="packed log file")
+    parser.add_argument(
+        "output", nargs="?", help="output file (default: stdout)",
+    )
+    args = parser.parse_args()
+
+    rows = decode(read_log(args.log))
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    for row in rows:
+        print(",".join(str(v) for v in row), file=out)
+    if args.output:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()